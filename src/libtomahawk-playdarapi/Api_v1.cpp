@@ -30,14 +30,25 @@
 #include "utils/TomahawkUtils.h"
 
 #include "Api_v1_5.h"
+#include "BatchRequestHandler.h"
 #include "Pipeline.h"
 #include "Result.h"
+#include "ResultsResponseHandler.h"
 #include "Source.h"
 #include "StatResponseHandler.h"
 #include "UrlHandler.h"
 
 #include <QHash>
 
+// Longest a get_results request with wait=<seconds> is held open
+#define MAX_RESULTS_WAIT 30
+// Most queries a single resolve_batch request may carry
+#define MAX_BATCH_QUERIES 500
+// Largest resolve_batch body we accept, in bytes
+#define MAX_BATCH_BODY ( 1024 * 1024 )
+// Longest we wait for a client to upload its resolve_batch body, in ms
+#define BATCH_BODY_TIMEOUT 10000
+
 using namespace Tomahawk;
 using namespace TomahawkUtils;
 
@@ -182,6 +193,7 @@ Api_v1::api( QxtWebRequestEvent* event, const QString& version, const QString& m
 
           if ( method == "stat" )        return stat( event );
           if ( method == "resolve" )     return resolve( event );
+          if ( method == "resolve_batch" ) return resolve_batch( event );
           if ( method == "get_results" ) return get_results( event );
       }
 
@@ -397,6 +409,86 @@ Api_v1::staticdata( QxtWebRequestEvent* event, const QString& path, const QStrin
 }
 
 
+/**
+ * Resolve many queries with a single request.
+ *
+ * The POSTed body is a JSON list of objects with artist, track and optionally
+ * album and qid. Replies with the qids in the same order; malformed entries
+ * get an empty qid.
+ */
+void
+Api_v1::resolve_batch( QxtWebRequestEvent* event )
+{
+    // without a Content-Length we couldn't tell when the body is complete
+    if ( event->content.isNull() || event->content->wantAll() || event->content->unreadBytes() > MAX_BATCH_BODY )
+    {
+        tDebug( LOGVERBOSE ) << "Malformed HTTP resolve_batch request";
+        return send404( event );
+    }
+
+    if ( event->content->bytesNeeded() == 0 )
+    {
+        resolveBatch( event, event->content->readAll() );
+        return;
+    }
+
+    // The client is still uploading, don't block the event loop waiting for it
+    new BatchRequestHandler( this, event, BATCH_BODY_TIMEOUT );
+}
+
+
+void
+Api_v1::resolveBatch( QxtWebRequestEvent* event, const QByteArray& body )
+{
+    bool ok;
+    const QVariantList entries = TomahawkUtils::parseJson( body, &ok ).toList();
+    if ( !ok || entries.isEmpty() || entries.count() > MAX_BATCH_QUERIES )
+    {
+        tDebug( LOGVERBOSE ) << "Malformed HTTP resolve_batch request";
+        return send404( event );
+    }
+
+    QVariantList qids;
+    QList< query_ptr > queries;
+    foreach ( const QVariant& entry, entries )
+    {
+        const QVariantMap m = entry.toMap();
+        const QString artist = m.value( "artist" ).toString();
+        const QString track = m.value( "track" ).toString();
+        QString qid = m.value( "qid" ).toString();
+        if ( qid.isEmpty() )
+            qid = uuid();
+
+        query_ptr qry;
+        if ( !artist.trimmed().isEmpty() && !track.trimmed().isEmpty() )
+            qry = Query::get( artist, track, m.value( "album" ).toString(), qid, false );
+
+        if ( qry.isNull() )
+        {
+            qids << QString();
+            continue;
+        }
+
+        queries << qry;
+        qids << qid;
+    }
+
+    // One pipeline call for the lot, instead of one per query
+    Pipeline::instance()->resolve( queries, true, true );
+
+    QVariantMap r;
+    r.insert( "qids", qids );
+    sendJSON( r, event );
+}
+
+
+/**
+ * Reply with the current results of a query.
+ *
+ * With wait=<seconds> the request becomes a long-poll: while the query is
+ * still resolving and the client already has all of its results (known=<count
+ * of results in the previous reply>), the reply is held back until that changes.
+ */
 void
 Api_v1::get_results( QxtWebRequestEvent* event )
 {
@@ -414,12 +506,37 @@ Api_v1::get_results( QxtWebRequestEvent* event )
         return;
     }
 
+    const int wait = qBound( 0, urlQueryItemValue( event->url, "wait" ).toInt(), MAX_RESULTS_WAIT );
+    if ( wait > 0 && !qry->resolvingFinished() )
+    {
+        int online = 0;
+        foreach ( const result_ptr& rp, qry->results() )
+        {
+            if ( rp->isOnline() )
+                online++;
+        }
+
+        if ( online == urlQueryItemValue( event->url, "known" ).toInt() )
+        {
+            new ResultsResponseHandler( this, event, qry, wait * 1000 );
+            return;
+        }
+    }
+
+    sendResults( event, qry );
+}
+
+
+void
+Api_v1::sendResults( QxtWebRequestEvent* event, const query_ptr& qry )
+{
     QVariantMap r;
     r.insert( "qid", qry->id() );
     r.insert( "poll_interval", 1300 );
     r.insert( "refresh_interval", 1000 );
     r.insert( "poll_limit", 14 );
     r.insert( "solved", qry->playable() );
+    r.insert( "finished", qry->resolvingFinished() );
     r.insert( "query", qry->toVariant() );
 
     QVariantList res;
@@ -39,7 +39,9 @@ class Api_v1_5;
 
 namespace Tomahawk
 {
+    class Query;
     class Result;
+    typedef QSharedPointer< Query > query_ptr;
     typedef QSharedPointer< Result > result_ptr;
 }
 
@@ -51,6 +53,9 @@ public:
     Api_v1( QxtAbstractWebSessionManager* sm, QObject* parent = 0 );
     virtual ~Api_v1();
 
+    /// Resolves the queries of a resolve_batch request, once its whole @p body arrived
+    void resolveBatch( QxtWebRequestEvent* event, const QByteArray& body );
+
 public slots:
     // authenticating uses /auth_1
     // we redirect to /auth_2 for the callback
@@ -70,10 +75,12 @@ public slots:
     void send404( QxtWebRequestEvent* event );
     void stat( QxtWebRequestEvent* event );
     void resolve( QxtWebRequestEvent* event );
+    void resolve_batch( QxtWebRequestEvent* event );
     void staticdata( QxtWebRequestEvent* event, const QString& file );
     void staticdata( QxtWebRequestEvent* event, const QString& path, const QString& file );
     void get_results( QxtWebRequestEvent* event );
     void sendJSON( const QVariantMap& m, QxtWebRequestEvent* event );
+    void sendResults( QxtWebRequestEvent* event, const Tomahawk::query_ptr& query );
 
     void sendJsonError( QxtWebRequestEvent* event, const QString& message );
     void sendJsonOk( QxtWebRequestEvent* event );
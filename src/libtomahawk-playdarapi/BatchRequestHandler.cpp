@@ -0,0 +1,86 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BatchRequestHandler.h"
+
+#include "Api_v1.h"
+#include "utils/Logger.h"
+
+
+BatchRequestHandler::BatchRequestHandler( Api_v1* parent, QxtWebRequestEvent* event, int timeout )
+    : QObject( parent )
+    , m_parent( parent )
+    , m_storedEvent( event )
+    , m_content( event->content )
+{
+    // a client going away mid-upload ends the content with readChannelFinished only
+    connect( m_content.data(), SIGNAL( readyRead() ), SLOT( onReadyRead() ) );
+    connect( m_content.data(), SIGNAL( readChannelFinished() ), SLOT( onReadyRead() ) );
+
+    m_timer.setSingleShot( true );
+    connect( &m_timer, SIGNAL( timeout() ), SLOT( onTimeout() ) );
+    m_timer.start( timeout );
+
+    onReadyRead();
+}
+
+
+void
+BatchRequestHandler::onReadyRead()
+{
+    if ( !m_storedEvent )
+        return;
+
+    if ( m_content.isNull() )
+    {
+        finish( false );
+        return;
+    }
+
+    m_body += m_content.data()->readAll();
+    if ( m_content.data()->bytesNeeded() == 0 )
+        finish( true );
+}
+
+
+void
+BatchRequestHandler::onTimeout()
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Gave up waiting for the resolve_batch body";
+    if ( !m_content.isNull() )
+        m_content.data()->ignoreRemainingContent();
+
+    finish( false );
+}
+
+
+void
+BatchRequestHandler::finish( bool complete )
+{
+    if ( !m_storedEvent )
+        return;
+
+    if ( !m_content.isNull() )
+        disconnect( m_content.data(), 0, this, 0 );
+    m_timer.stop();
+
+    if ( complete )
+        m_parent->resolveBatch( m_storedEvent, m_body );
+    else
+        m_parent->send404( m_storedEvent );
+    m_storedEvent = 0;
+
+    deleteLater();
+}
@@ -0,0 +1,54 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef BATCHREQUESTHANDLER_H
+#define BATCHREQUESTHANDLER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class Api_v1;
+class QxtWebContent;
+class QxtWebRequestEvent;
+
+/**
+ * Collects the body of a resolve_batch request as it arrives, without
+ * blocking the event loop, and hands it to Api_v1 once it's complete.
+ * Clients that don't finish uploading within the timeout get a 404.
+ */
+class BatchRequestHandler : public QObject
+{
+    Q_OBJECT
+public:
+    BatchRequestHandler( Api_v1* parent, QxtWebRequestEvent* event, int timeout );
+
+private slots:
+    void onReadyRead();
+    void onTimeout();
+
+private:
+    void finish( bool complete );
+
+    Api_v1* m_parent;
+    QxtWebRequestEvent* m_storedEvent;
+    QPointer< QxtWebContent > m_content;
+    QByteArray m_body;
+    QTimer m_timer;
+};
+
+#endif // BATCHREQUESTHANDLER_H
@@ -0,0 +1,52 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResultsResponseHandler.h"
+
+#include "Api_v1.h"
+#include "Query.h"
+
+
+ResultsResponseHandler::ResultsResponseHandler( Api_v1* parent, QxtWebRequestEvent* event, const Tomahawk::query_ptr& query, int timeout )
+    : QObject( parent )
+    , m_parent( parent )
+    , m_storedEvent( event )
+    , m_query( query )
+{
+    connect( query.data(), SIGNAL( resultsChanged() ), SLOT( reply() ) );
+    connect( query.data(), SIGNAL( resolvingFinished( bool ) ), SLOT( reply() ) );
+
+    m_timer.setSingleShot( true );
+    connect( &m_timer, SIGNAL( timeout() ), SLOT( reply() ) );
+    m_timer.start( timeout );
+}
+
+
+void
+ResultsResponseHandler::reply()
+{
+    Q_ASSERT( m_storedEvent );
+    if ( !m_storedEvent )
+        return;
+
+    disconnect( m_query.data(), 0, this, 0 );
+    m_timer.stop();
+
+    m_parent->sendResults( m_storedEvent, m_query );
+    m_storedEvent = 0;
+
+    deleteLater();
+}
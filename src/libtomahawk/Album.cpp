@@ -22,6 +22,7 @@
 #include "database/Database.h"
 #include "database/DatabaseImpl.h"
 #include "database/IdThreadWorker.h"
+#include "utils/CoverCache.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
 
@@ -32,7 +33,6 @@
 #include "Source.h"
 
 #include <QReadWriteLock>
-#include <QPixmapCache>
 
 using namespace Tomahawk;
 
@@ -252,32 +252,25 @@ Album::cover( const QSize& size, bool forceLoad ) const
         if ( !forceLoad )
             return QPixmap();
 
-        Tomahawk::InfoSystem::InfoStringHash trackInfo;
-        trackInfo["artist"] = d->artist->name();
-        trackInfo["album"] = d->name;
-
-        Tomahawk::InfoSystem::InfoRequestData requestData;
-        requestData.caller = infoid();
-        requestData.type = Tomahawk::InfoSystem::InfoAlbumCoverArt;
-        requestData.input = QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo );
-        requestData.customData = QVariantMap();
-        requestData.allSources = true;
-
-        connect( Tomahawk::InfoSystem::InfoSystem::instance(),
-                SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
-                SLOT( infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ) );
-
-        connect( Tomahawk::InfoSystem::InfoSystem::instance(),
-                SIGNAL( finished( QString ) ),
-                SLOT( infoSystemFinished( QString ) ) );
+        // painting it, so it's on screen
+        loadCover( true );
+    }
 
-        Tomahawk::InfoSystem::InfoSystem::instance()->getInfo( requestData );
+    if ( !size.isEmpty() )
+    {
+        // once the full size got decoded the buffer is gone, scale that instead
+        if ( d->cover )
+            return TomahawkUtils::CoverCache::instance()->cover( infoid(), *d->cover, size );
 
-        d->coverLoading = true;
+        return TomahawkUtils::CoverCache::instance()->cover( infoid(), d->coverBuffer, size,
+                                                             const_cast< Album* >( this ), "coverChanged" );
     }
 
-    if ( !d->cover && !d->coverBuffer.isEmpty() )
+    if ( !d->cover )
     {
+        if ( d->coverBuffer.isEmpty() )
+            return QPixmap();
+
         QPixmap cover;
         cover.loadFromData( d->coverBuffer );
         d->coverBuffer.clear();
@@ -285,24 +278,7 @@ Album::cover( const QSize& size, bool forceLoad ) const
         d->cover = new QPixmap( TomahawkUtils::squareCenterPixmap( cover ) );
     }
 
-    if ( d->cover && !d->cover->isNull() && !size.isEmpty() )
-    {
-        const QString cacheKey = QString( "%1_%2_%3" ).arg( infoid() ).arg( size.width() ).arg( size.height() );
-        QPixmap cover;
-
-        if ( !QPixmapCache::find( cacheKey, &cover ) )
-        {
-            cover = d->cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-            QPixmapCache::insert( cacheKey, cover );
-            return cover;
-        }
-        return cover;
-    }
-
-    if ( d->cover )
-        return *d->cover;
-    else
-        return QPixmap();
+    return *d->cover;
 }
 
 
@@ -314,6 +290,57 @@ Album::coverLoaded() const
 }
 
 
+bool
+Album::hasCover() const
+{
+    Q_D( const Album );
+    if ( d->cover )
+        return !d->cover->isNull();
+
+    return !d->coverBuffer.isEmpty();
+}
+
+
+void
+Album::loadCover( bool visible ) const
+{
+    Q_D( const Album );
+    if ( d->coverLoaded || d->coverLoading )
+        return;
+
+    if ( d->name.isEmpty() )
+    {
+        d->coverLoaded = true;
+        return;
+    }
+
+    Tomahawk::InfoSystem::InfoStringHash trackInfo;
+    trackInfo["artist"] = d->artist->name();
+    trackInfo["album"] = d->name;
+
+    Tomahawk::InfoSystem::InfoRequestData requestData;
+    requestData.caller = infoid();
+    requestData.type = Tomahawk::InfoSystem::InfoAlbumCoverArt;
+    requestData.input = QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo );
+    requestData.customData = QVariantMap();
+    requestData.allSources = true;
+    // Don't let covers that are scrolled away or not shown yet hold up the visible ones
+    requestData.priority = visible ? Tomahawk::InfoSystem::InfoPriorityHigh : Tomahawk::InfoSystem::InfoPriorityNormal;
+
+    connect( Tomahawk::InfoSystem::InfoSystem::instance(),
+            SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
+            SLOT( infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ) );
+
+    connect( Tomahawk::InfoSystem::InfoSystem::instance(),
+            SIGNAL( finished( QString ) ),
+            SLOT( infoSystemFinished( QString ) ) );
+
+    Tomahawk::InfoSystem::InfoSystem::instance()->getInfo( requestData );
+
+    d->coverLoading = true;
+}
+
+
 void
 Album::infoSystemInfo( const Tomahawk::InfoSystem::InfoRequestData& requestData, const QVariant& output )
 {
@@ -335,6 +362,10 @@ Album::infoSystemInfo( const Tomahawk::InfoSystem::InfoRequestData& requestData,
         if ( !ba.isEmpty() )
         {
             d->coverBuffer = ba;
+
+            delete d->cover;
+            d->cover = 0;
+            TomahawkUtils::CoverCache::instance()->remove( infoid() );
         }
 
         d->coverLoaded = true;
@@ -59,8 +59,15 @@ public:
     QString sortname() const;
 
     artist_ptr artist() const;
+    /**
+     * Scaled covers are prepared in the background, until then a null
+     * pixmap is returned and coverChanged() is emitted once it's ready.
+     */
     QPixmap cover( const QSize& size, bool forceLoad = true ) const;
     bool coverLoaded() const;
+    bool hasCover() const;
+    /// Fetches the cover without decoding it. Covers that are @p visible get fetched first.
+    void loadCover( bool visible = false ) const;
 
     QList<Tomahawk::query_ptr> tracks( ModelMode mode = Mixed, const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr() );
     Tomahawk::playlistinterface_ptr playlistInterface( ModelMode mode, const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr() );
@@ -27,6 +27,7 @@
 #include "database/DatabaseCommand_ArtistStats.h"
 #include "database/DatabaseCommand_TrackStats.h"
 #include "database/IdThreadWorker.h"
+#include "utils/CoverCache.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
 
@@ -35,7 +36,6 @@
 #include "Source.h"
 
 #include <QReadWriteLock>
-#include <QPixmapCache>
 
 using namespace Tomahawk;
 
@@ -516,6 +516,10 @@ Artist::infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData requestData, QVari
                 if ( !ba.isEmpty() )
                 {
                     m_coverBuffer = ba;
+
+                    delete m_cover;
+                    m_cover = 0;
+                    TomahawkUtils::CoverCache::instance()->remove( infoid() );
                 }
 
                 m_coverLoaded = true;
@@ -591,31 +595,25 @@ Artist::cover( const QSize& size, bool forceLoad ) const
         if ( !forceLoad )
             return QPixmap();
 
-        Tomahawk::InfoSystem::InfoStringHash trackInfo;
-        trackInfo["artist"] = name();
-
-        Tomahawk::InfoSystem::InfoRequestData requestData;
-        requestData.caller = infoid();
-        requestData.type = Tomahawk::InfoSystem::InfoArtistImages;
-        requestData.input = QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo );
-        requestData.customData = QVariantMap();
-
-        connect( Tomahawk::InfoSystem::InfoSystem::instance(),
-                SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
-                SLOT( infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ), Qt::UniqueConnection );
-
-        connect( Tomahawk::InfoSystem::InfoSystem::instance(),
-                SIGNAL( finished( QString ) ),
-                SLOT( infoSystemFinished( QString ) ), Qt::UniqueConnection );
+        // painting it, so it's on screen
+        loadCover( true );
+    }
 
-        m_infoJobs++;
-        Tomahawk::InfoSystem::InfoSystem::instance()->getInfo( requestData );
+    if ( !size.isEmpty() )
+    {
+        // once the full size got decoded the buffer is gone, scale that instead
+        if ( m_cover )
+            return TomahawkUtils::CoverCache::instance()->cover( infoid(), *m_cover, size );
 
-        m_coverLoading = true;
+        return TomahawkUtils::CoverCache::instance()->cover( infoid(), m_coverBuffer, size,
+                                                             const_cast< Artist* >( this ), "coverChanged" );
     }
 
-    if ( !m_cover && !m_coverBuffer.isEmpty() )
+    if ( !m_cover )
     {
+        if ( m_coverBuffer.isEmpty() )
+            return QPixmap();
+
         QPixmap cover;
         cover.loadFromData( m_coverBuffer );
         m_coverBuffer.clear();
@@ -623,24 +621,49 @@ Artist::cover( const QSize& size, bool forceLoad ) const
         m_cover = new QPixmap( TomahawkUtils::squareCenterPixmap( cover ) );
     }
 
-    if ( m_cover && !m_cover->isNull() && !size.isEmpty() )
-    {
-        const QString cacheKey = QString( "%1_%2_%3" ).arg( infoid() ).arg( size.width() ).arg( size.height() );
-        QPixmap cover;
+    return *m_cover;
+}
 
-        if ( !QPixmapCache::find( cacheKey, &cover ) )
-        {
-            cover = m_cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-            QPixmapCache::insert( cacheKey, cover );
-            return cover;
-        }
-        return cover;
-    }
 
+bool
+Artist::hasCover() const
+{
     if ( m_cover )
-        return *m_cover;
-    else
-        return QPixmap();
+        return !m_cover->isNull();
+
+    return !m_coverBuffer.isEmpty();
+}
+
+
+void
+Artist::loadCover( bool visible ) const
+{
+    if ( m_coverLoaded || m_coverLoading )
+        return;
+
+    Tomahawk::InfoSystem::InfoStringHash trackInfo;
+    trackInfo["artist"] = name();
+
+    Tomahawk::InfoSystem::InfoRequestData requestData;
+    requestData.caller = infoid();
+    requestData.type = Tomahawk::InfoSystem::InfoArtistImages;
+    requestData.input = QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo );
+    requestData.customData = QVariantMap();
+    // Don't let images that are scrolled away or not shown yet hold up the visible ones
+    requestData.priority = visible ? Tomahawk::InfoSystem::InfoPriorityHigh : Tomahawk::InfoSystem::InfoPriorityNormal;
+
+    connect( Tomahawk::InfoSystem::InfoSystem::instance(),
+            SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
+            SLOT( infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ), Qt::UniqueConnection );
+
+    connect( Tomahawk::InfoSystem::InfoSystem::instance(),
+            SIGNAL( finished( QString ) ),
+            SLOT( infoSystemFinished( QString ) ), Qt::UniqueConnection );
+
+    m_infoJobs++;
+    Tomahawk::InfoSystem::InfoSystem::instance()->getInfo( requestData );
+
+    m_coverLoading = true;
 }
 
 
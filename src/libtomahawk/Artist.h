@@ -65,8 +65,15 @@ public:
 
     QString biography() const;
 
+    /**
+     * Scaled covers are prepared in the background, until then a null
+     * pixmap is returned and coverChanged() is emitted once it's ready.
+     */
     QPixmap cover( const QSize& size, bool forceLoad = true ) const;
     bool coverLoaded() const { return m_coverLoaded; }
+    bool hasCover() const;
+    /// Fetches the cover without decoding it. Covers that are @p visible get fetched first.
+    void loadCover( bool visible = false ) const;
 
     Tomahawk::playlistinterface_ptr playlistInterface();
 
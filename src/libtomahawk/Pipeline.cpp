@@ -31,6 +31,7 @@
 #include "Result.h"
 #include "Source.h"
 #include "SourceList.h"
+#include "TomahawkSettings.h"
 
 #define DEFAULT_CONCURRENT_QUERIES 4
 #define MAX_CONCURRENT_QUERIES 16
@@ -59,6 +60,12 @@ Pipeline::Pipeline( QObject* parent )
     d->maxConcurrentQueries = qBound( DEFAULT_CONCURRENT_QUERIES, QThread::idealThreadCount(), MAX_CONCURRENT_QUERIES );
     tDebug() << Q_FUNC_INFO << "Using" << d->maxConcurrentQueries << "threads";
 
+    if ( TomahawkSettings::instance() )
+    {
+        d->fanOut = TomahawkSettings::instance()->resolverFanOut();
+        d->resolverBudget = TomahawkSettings::instance()->resolverQueryBudget();
+    }
+
     d->temporaryQueryTimer.setInterval( CLEANUP_TIMEOUT );
     connect( &d->temporaryQueryTimer, SIGNAL( timeout() ), SLOT( onTemporaryQueryTimer() ) );
 }
@@ -141,6 +148,9 @@ Pipeline::removeResolver( Resolver* r )
 
     tDebug() << "Removed resolver:" << r->name();
     d->resolvers.removeAll( r );
+    d->resolverLoad.remove( r );
+    // queries waiting for it may have nothing left to wait for
+    retryOverBudget();
     if ( d->running ) {
         // Only notify if Pipeline is still active.
         emit resolverRemoved( r );
@@ -303,6 +313,38 @@ Pipeline::isResolving( const query_ptr& q ) const
 }
 
 
+unsigned int
+Pipeline::fanOut() const
+{
+    Q_D( const Pipeline );
+    return d->fanOut;
+}
+
+
+void
+Pipeline::setFanOut( unsigned int resolvers )
+{
+    Q_D( Pipeline );
+    d->fanOut = resolvers;
+}
+
+
+unsigned int
+Pipeline::resolverBudget() const
+{
+    Q_D( const Pipeline );
+    return d->resolverBudget;
+}
+
+
+void
+Pipeline::setResolverBudget( unsigned int queries )
+{
+    Q_D( Pipeline );
+    d->resolverBudget = queries;
+}
+
+
 void
 Pipeline::resolve( const query_ptr& q, bool prioritized, bool temporaryQuery )
 {
@@ -324,6 +366,13 @@ Pipeline::resolve( QID qid, bool prioritized, bool temporaryQuery )
 
 void
 Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
+{
+    reportResults( qid, 0, results );
+}
+
+
+void
+Pipeline::reportResults( QID qid, Resolver* r, const QList< result_ptr >& results )
 {
     Q_D( Pipeline );
     if ( !d->running )
@@ -350,30 +399,37 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
     if ( q.isNull() )
         return;
 
+    // in fan-out mode a reply from a resolver we already gave up on must not be counted twice
+    bool countReply = true;
+    if ( d->fanOut != 1 && r )
+        countReply = releaseResolver( q, r );
+
     QList< result_ptr > cleanResults;
     QList< result_ptr > httpResults;
-    foreach ( const result_ptr& r, results )
+    foreach ( const result_ptr& result, results )
     {
-        if ( r.isNull() )
+        if ( result.isNull() )
             continue;
 
-        if ( !r->checked() && ( r->url().startsWith( "http" ) && !r->url().startsWith( "http://localhost" ) ) )
-            httpResults << r;
+        if ( !result->checked() && ( result->url().startsWith( "http" ) && !result->url().startsWith( "http://localhost" ) ) )
+            httpResults << result;
         else
-            cleanResults << r;
+            cleanResults << result;
     }
 
-    const ResultUrlChecker* checker = new ResultUrlChecker( q, httpResults );
+    ResultUrlChecker* checker = new ResultUrlChecker( q, httpResults );
+    checker->setProperty( "countReply", countReply );
     connect( checker, SIGNAL( done() ), SLOT( onResultUrlCheckerDone() ) );
 
     addResultsToQuery( q, cleanResults );
-/*    if ( q->solved() && !q->isFullTextQuery() )
+    if ( d->fanOut != 1 && q->solved() && !q->isFullTextQuery() )
     {
+        // no need to wait for the remaining resolvers
         setQIDState( q, 0 );
         return;
-    }*/
+    }
 
-    if ( httpResults.isEmpty() )
+    if ( httpResults.isEmpty() && countReply )
         decQIDState( q );
 }
 
@@ -411,6 +467,7 @@ Pipeline::addResultsToQuery( const query_ptr& query, const QList< result_ptr >&
 void
 Pipeline::onResultUrlCheckerDone()
 {
+    Q_D( Pipeline );
     ResultUrlChecker* checker = qobject_cast< ResultUrlChecker* >( sender() );
     if ( !checker )
         return;
@@ -419,13 +476,14 @@ Pipeline::onResultUrlCheckerDone()
 
     const query_ptr q = checker->query();
     addResultsToQuery( q, checker->validResults() );
-/*    if ( q && !q->isFullTextQuery() )
+    if ( d->fanOut != 1 && q->solved() && !q->isFullTextQuery() )
     {
         setQIDState( q, 0 );
         return;
-    }*/
+    }
 
-    decQIDState( q );
+    if ( checker->property( "countReply" ).toBool() )
+        decQIDState( q );
 }
 
 
@@ -496,12 +554,11 @@ Pipeline::shuntNext()
     if ( !d->running )
         return;
 
-    unsigned int rc;
-    query_ptr q;
+    QList< query_ptr > batch;
     {
         QMutexLocker lock( &d->mut );
 
-        rc = d->resolvers.count();
+        unsigned int rc = d->resolvers.count();
         if ( d->queries_pending.isEmpty() )
         {
             if ( d->qidsState.isEmpty() )
@@ -515,13 +572,21 @@ Pipeline::shuntNext()
 
         /*
             Since resolvers are async, we now dispatch to the highest weighted ones
-            and after timeout, dispatch to next highest etc, aborting when solved
+            and after timeout, dispatch to next highest etc, aborting when solved.
+            Fill up all free slots at once, so resolvers get to handle them as a batch.
         */
-        q = d->queries_pending.takeFirst();
-        q->setCurrentResolver( 0 );
+        while ( !d->queries_pending.isEmpty() && d->qidsState.count() < d->maxConcurrentQueries )
+        {
+            query_ptr q = d->queries_pending.takeFirst();
+            q->setCurrentResolver( 0 );
+
+            d->qidsTimeout.remove( q->id() );
+            d->qidsState.insert( q->id(), rc );
+            batch << q;
+        }
     }
 
-    setQIDState( q, rc );
+    new FuncTimeout( 0, std::bind( &Pipeline::shuntBatch, this, batch ), this );
 }
 
 
@@ -540,37 +605,88 @@ Pipeline::timeoutShunt( const query_ptr& q )
 }
 
 
+void
+Pipeline::timeoutResolver( const query_ptr& q, Resolver* r )
+{
+    Q_D( Pipeline );
+    if ( !d->running )
+        return;
+
+    // only give up on the resolver if it hasn't replied yet
+    if ( releaseResolver( q, r ) )
+    {
+        tLog( LOGVERBOSE ) << "Resolver timed out:" << q->toString() << q->id();
+        decQIDState( q );
+    }
+}
+
+
 void
 Pipeline::shunt( const query_ptr& q )
+{
+    QList< query_ptr > qlist;
+    qlist << q;
+    shuntBatch( qlist );
+}
+
+
+void
+Pipeline::shuntBatch( const QList< query_ptr >& qlist )
 {
     Q_D( Pipeline );
     if ( !d->running )
         return;
 
-    Resolver* r = 0;
-    if ( !q->resolvingFinished() )
-        r = nextResolver( q );
+    if ( d->fanOut != 1 )
+    {
+        foreach ( const query_ptr& q, qlist )
+            shuntParallel( q );
+        return;
+    }
 
-    if ( r )
+    // group the queries by the resolver they're up next for
+    QList< Resolver* > resolvers;
+    QHash< Resolver*, QList< query_ptr > > batches;
+    foreach ( const query_ptr& q, qlist )
     {
+        Resolver* r = 0;
+        if ( !q->resolvingFinished() )
+            r = nextResolver( q );
+
+        if ( !r )
+        {
+            // we get here if we disable a resolver while a query is resolving
+            setQIDState( q, 0 );
+            continue;
+        }
+
         tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << q->toString() << q->solved() << q->id();
 
         q->setCurrentResolver( r );
-        r->resolve( q );
-        emit resolving( q );
+        if ( !batches.contains( r ) )
+            resolvers << r;
+        batches[ r ] << q;
+    }
 
-        if ( r->timeout() > 0 )
+    if ( resolvers.isEmpty() )
+        return;
+
+    foreach ( Resolver* r, resolvers )
+    {
+        const QList< query_ptr > batch = batches.value( r );
+        r->resolveBatch( batch );
+
+        foreach ( const query_ptr& q, batch )
         {
-            d->qidsTimeout.insert( q->id(), true );
-            new FuncTimeout( r->timeout(), std::bind( &Pipeline::timeoutShunt, this, q ), this );
+            emit resolving( q );
+
+            if ( r->timeout() > 0 )
+            {
+                d->qidsTimeout.insert( q->id(), true );
+                new FuncTimeout( r->timeout(), std::bind( &Pipeline::timeoutShunt, this, q ), this );
+            }
         }
     }
-    else
-    {
-        // we get here if we disable a resolver while a query is resolving
-        setQIDState( q, 0 );
-        return;
-    }
 
     shuntNext();
 }
@@ -601,6 +717,141 @@ Pipeline::nextResolver( const Tomahawk::query_ptr& query ) const
 }
 
 
+void
+Pipeline::shuntParallel( const Tomahawk::query_ptr& query )
+{
+    Q_D( Pipeline );
+
+    QList< Resolver* > dispatch;
+    bool waiting = false;
+    {
+        QMutexLocker lock( &d->mut );
+
+        // the query may have been solved while this shunt was queued
+        if ( !d->qidsState.contains( query->id() ) )
+            return;
+
+        QList< Resolver* >& dispatched = d->qidsDispatched[ query->id() ];
+        if ( !query->resolvingFinished() )
+        {
+            QList< Resolver* > candidates;
+            foreach ( Resolver* r, d->resolvers )
+            {
+                if ( !query->resolvedBy().contains( r ) )
+                    candidates << r;
+            }
+
+            int skipped = 0;
+            while ( !candidates.isEmpty() && ( d->fanOut == 0 || (unsigned int)dispatched.count() < d->fanOut ) )
+            {
+                int best = 0;
+                for ( int i = 1; i < candidates.count(); i++ )
+                {
+                    if ( candidates.at( i )->weight() > candidates.at( best )->weight() )
+                        best = i;
+                }
+
+                Resolver* r = candidates.takeAt( best );
+                if ( d->resolverBudget > 0 && d->resolverLoad.value( r ) >= d->resolverBudget )
+                {
+                    // don't let a busy resolver hold up this query, ask the next one. The busy
+                    // one stays pending, it gets asked on a later shunt.
+                    tLog( LOGVERBOSE ) << "Skipping busy resolver" << r->name() << query->toString() << query->id();
+                    skipped++;
+                    continue;
+                }
+
+                query->setCurrentResolver( r );
+                dispatched << r;
+                d->resolverLoad[ r ]++;
+                dispatch << r;
+            }
+        }
+
+        waiting = !dispatched.isEmpty();
+        if ( !waiting && skipped > 0 )
+        {
+            // nothing in flight to shunt us again, wait for a busy resolver to free up instead
+            if ( !d->queries_overbudget.contains( query ) )
+                d->queries_overbudget << query;
+            return;
+        }
+    }
+
+    foreach ( Resolver* r, dispatch )
+    {
+        tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << query->toString() << query->solved() << query->id();
+
+        r->resolve( query );
+        if ( r->timeout() > 0 )
+            new FuncTimeout( r->timeout(), std::bind( &Pipeline::timeoutResolver, this, query, r ), this );
+    }
+
+    if ( !dispatch.isEmpty() )
+        emit resolving( query );
+
+    if ( !waiting )
+    {
+        // nothing left to ask
+        setQIDState( query, 0 );
+        return;
+    }
+
+    shuntNext();
+}
+
+
+bool
+Pipeline::releaseResolver( const Tomahawk::query_ptr& query, Resolver* r )
+{
+    Q_D( Pipeline );
+    QMutexLocker lock( &d->mut );
+
+    if ( !d->qidsDispatched.contains( query->id() ) )
+        return false;
+
+    if ( !d->qidsDispatched[ query->id() ].removeOne( r ) )
+        return false;
+
+    if ( d->resolverLoad.value( r ) > 0 )
+        d->resolverLoad[ r ]--;
+
+    retryOverBudget();
+    return true;
+}
+
+
+void
+Pipeline::releaseResolvers( const Tomahawk::query_ptr& query )
+{
+    Q_D( Pipeline );
+
+    // caller holds d->mut
+    const QList< Resolver* > dispatched = d->qidsDispatched.take( query->id() );
+    foreach ( Resolver* r, dispatched )
+    {
+        if ( d->resolverLoad.value( r ) > 0 )
+            d->resolverLoad[ r ]--;
+    }
+
+    if ( !dispatched.isEmpty() )
+        retryOverBudget();
+}
+
+
+void
+Pipeline::retryOverBudget()
+{
+    Q_D( Pipeline );
+
+    // caller holds d->mut
+    foreach ( const query_ptr& query, d->queries_overbudget )
+        new FuncTimeout( 0, std::bind( &Pipeline::shunt, this, query ), this );
+
+    d->queries_overbudget.clear();
+}
+
+
 void
 Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
 {
@@ -619,6 +870,8 @@ Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
     else
     {
         d->qidsState.remove( query->id() );
+        d->queries_overbudget.removeAll( query );
+        releaseResolvers( query );
         query->onResolvingFinished();
 
         if ( !d->queries_temporary.contains( query ) )
@@ -55,6 +55,7 @@ public:
     unsigned int activeQueryCount() const;
 
     void reportResults( QID qid, const QList< result_ptr >& results );
+    void reportResults( QID qid, Tomahawk::Resolver* r, const QList< result_ptr >& results );
     void reportAlbums( QID qid, const QList< album_ptr >& albums );
     void reportArtists( QID qid, const QList< artist_ptr >& artists );
 
@@ -73,6 +74,22 @@ public:
 
     bool isResolving( const query_ptr& q ) const;
 
+    /**
+     * Maximum number of resolvers a single query is dispatched to at the same time.
+     * 1 keeps the classic behaviour of asking one resolver after the other by weight,
+     * 0 dispatches to all resolvers at once.
+     */
+    unsigned int fanOut() const;
+    void setFanOut( unsigned int resolvers );
+
+    /**
+     * Maximum number of queries a single resolver may be working on in fan-out mode.
+     * Queries skip resolvers that are at their budget instead of waiting for them.
+     * 0 means unlimited.
+     */
+    unsigned int resolverBudget() const;
+    void setResolverBudget( unsigned int queries );
+
 public slots:
     void resolve( const query_ptr& q, bool prioritized = true, bool temporaryQuery = false );
     void resolve( const QList<query_ptr>& qlist, bool prioritized = true, bool temporaryQuery = false );
@@ -95,7 +112,9 @@ protected:
 
 private slots:
     void timeoutShunt( const query_ptr& q );
+    void timeoutResolver( const query_ptr& q, Tomahawk::Resolver* r );
     void shunt( const query_ptr& q );
+    void shuntBatch( const QList< query_ptr >& qlist );
     void shuntNext();
 
     void onTemporaryQueryTimer();
@@ -106,6 +125,10 @@ private:
 
     void addResultsToQuery( const query_ptr& query, const QList< result_ptr >& results );
     Tomahawk::Resolver* nextResolver( const Tomahawk::query_ptr& query ) const;
+    void shuntParallel( const Tomahawk::query_ptr& query );
+    bool releaseResolver( const Tomahawk::query_ptr& query, Tomahawk::Resolver* r );
+    void releaseResolvers( const Tomahawk::query_ptr& query );
+    void retryOverBudget();
 
     void setQIDState( const Tomahawk::query_ptr& query, int state );
     int incQIDState( const Tomahawk::query_ptr& query );
@@ -34,6 +34,8 @@ class PipelinePrivate
 public:
     PipelinePrivate( Pipeline* q )
         : q_ptr( q )
+        , fanOut( 1 )
+        , resolverBudget( 0 )
         , running( false )
     {
     }
@@ -50,6 +52,12 @@ private:
     QMap< QID, query_ptr > qids;
     QMap< RID, result_ptr > rids;
 
+    // fan-out mode: resolvers each query is waiting for and the number of queries per resolver
+    QHash< QID, QList< Resolver* > > qidsDispatched;
+    QHash< Resolver*, unsigned int > resolverLoad;
+    // fan-out mode: queries whose remaining resolvers are all over budget, shunted again once one frees up
+    QList< query_ptr > queries_overbudget;
+
     QMutex mut; // for m_qids, m_rids
 
     // store queries here until DB index is loaded, then shunt them all
@@ -58,6 +66,8 @@ private:
     QList< query_ptr > queries_temporary;
 
     int maxConcurrentQueries;
+    unsigned int fanOut;
+    unsigned int resolverBudget;
     bool running;
     QTimer temporaryQueryTimer;
 
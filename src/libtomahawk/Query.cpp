@@ -124,8 +124,12 @@ Query::Query( const track_ptr& track, const result_ptr& result )
 Query::Query( const QString& query, const QID& qid )
     : d_ptr( new QueryPrivate( this, query, qid ) )
 {
+    Q_D( Query );
     init();
 
+    d->fullTextSortname = DatabaseImpl::sortname( query );
+    d->fullTextArtistSortname = DatabaseImpl::sortname( query, true );
+
     if ( !qid.isEmpty() )
     {
         connect( Database::instance(), SIGNAL( indexReady() ), SLOT( refreshResults() ), Qt::QueuedConnection );
@@ -278,6 +282,11 @@ Query::removeResult( const Tomahawk::result_ptr& result )
         QMutexLocker lock( &d->mutex );
         d->results.removeAll( result );
     }
+    {
+        Q_D( Query );
+        QMutexLocker lock( &d->similarityMutex );
+        d->similarities.remove( result->id() );
+    }
 
     emit resultsRemoved( result );
     checkResults();
@@ -297,6 +306,10 @@ Query::clearResults()
         QMutexLocker lock( &d->mutex );
         d->results.clear();
     }
+    {
+        QMutexLocker lock( &d->similarityMutex );
+        d->similarities.clear();
+    }
 
     emit playableStateChanged( false );
     emit solvedStateChanged( false );
@@ -622,27 +635,41 @@ float
 Query::howSimilar( const Tomahawk::result_ptr& r )
 {
     Q_D( Query );
-    // result values
-    const QString& rArtistname = r->track()->artistSortname();
-    const QString& rAlbumname  = r->track()->albumSortname();
-    const QString& rTrackname  = r->track()->trackSortname();
-    QString qArtistname;
-    QString qAlbumname;
-    QString qTrackname;
+    const QString rid = r->id();
+    const Tomahawk::Track* track = r->track().data();
 
-    if ( isFullTextQuery() )
     {
-        qArtistname = DatabaseImpl::sortname( d->fullTextQuery, true );
-        qAlbumname = DatabaseImpl::sortname( d->fullTextQuery );
-        qTrackname = qAlbumname;
+        QMutexLocker lock( &d->similarityMutex );
+        QHash< QString, QPair< const Tomahawk::Track*, float > >::const_iterator it = d->similarities.constFind( rid );
+        if ( it != d->similarities.constEnd() && it.value().first == track )
+            return it.value().second;
     }
-    else
+
+    const float score = calculateSimilarity( r );
+
     {
-        qArtistname = queryTrack()->artistSortname();
-        qAlbumname  = queryTrack()->albumSortname();
-        qTrackname  = queryTrack()->trackSortname();
+        QMutexLocker lock( &d->similarityMutex );
+        d->similarities.insert( rid, QPair< const Tomahawk::Track*, float >( track, score ) );
     }
 
+    return score;
+}
+
+
+float
+Query::calculateSimilarity( const Tomahawk::result_ptr& r ) const
+{
+    Q_D( const Query );
+    // result values
+    const QString& rArtistname = r->track()->artistSortname();
+    const QString& rAlbumname  = r->track()->albumSortname();
+    const QString& rTrackname  = r->track()->trackSortname();
+
+    const bool fullText = isFullTextQuery();
+    const QString& qArtistname = fullText ? d->fullTextArtistSortname : queryTrack()->artistSortname();
+    const QString& qAlbumname  = fullText ? d->fullTextSortname : queryTrack()->albumSortname();
+    const QString& qTrackname  = fullText ? d->fullTextSortname : queryTrack()->trackSortname();
+
     // normal edit distance
     const int artdist = TomahawkUtils::levenshtein( qArtistname, rArtistname );
     const int trkdist = TomahawkUtils::levenshtein( qTrackname, rTrackname );
@@ -664,9 +691,9 @@ Query::howSimilar( const Tomahawk::result_ptr& r )
         dcalb = (float)( mlalb - albdist ) / mlalb;
     }
 
-    if ( isFullTextQuery() )
+    if ( fullText )
     {
-        const QString artistTrackname = DatabaseImpl::sortname( fullTextQuery() );
+        const QString& artistTrackname = d->fullTextSortname;
         const QString rArtistTrackname = DatabaseImpl::sortname( r->track()->artist() + " " + r->track()->track() );
 
         const int atrdist = TomahawkUtils::levenshtein( artistTrackname, rArtistTrackname );
@@ -159,6 +159,8 @@ private:
     void setCurrentResolver( Tomahawk::Resolver* resolver );
     void clearResults();
     void checkResults();
+
+    float calculateSimilarity( const Tomahawk::result_ptr& r ) const;
 };
 
 } //ns
@@ -3,7 +3,9 @@
 
 #include "Query.h"
 
+#include <QHash>
 #include <QMutex>
+#include <QPair>
 
 namespace Tomahawk
 {
@@ -48,6 +50,13 @@ private:
     mutable QID qid;
 
     QString fullTextQuery;
+    // sortnames of the full-text query, so howSimilar() doesn't recalculate them for every result
+    QString fullTextSortname;
+    QString fullTextArtistSortname;
+
+    // similarity score for each result id, along with the track it was calculated for
+    QHash< QString, QPair< const Tomahawk::Track*, float > > similarities;
+    mutable QMutex similarityMutex;
 
     QString resultHint;
     bool saveResultHint;
@@ -31,7 +31,6 @@
 #include "database/DatabaseCommand_LoadAllSources.h"
 #include "database/DatabaseCommand_SocialAction.h"
 #include "database/DatabaseCommand_SourceOffline.h"
-#include "database/DatabaseCommand_UpdateSearchIndex.h"
 #include "database/DatabaseImpl.h"
 #include "database/Database.h"
 #include "utils/Logger.h"
@@ -778,17 +777,11 @@ Source::reportSocialAttributesChanged( DatabaseCommand_SocialAction* action )
 void
 Source::updateTracks()
 {
-    {
-        DatabaseCommand* cmd = new DatabaseCommand_UpdateSearchIndex();
-        Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
-    }
-
-    {
-        // Re-calculate local db stats
-        DatabaseCommand_CollectionStats* cmd = new DatabaseCommand_CollectionStats( SourceList::instance()->get( id() ) );
-        connect( cmd, SIGNAL( done( QVariantMap ) ), SLOT( setStats( QVariantMap ) ), Qt::QueuedConnection );
-        Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
-    }
+    // The search index is kept up to date by DatabaseCommand_AddFiles / _DeleteFiles,
+    // so we only need to re-calculate local db stats
+    DatabaseCommand_CollectionStats* cmd = new DatabaseCommand_CollectionStats( SourceList::instance()->get( id() ) );
+    connect( cmd, SIGNAL( done( QVariantMap ) ), SLOT( setStats( QVariantMap ) ), Qt::QueuedConnection );
+    Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
 }
 
 
@@ -702,6 +702,118 @@ TomahawkSettings::acceptedLegalWarning() const
 }
 
 
+uint
+TomahawkSettings::databaseGroupCommitSize() const
+{
+    return value( "database/groupcommitsize", 32 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setDatabaseGroupCommitSize( uint commands )
+{
+    setValue( "database/groupcommitsize", commands );
+}
+
+
+uint
+TomahawkSettings::databaseGroupCommitLatency() const
+{
+    return value( "database/groupcommitlatency", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setDatabaseGroupCommitLatency( uint msecs )
+{
+    setValue( "database/groupcommitlatency", msecs );
+}
+
+
+bool
+TomahawkSettings::databaseWalMode() const
+{
+    return value( "database/walmode", true ).toBool();
+}
+
+
+void
+TomahawkSettings::setDatabaseWalMode( bool enable )
+{
+    setValue( "database/walmode", enable );
+}
+
+
+uint
+TomahawkSettings::databaseWalAutoCheckpoint() const
+{
+    return value( "database/walautocheckpoint", 1000 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setDatabaseWalAutoCheckpoint( uint pages )
+{
+    setValue( "database/walautocheckpoint", pages );
+}
+
+
+uint
+TomahawkSettings::databaseCacheSize() const
+{
+    return value( "database/cachesize", 8192 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setDatabaseCacheSize( uint kib )
+{
+    setValue( "database/cachesize", kib );
+}
+
+
+uint
+TomahawkSettings::databaseMmapSize() const
+{
+    return value( "database/mmapsize", 64 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setDatabaseMmapSize( uint mib )
+{
+    setValue( "database/mmapsize", mib );
+}
+
+
+uint
+TomahawkSettings::resolverFanOut() const
+{
+    return value( "pipeline/fanout", 1 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setResolverFanOut( uint resolvers )
+{
+    setValue( "pipeline/fanout", resolvers );
+}
+
+
+uint
+TomahawkSettings::resolverQueryBudget() const
+{
+    return value( "pipeline/resolverbudget", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setResolverQueryBudget( uint queries )
+{
+    setValue( "pipeline/resolverbudget", queries );
+}
+
+
 void
 TomahawkSettings::setInfoSystemCacheVersion( uint version )
 {
@@ -1027,6 +1139,76 @@ TomahawkSettings::setProxyDns( bool lookupViaProxy )
 }
 
 
+uint
+TomahawkSettings::streamChunkSize() const
+{
+    return value( "network/streamchunksize", 64 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setStreamChunkSize( uint kib )
+{
+    setValue( "network/streamchunksize", kib );
+}
+
+
+uint
+TomahawkSettings::streamUploadRate() const
+{
+    return value( "network/streamuploadrate", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setStreamUploadRate( uint kibPerSec )
+{
+    setValue( "network/streamuploadrate", kibPerSec );
+}
+
+
+uint
+TomahawkSettings::streamCacheSize() const
+{
+    return value( "network/streamcachesize", 1024 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setStreamCacheSize( uint mib )
+{
+    setValue( "network/streamcachesize", mib );
+}
+
+
+bool
+TomahawkSettings::streamChannels() const
+{
+    return value( "network/streamchannels", true ).toBool();
+}
+
+
+void
+TomahawkSettings::setStreamChannels( bool enabled )
+{
+    setValue( "network/streamchannels", enabled );
+}
+
+
+int
+TomahawkSettings::msgCompressionLevel() const
+{
+    return value( "network/compressionlevel", 3 ).toInt();
+}
+
+
+void
+TomahawkSettings::setMsgCompressionLevel( int level )
+{
+    setValue( "network/compressionlevel", level );
+}
+
+
 QVariantList
 TomahawkSettings::aclEntries() const
 {
@@ -1221,6 +1403,20 @@ TomahawkSettings::setShuffleState( const QString& playlistid, bool state)
 }
 
 
+bool
+TomahawkSettings::smartShuffle() const
+{
+    return value( "playlists/smartshuffle", false ).toBool();
+}
+
+
+void
+TomahawkSettings::setSmartShuffle( bool enabled )
+{
+    setValue( "playlists/smartshuffle", enabled );
+}
+
+
 void
 TomahawkSettings::removePlaylistSettings( const QString& playlistid )
 {
@@ -77,6 +77,26 @@ public:
     bool acceptedLegalWarning() const;
     void setAcceptedLegalWarning( bool accept );
 
+    /// Database settings
+    uint databaseGroupCommitSize() const; /// max. mutating commands sharing a transaction, 1 disables group commits
+    void setDatabaseGroupCommitSize( uint commands );
+    uint databaseGroupCommitLatency() const; /// ms to wait for more commands before committing, 0 by default
+    void setDatabaseGroupCommitLatency( uint msecs );
+    bool databaseWalMode() const; /// true by default
+    void setDatabaseWalMode( bool enable );
+    uint databaseWalAutoCheckpoint() const; /// in pages, 1000 by default
+    void setDatabaseWalAutoCheckpoint( uint pages );
+    uint databaseCacheSize() const; /// per connection in KiB, 8 MiB by default
+    void setDatabaseCacheSize( uint kib );
+    uint databaseMmapSize() const; /// per connection in MiB, 64 by default, 0 disables mmap
+    void setDatabaseMmapSize( uint mib );
+
+    /// Resolver pipeline settings
+    uint resolverFanOut() const; /// 1 by default: one resolver at a time, 0 dispatches to all resolvers at once
+    void setResolverFanOut( uint resolvers );
+    uint resolverQueryBudget() const; /// 0 by default: no limit on queries in flight per resolver
+    void setResolverQueryBudget( uint queries );
+
     /// UI settings
     QByteArray mainWindowGeometry() const;
     void setMainWindowGeometry( const QByteArray& geom );
@@ -116,6 +136,8 @@ public:
 
     bool shuffleState( const QString& playlistid ) const;
     void setShuffleState( const QString& playlistid, bool state );
+    bool smartShuffle() const; /// false by default: shuffling favours tracks that were played less often
+    void setSmartShuffle( bool enabled );
     Tomahawk::PlaylistModes::RepeatMode repeatMode( const QString& playlistid );
     void setRepeatMode( const QString& playlistid, Tomahawk::PlaylistModes::RepeatMode mode );
 
@@ -188,6 +210,17 @@ public:
     bool proxyDns() const;
     void setProxyDns( bool lookupViaProxy );
 
+    uint streamChunkSize() const; /// in KiB, 64 by default: max. audio data per message we stream to peers
+    void setStreamChunkSize( uint kib );
+    uint streamUploadRate() const; /// in KiB/s per stream, 0 by default: unlimited
+    void setStreamUploadRate( uint kibPerSec );
+    uint streamCacheSize() const; /// in MiB, 1024 by default: disk space for tracks streamed from peers, 0 disables the cache
+    void setStreamCacheSize( uint mib );
+    bool streamChannels() const; /// true by default: run all streams with a peer over one connection, if the peer supports it
+    void setStreamChannels( bool enabled );
+    int msgCompressionLevel() const; /// zlib level for large peer msgs, 3 by default, 0 disables compression
+    void setMsgCompressionLevel( int level );
+
     /// ACL settings
     QVariantList aclEntries() const;
     void setAclEntries( const QVariantList& entries );
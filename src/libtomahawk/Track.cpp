@@ -666,11 +666,12 @@ Track::composerPtr() const
 QPixmap
 Track::cover( const QSize& size, bool forceLoad ) const
 {
-    albumPtr()->cover( size, forceLoad );
+    const QPixmap cover = albumPtr()->cover( size, forceLoad );
     if ( albumPtr()->coverLoaded() )
     {
-        if ( !albumPtr()->cover( size ).isNull() )
-            return albumPtr()->cover( size );
+        // the album's cover might still be scaling, don't show the artist's meanwhile
+        if ( albumPtr()->hasCover() )
+            return cover;
 
         return artistPtr()->cover( size, forceLoad );
     }
@@ -686,13 +687,22 @@ Track::coverLoaded() const
     if ( d->albumPtr.isNull() )
         return false;
 
-    if ( d->albumPtr->coverLoaded() && !d->albumPtr->cover( QSize( 0, 0 ) ).isNull() )
+    if ( d->albumPtr->coverLoaded() && d->albumPtr->hasCover() )
         return true;
 
     return d->artistPtr->coverLoaded();
 }
 
 
+void
+Track::loadCover( bool visible ) const
+{
+    albumPtr()->loadCover( visible );
+    if ( albumPtr()->coverLoaded() && !albumPtr()->hasCover() )
+        artistPtr()->loadCover( visible );
+}
+
+
 QList<Tomahawk::query_ptr>
 Track::similarTracks() const
 {
@@ -90,6 +90,8 @@ public:
 
     QPixmap cover( const QSize& size, bool forceLoad = true ) const;
     bool coverLoaded() const;
+    /// Fetches the cover without decoding it. Covers that are @p visible get fetched first.
+    void loadCover( bool visible = false ) const;
 
     void setLoved( bool loved, bool postToInfoSystem = true );
     bool loved();
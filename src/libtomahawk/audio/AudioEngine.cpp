@@ -1040,8 +1040,25 @@ AudioEngine::onPlaylistNextTrackAvailable()
 void
 AudioEngine::onAboutToFinish()
 {
+    Q_D( AudioEngine );
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
-    d_func()->expectStop = true;
+    d->expectStop = true;
+
+    // Get a peer's track going before we need it, same order as in loadNextTrack()
+    Tomahawk::result_ptr next;
+    if ( d->queue && d->queue->trackCount() )
+    {
+        query_ptr query = d->queue->tracks().first();
+        if ( query && query->numResults() )
+            next = query->results().first();
+    }
+    else if ( !d->playlist.isNull() )
+    {
+        next = d->playlist.data()->nextResult();
+    }
+
+    if ( next && next != d->currentTrack && next->isOnline() )
+        Servent::instance()->prefetchStream( next );
 }
 
 void
@@ -27,6 +27,7 @@
 #include "DatabaseWorker.h"
 #include "IdThreadWorker.h"
 #include "PlaylistEntry.h"
+#include "TomahawkSettings.h"
 
 #include "DatabaseCommand_AddFiles.h"
 #include "DatabaseCommand_CreatePlaylist.h"
@@ -90,6 +91,8 @@ Database::Database( const QString& dbname, QObject* parent )
     , m_impl( new DatabaseImpl( dbname ) )
     , m_workerRW( new DatabaseWorkerThread( this, true ) )
     , m_idWorker( new IdThreadWorker( this ) )
+    , m_groupCommitSize( 1 )
+    , m_groupCommitLatency( 0 )
 {
     s_instance = this;
 
@@ -116,6 +119,12 @@ Database::Database( const QString& dbname, QObject* parent )
 
     tDebug() << Q_FUNC_INFO << "Using" << m_maxConcurrentThreads << "database worker threads";
 
+    if ( TomahawkSettings::instance() )
+    {
+        m_groupCommitSize = qMax( 1, (int)TomahawkSettings::instance()->databaseGroupCommitSize() );
+        m_groupCommitLatency = TomahawkSettings::instance()->databaseGroupCommitLatency();
+    }
+
     connect( m_impl, SIGNAL( indexReady() ), SLOT( markAsReady() ) );
     connect( m_impl, SIGNAL( indexStarted() ), SIGNAL( indexStarted() ) );
     connect( m_impl, SIGNAL( indexReady() ), SIGNAL( indexReady() ) );
@@ -173,6 +182,7 @@ Database::~Database()
 
     qDeleteAll( m_implHash.values() );
     qDeleteAll( m_commandFactories.values() );
+    m_impl->checkpoint();
     delete m_impl;
 
     emit workersFinished();
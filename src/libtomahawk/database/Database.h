@@ -87,6 +87,14 @@ public:
 
     DatabaseImpl* impl();
 
+    /**
+     * Group commits: the RW worker applies up to groupCommitSize() queued mutating
+     * commands in a single transaction, waiting at most groupCommitLatency() ms for
+     * more commands to arrive.
+     */
+    int groupCommitSize() const { return m_groupCommitSize; }
+    int groupCommitLatency() const { return m_groupCommitLatency; }
+
     dbcmd_ptr createCommandInstance( const QVariant& op, const Tomahawk::source_ptr& source );
 
     // Template implementations need to stay in header!
@@ -131,6 +139,8 @@ private:
     QList< QPointer< DatabaseWorkerThread > > m_workerThreads;
     IdThreadWorker* m_idWorker;
     int m_maxConcurrentThreads;
+    int m_groupCommitSize;
+    int m_groupCommitLatency;
 
     QHash< QString, DatabaseCommandFactory* > m_commandFactories;
     QHash< QString, QString> m_commandNameClassNameMapping;
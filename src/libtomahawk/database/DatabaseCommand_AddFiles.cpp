@@ -27,14 +27,33 @@
 #include "Album.h"
 #include "Artist.h"
 #include "DatabaseImpl.h"
+#include "DatabaseCommand_UpdateSearchIndex.h"
+#include "fuzzyindex/DatabaseFuzzyIndex.h"
 #include "PlaylistEntry.h"
 #include "SourceList.h"
 
 #include <QSqlQuery>
+#include <QTime>
+
+// SQLite's default SQLITE_MAX_VARIABLE_NUMBER
+#define MAX_SQL_VARIABLES 999
+// Batches at least this big may rebuild secondary indexes after inserting
+#define BULK_INDEX_THRESHOLD 1000
 
 using namespace Tomahawk;
 
 
+static QString
+placeholders( int count )
+{
+    QStringList list;
+    for ( int i = 0; i < count; i++ )
+        list << "?";
+
+    return list.join( ", " );
+}
+
+
 // remove file paths when making oplog/for network transmission
 QVariantList
 DatabaseCommand_AddFiles::files() const
@@ -65,6 +84,10 @@ DatabaseCommand_AddFiles::postCommitHook()
 
     emit notify( m_ids );
 
+    // Not before committing, a rolled back batch must not end up in the index.
+    // Files with these tracks may have been deleted before, so (re-)index all of them.
+    Database::instance()->impl()->m_fuzzyIndex->updateEntries( m_indexEntries );
+
     if ( source()->isLocal() )
         Servent::instance()->triggerDBSync();
 }
@@ -76,13 +99,50 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
     qDebug() << Q_FUNC_INFO;
     Q_ASSERT( !source().isNull() );
 
-    TomahawkSqlQuery query_file = dbi->newquery();
-    TomahawkSqlQuery query_filejoin = dbi->newquery();
-    TomahawkSqlQuery query_trackattr = dbi->newquery();
+    QTime timer;
+    timer.start();
+
+    // Resolve every artist name of this batch with a handful of queries up front
+    QSet< QString > artists;
+    foreach ( const QVariant& v, m_files )
+    {
+        const QVariantMap m = v.toMap();
+        foreach ( const QString& key, QStringList() << "artist" << "albumartist" << "composer" )
+        {
+            const QString name = m.value( key ).toString();
+            if ( !name.trimmed().isEmpty() )
+                artists << DatabaseImpl::sortname( name );
+        }
+    }
+    preloadArtists( dbi, artists );
+    preloadTracksAndAlbums( dbi );
 
+    // When this batch makes up most of the collection (e.g. the initial scan of a
+    // large library), rebuilding the secondary indexes once is cheaper than
+    // maintaining them for every single row.
+    const bool defer = deferIndexes( dbi );
+    if ( defer )
+    {
+        tDebug() << "Deferring file_join and track_attributes index maintenance for" << m_files.length() << "files";
+        TomahawkSqlQuery query = dbi->newquery();
+        query.exec( "DROP INDEX IF EXISTS file_join_track" );
+        query.exec( "DROP INDEX IF EXISTS file_join_artist" );
+        query.exec( "DROP INDEX IF EXISTS file_join_album" );
+        query.exec( "DROP INDEX IF EXISTS track_attrib_id" );
+        query.exec( "DROP INDEX IF EXISTS track_attrib_k" );
+    }
+
+    TomahawkSqlQuery query_file = dbi->newquery();
     query_file.prepare( "INSERT INTO file(source, url, size, mtime, md5, mimetype, duration, bitrate) VALUES (?, ?, ?, ?, ?, ?, ?, ?)" );
-    query_filejoin.prepare( "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber) VALUES (?, ?, ?, ?, ?, ?, ?)" );
-    query_trackattr.prepare( "INSERT INTO track_attributes(id, k, v) VALUES (?, ?, ?)" );
+
+    const QString filejoinHead = "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber)";
+    const QString trackattrHead = "INSERT INTO track_attributes(id, k, v)";
+    QVariantList filejoinValues, trackattrValues;
+    // Files whose file_join row couldn't be inserted
+    QSet< int > skippedFiles;
+
+    // Tracks and albums of this batch, for updating the search index
+    QSet< int > indexedTracks, indexedAlbums;
 
     int added = 0;
     QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
@@ -133,46 +193,285 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
 
         // add the album artist to the artist database.
         if ( !albumartist.trimmed().isEmpty() )
-            albumartistid = dbi->artistId( albumartist, true );
-        
+            albumartistid = artistId( dbi, albumartist );
+
         if ( !artist.trimmed().isEmpty() )
-            artistid = dbi->artistId( artist, true );
+            artistid = artistId( dbi, artist );
         if ( artistid < 1 )
             continue;
-        trackid = dbi->trackId( artistid, track, true );
+        trackid = trackId( dbi, artistid, track );
         if ( trackid < 1 )
             continue;
         // If there's an album artist, use it. Otherwise use the track artist
-        albumid = dbi->albumId( albumartistid > 0 ? albumartistid : artistid, album, true );
+        albumid = albumId( dbi, albumartistid > 0 ? albumartistid : artistid, album );
 
         if ( !composer.trimmed().isEmpty() )
-            composerid = dbi->artistId( composer, true );
+            composerid = artistId( dbi, composer );
 
         // Now add the association
-        query_filejoin.bindValue( 0, fileid );
-        query_filejoin.bindValue( 1, artistid );
-        query_filejoin.bindValue( 2, albumid > 0 ? albumid : QVariant( QVariant::Int ) );
-        query_filejoin.bindValue( 3, trackid );
-        query_filejoin.bindValue( 4, albumpos );
-        query_filejoin.bindValue( 5, composerid > 0 ? composerid : QVariant( QVariant::Int ) );
-        query_filejoin.bindValue( 6, discnumber );
-        if ( !query_filejoin.exec() )
+        filejoinValues << fileid
+                       << artistid
+                       << ( albumid > 0 ? albumid : QVariant( QVariant::Int ) )
+                       << trackid
+                       << albumpos
+                       << ( composerid > 0 ? composerid : QVariant( QVariant::Int ) )
+                       << discnumber;
+
+        trackattrValues << trackid << QString( "releaseyear" ) << year;
+
+        if ( !indexedTracks.contains( trackid ) )
         {
-            qDebug() << "Error inserting into file_join table";
-            continue;
+            indexedTracks << trackid;
+
+            IndexData ida;
+            ida.id = trackid;
+            ida.artistId = artistid;
+            ida.artist = artist;
+            ida.track = track;
+            m_indexEntries << ida;
         }
+        if ( albumid > 0 && !indexedAlbums.contains( albumid ) )
+        {
+            indexedAlbums << albumid;
 
-        query_trackattr.bindValue( 0, trackid );
-        query_trackattr.bindValue( 1, "releaseyear" );
-        query_trackattr.bindValue( 2, year );
-        query_trackattr.exec();
+            IndexData ida;
+            ida.id = albumid;
+            ida.artistId = 0;
+            ida.album = album;
+            m_indexEntries << ida;
+        }
+
+        if ( filejoinValues.count() >= MAX_SQL_VARIABLES )
+        {
+            foreach ( const QVariant& id, insertRows( dbi, filejoinHead, 7, filejoinValues ) )
+                skippedFiles << id.toInt();
+            filejoinValues.clear();
+        }
+        if ( trackattrValues.count() >= MAX_SQL_VARIABLES )
+        {
+            insertRows( dbi, trackattrHead, 3, trackattrValues );
+            trackattrValues.clear();
+        }
 
         m_ids << fileid;
         added++;
     }
 
-    qDebug() << "Inserted" << added << "tracks to database";
+    foreach ( const QVariant& id, insertRows( dbi, filejoinHead, 7, filejoinValues ) )
+        skippedFiles << id.toInt();
+    // a missing release year isn't worth dropping a file for
+    insertRows( dbi, trackattrHead, 3, trackattrValues );
+
+    if ( !skippedFiles.isEmpty() )
+    {
+        // Files without their file_join row would be announced but never show up, drop them
+        tLog() << "Dropping" << skippedFiles.count() << "files that could not be added";
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( "DELETE FROM file WHERE id = ?" );
+
+        QVariantList files;
+        foreach ( const QVariant& v, m_files )
+        {
+            const int id = v.toMap().value( "id" ).toInt();
+            if ( skippedFiles.contains( id ) )
+            {
+                query.bindValue( 0, id );
+                query.exec();
+                continue;
+            }
+
+            files << v;
+        }
+        m_files = files;
+
+        QList<unsigned int> ids;
+        foreach ( unsigned int id, m_ids )
+        {
+            if ( !skippedFiles.contains( id ) )
+                ids << id;
+        }
+        m_ids = ids;
+        added -= skippedFiles.count();
+    }
+
+    if ( defer )
+    {
+        // Same definitions as in Schema.sql
+        TomahawkSqlQuery query = dbi->newquery();
+        query.exec( "CREATE INDEX IF NOT EXISTS file_join_track  ON file_join(track)" );
+        query.exec( "CREATE INDEX IF NOT EXISTS file_join_artist ON file_join(artist)" );
+        query.exec( "CREATE INDEX IF NOT EXISTS file_join_album  ON file_join(album)" );
+        query.exec( "CREATE INDEX IF NOT EXISTS track_attrib_id ON track_attributes(id)" );
+        query.exec( "CREATE INDEX IF NOT EXISTS track_attrib_k  ON track_attributes(k)" );
+    }
+
+    const int elapsed = qMax( 1, timer.elapsed() );
+    tLog() << "Inserted" << added << "tracks to database in" << elapsed << "ms"
+           << "(" << (int)( added * 1000.0 / elapsed ) << "rows/sec )";
     tDebug() << "Committing" << added << "tracks...";
 
     emit done( m_files, source()->dbCollection() );
 }
+
+
+void
+DatabaseCommand_AddFiles::preloadArtists( DatabaseImpl* dbi, const QSet< QString >& sortnames )
+{
+    const QStringList names = sortnames.toList();
+    for ( int i = 0; i < names.count(); i += MAX_SQL_VARIABLES )
+    {
+        const QStringList chunk = names.mid( i, MAX_SQL_VARIABLES );
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( QString( "SELECT id, sortname FROM artist WHERE sortname IN (%1)" ).arg( placeholders( chunk.count() ) ) );
+        foreach ( const QString& sortname, chunk )
+            query.addBindValue( sortname );
+        query.exec();
+
+        while ( query.next() )
+            m_artistIds.insert( query.value( 1 ).toString(), query.value( 0 ).toInt() );
+    }
+}
+
+
+void
+DatabaseCommand_AddFiles::preloadTracksAndAlbums( DatabaseImpl* dbi )
+{
+    const QList< int > artistIds = m_artistIds.values();
+    for ( int i = 0; i < artistIds.count(); i += MAX_SQL_VARIABLES )
+    {
+        const QList< int > chunk = artistIds.mid( i, MAX_SQL_VARIABLES );
+        const QString in = placeholders( chunk.count() );
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( QString( "SELECT id, artist, sortname FROM track WHERE artist IN (%1)" ).arg( in ) );
+        foreach ( int id, chunk )
+            query.addBindValue( id );
+        query.exec();
+
+        while ( query.next() )
+            m_trackIds.insert( qMakePair( query.value( 1 ).toInt(), query.value( 2 ).toString() ), query.value( 0 ).toInt() );
+
+        query.prepare( QString( "SELECT id, artist, sortname FROM album WHERE artist IN (%1)" ).arg( in ) );
+        foreach ( int id, chunk )
+            query.addBindValue( id );
+        query.exec();
+
+        while ( query.next() )
+            m_albumIds.insert( qMakePair( query.value( 1 ).toInt(), query.value( 2 ).toString() ), query.value( 0 ).toInt() );
+    }
+}
+
+
+int
+DatabaseCommand_AddFiles::artistId( DatabaseImpl* dbi, const QString& name )
+{
+    const QString sortname = DatabaseImpl::sortname( name );
+    QHash< QString, int >::const_iterator it = m_artistIds.constFind( sortname );
+    if ( it != m_artistIds.constEnd() )
+        return it.value();
+
+    // Not preloaded, so it does not exist yet: let DatabaseImpl create it
+    const int id = dbi->artistId( name, true );
+    if ( id > 0 )
+        m_artistIds.insert( sortname, id );
+
+    return id;
+}
+
+
+int
+DatabaseCommand_AddFiles::trackId( DatabaseImpl* dbi, int artistid, const QString& name )
+{
+    const QPair< int, QString > key( artistid, DatabaseImpl::sortname( name ) );
+    QHash< QPair< int, QString >, int >::const_iterator it = m_trackIds.constFind( key );
+    if ( it != m_trackIds.constEnd() )
+        return it.value();
+
+    const int id = dbi->trackId( artistid, name, true );
+    if ( id > 0 )
+        m_trackIds.insert( key, id );
+
+    return id;
+}
+
+
+int
+DatabaseCommand_AddFiles::albumId( DatabaseImpl* dbi, int artistid, const QString& name )
+{
+    if ( name.isEmpty() )
+        return 0;
+
+    const QPair< int, QString > key( artistid, DatabaseImpl::sortname( name ) );
+    QHash< QPair< int, QString >, int >::const_iterator it = m_albumIds.constFind( key );
+    if ( it != m_albumIds.constEnd() )
+        return it.value();
+
+    const int id = dbi->albumId( artistid, name, true );
+    if ( id > 0 )
+        m_albumIds.insert( key, id );
+
+    return id;
+}
+
+
+bool
+DatabaseCommand_AddFiles::deferIndexes( DatabaseImpl* dbi ) const
+{
+    if ( m_files.count() < BULK_INDEX_THRESHOLD )
+        return false;
+
+    // file_join.file is the rowid, so this is a cheap upper bound of its size
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( "SELECT max(file) FROM file_join" );
+    if ( !query.next() )
+        return true;
+
+    return m_files.count() >= query.value( 0 ).toInt();
+}
+
+
+QVariantList
+DatabaseCommand_AddFiles::insertRows( DatabaseImpl* dbi, const QString& head, int columns, const QVariantList& values )
+{
+    QVariantList skipped;
+    const int rowsPerStatement = MAX_SQL_VARIABLES / columns;
+    const QString row = QString( "(%1)" ).arg( placeholders( columns ) );
+
+    for ( int i = 0; i < values.count(); i += rowsPerStatement * columns )
+    {
+        const int rows = qMin( rowsPerStatement, ( values.count() - i ) / columns );
+
+        QStringList rowList;
+        for ( int j = 0; j < rows; j++ )
+            rowList << row;
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( QString( "%1 VALUES %2" ).arg( head ).arg( rowList.join( ", " ) ) );
+        for ( int j = i; j < i + rows * columns; j++ )
+            query.addBindValue( values.at( j ) );
+
+        if ( query.exec() )
+            continue;
+
+        // One bad row fails the whole statement, insert them one by one to only lose that one
+        tDebug() << "Error inserting" << rows << "rows, retrying one by one:" << head;
+
+        TomahawkSqlQuery single = dbi->newquery();
+        single.prepare( QString( "%1 VALUES %2" ).arg( head ).arg( row ) );
+        for ( int j = i; j < i + rows * columns; j += columns )
+        {
+            for ( int k = 0; k < columns; k++ )
+                single.bindValue( k, values.at( j + k ) );
+
+            if ( !single.exec() )
+            {
+                tLog() << "Skipping row that could not be inserted:" << head << values.mid( j, columns );
+                skipped << values.at( j );
+            }
+        }
+    }
+
+    return skipped;
+}
@@ -19,10 +19,14 @@
 #ifndef DATABASECOMMAND_ADDFILES_H
 #define DATABASECOMMAND_ADDFILES_H
 
+#include <QHash>
 #include <QObject>
+#include <QPair>
+#include <QSet>
 #include <QVariantMap>
 
 #include "database/DatabaseCommandLoggable.h"
+#include "database/DatabaseCommand_UpdateSearchIndex.h"
 #include "Typedefs.h"
 #include "Query.h"
 
@@ -61,8 +65,26 @@ signals:
     void notify( const QList<unsigned int>& ids );
 
 private:
+    // Bulk import helpers: name -> id lookups are served from hash tables
+    // preloaded for the whole batch instead of one SELECT per file.
+    void preloadArtists( DatabaseImpl* dbi, const QSet< QString >& sortnames );
+    void preloadTracksAndAlbums( DatabaseImpl* dbi );
+    int artistId( DatabaseImpl* dbi, const QString& name );
+    int trackId( DatabaseImpl* dbi, int artistid, const QString& name );
+    int albumId( DatabaseImpl* dbi, int artistid, const QString& name );
+
+    bool deferIndexes( DatabaseImpl* dbi ) const;
+    /// Returns the first column of the rows that couldn't be inserted
+    static QVariantList insertRows( DatabaseImpl* dbi, const QString& head, int columns, const QVariantList& values );
+
     QVariantList m_files;
     QList<unsigned int> m_ids;
+    // Applied to the fuzzy index once the files are committed
+    QList< Tomahawk::IndexData > m_indexEntries;
+
+    QHash< QString, int > m_artistIds;
+    QHash< QPair< int, QString >, int > m_trackIds;
+    QHash< QPair< int, QString >, int > m_albumIds;
 };
 
 }
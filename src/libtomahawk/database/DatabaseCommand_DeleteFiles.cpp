@@ -24,6 +24,7 @@
 #include "collection/Collection.h"
 #include "database/Database.h"
 #include "database/DatabaseImpl.h"
+#include "database/fuzzyindex/DatabaseFuzzyIndex.h"
 #include "network/Servent.h"
 #include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
@@ -40,6 +41,9 @@ using namespace Tomahawk;
 void
 DatabaseCommand_DeleteFiles::postCommitHook()
 {
+    // Tracks without any file left can't be resolved anymore, drop them from the search index
+    Database::instance()->impl()->m_fuzzyIndex->deleteTracks( m_orphanedTracks );
+
     if ( m_idList.isEmpty() )
         return;
 
@@ -100,8 +104,14 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
         }
     }
 
+    // tracks referenced by the files we're about to delete
+    QList<unsigned int> tracks;
+
     if ( m_deleteAll )
     {
+        tracks = trackIds( dbi, QString( "file IN ( SELECT id FROM file WHERE source %1 )" )
+                                   .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1" )
                     .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
         delquery.exec();
@@ -129,14 +139,56 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
             idstring.chop( 2 ); //remove the trailing ", "
         }
 
+        if ( !idstring.isEmpty() )
+            tracks = trackIds( dbi, QString( "file IN ( %1 )" ).arg( idstring ) );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1 AND id IN ( %2 )" )
                              .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
                              .arg( idstring ) );
         delquery.exec();
     }
 
+    // dropped from the search index after committing, see postCommitHook()
+    m_orphanedTracks = orphanedTracks( dbi, tracks );
+
     if ( !m_idList.isEmpty() )
         source()->updateIndexWhenSynced();
 
     emit done( m_idList, source()->dbCollection() );
 }
+
+
+QList<unsigned int>
+DatabaseCommand_DeleteFiles::trackIds( DatabaseImpl* dbi, const QString& fileCondition )
+{
+    QList<unsigned int> tracks;
+
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( QString( "SELECT DISTINCT track FROM file_join WHERE %1" ).arg( fileCondition ) );
+    while ( query.next() )
+        tracks << query.value( 0 ).toUInt();
+
+    return tracks;
+}
+
+
+QList<unsigned int>
+DatabaseCommand_DeleteFiles::orphanedTracks( DatabaseImpl* dbi, const QList<unsigned int>& trackIds )
+{
+    QSet<unsigned int> orphans = trackIds.toSet();
+
+    // check in chunks to keep the statements reasonably small
+    for ( int i = 0; i < trackIds.count(); i += 500 )
+    {
+        QStringList chunk;
+        foreach ( unsigned int id, trackIds.mid( i, 500 ) )
+            chunk << QString::number( id );
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.exec( QString( "SELECT DISTINCT track FROM file_join WHERE track IN ( %1 )" ).arg( chunk.join( ", " ) ) );
+        while ( query.next() )
+            orphans.remove( query.value( 0 ).toUInt() );
+    }
+
+    return orphans.toList();
+}
@@ -81,9 +81,13 @@ signals:
     void notify( const QList<unsigned int>& ids );
 
 private:
+    static QList<unsigned int> trackIds( DatabaseImpl* dbi, const QString& fileCondition );
+    static QList<unsigned int> orphanedTracks( DatabaseImpl* dbi, const QList<unsigned int>& trackIds );
+
     QDir m_dir;
     QVariantList m_ids;
     QList<unsigned int> m_idList;
+    QList<unsigned int> m_orphanedTracks;
     bool m_deleteAll;
 };
 
@@ -19,6 +19,7 @@
 
 #include "DatabaseCommand_FileMTimes.h"
 
+#include <QFileInfo>
 #include <QSqlQuery>
 
 #include "DatabaseImpl.h"
@@ -29,6 +30,28 @@
 namespace Tomahawk
 {
 
+// Local urls starting with prefix, as a range on the (source, url) index rather than a LIKE
+static void
+bindPrefix( TomahawkSqlQuery& query, const QString& prefix )
+{
+    QString end = prefix;
+    if ( !end.isEmpty() )
+        end[ end.length() - 1 ] = QChar( end.at( end.length() - 1 ).unicode() + 1 );
+
+    query.bindValue( ":from", prefix );
+    query.bindValue( ":to", end );
+}
+
+
+// A path as it ends up in file urls, even if it doesn't exist (anymore)
+static QString
+urlPath( const QString& path )
+{
+    const QString canonical = QFileInfo( path ).canonicalFilePath();
+    return canonical.isEmpty() ? QDir::cleanPath( QDir( path ).absolutePath() ) : canonical;
+}
+
+
 void
 DatabaseCommand_FileMtimes::exec( DatabaseImpl* dbi )
 {
@@ -43,7 +66,11 @@ DatabaseCommand_FileMtimes::execSelect( DatabaseImpl* dbi )
     //FIXME: If ever needed for a non-local source this will have to be fixed/updated
     QMap< QString, QMap< unsigned int, unsigned int > > mtimes;
     TomahawkSqlQuery query = dbi->newquery();
-    if( m_prefix.isEmpty() && m_prefixes.isEmpty() )
+    if ( !m_excludedDirectories.isEmpty() )
+    {
+        execSelectExcluding( dbi, mtimes );
+    }
+    else if( m_prefix.isEmpty() && m_prefixes.isEmpty() && m_directories.isEmpty() )
     {
         QString limit( m_checkonly ? QString( "LIMIT 1" ) : QString() );
         query.exec( QString( "SELECT url, id, mtime FROM file WHERE source IS NULL %1" ).arg( limit ) );
@@ -54,18 +81,53 @@ DatabaseCommand_FileMtimes::execSelect( DatabaseImpl* dbi )
             mtimes.insert( query.value( 0 ).toString(), map );
         }
     }
-    else if( m_prefixes.isEmpty() )
-        execSelectPath( dbi, m_prefix, mtimes );
     else
     {
         if( !m_prefix.isEmpty() )
             execSelectPath( dbi, m_prefix, mtimes );
         foreach( QString path, m_prefixes )
             execSelectPath( dbi, path, mtimes );
+        foreach( const QString& directory, m_directories )
+            execSelectDirectory( dbi, directory, mtimes );
     }
+
     emit done( mtimes );
+    emit mtimesLoaded( m_requestId, mtimes );
+}
+
+
+void
+DatabaseCommand_FileMtimes::execSelectExcluding( DatabaseImpl* dbi, QMap< QString, QMap< unsigned int, unsigned int > > &mtimes )
+{
+    // The excluded dirs go into a temporary table, so SQLite can skip their files with an index lookup
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( "CREATE TEMP TABLE IF NOT EXISTS filemtimes_excluded ( dir TEXT PRIMARY KEY )" );
+    query.exec( "DELETE FROM temp.filemtimes_excluded" );
+
+    query.prepare( "INSERT OR IGNORE INTO temp.filemtimes_excluded ( dir ) VALUES ( ? )" );
+    foreach ( const QString& directory, m_excludedDirectories )
+    {
+        query.bindValue( 0, "file://" + ( directory.endsWith( '/' ) ? directory : directory + '/' ) );
+        query.exec();
+    }
+
+    // rtrim() with all of the url's characters but '/' leaves the url of its directory, up to the last '/'
+    query.exec( "SELECT url, id, mtime "
+                "FROM file "
+                "WHERE source IS NULL "
+                "AND rtrim( url, replace( url, '/', '' ) ) NOT IN ( SELECT dir FROM temp.filemtimes_excluded )" );
+
+    while( query.next() )
+    {
+        QMap< unsigned int, unsigned int > map;
+        map.insert( query.value( 1 ).toUInt(), query.value( 2 ).toUInt() );
+        mtimes.insert( query.value( 0 ).toString(), map );
+    }
+
+    query.exec( "DELETE FROM temp.filemtimes_excluded" );
 }
 
+
 void
 DatabaseCommand_FileMtimes::execSelectPath( DatabaseImpl *dbi, const QDir& path, QMap<QString, QMap< unsigned int, unsigned int > > &mtimes )
 {
@@ -73,9 +135,36 @@ DatabaseCommand_FileMtimes::execSelectPath( DatabaseImpl *dbi, const QDir& path,
     query.prepare( QString( "SELECT url, id, mtime "
                             "FROM file "
                             "WHERE source IS NULL "
-                            "AND url LIKE :prefix" ) );
+                            "AND url >= :from AND url < :to" ) );
+
+    bindPrefix( query, "file://" + urlPath( path.path() ) );
+    query.exec();
+
+    while( query.next() )
+    {
+        QMap< unsigned int, unsigned int > map;
+        map.insert( query.value( 1 ).toUInt(), query.value( 2 ).toUInt() );
+        mtimes.insert( query.value( 0 ).toString(), map );
+    }
+}
+
+
+void
+DatabaseCommand_FileMtimes::execSelectDirectory( DatabaseImpl *dbi, const QString& directory, QMap< QString, QMap< unsigned int, unsigned int > > &mtimes )
+{
+    QString prefix = "file://" + urlPath( directory );
+    if ( !prefix.endsWith( '/' ) )
+        prefix += '/';
+
+    // substr() counts characters, not UTF-16 code units
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( QString( "SELECT url, id, mtime "
+                            "FROM file "
+                            "WHERE source IS NULL "
+                            "AND url >= :from AND url < :to "
+                            "AND substr( url, %1 ) NOT LIKE '%/%'" ).arg( prefix.toUcs4().count() + 1 ) );
 
-    query.bindValue( ":prefix", "file://" + path.canonicalPath() + "%" );
+    bindPrefix( query, prefix );
     query.exec();
 
     while( query.next() )
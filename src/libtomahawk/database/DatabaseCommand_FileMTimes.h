@@ -24,6 +24,7 @@
 #include <QVariantMap>
 #include <QMap>
 #include <QDir>
+#include <QSet>
 
 #include "DatabaseCommand.h"
 
@@ -40,33 +41,55 @@ Q_OBJECT
 
 public:
     explicit DatabaseCommand_FileMtimes( const QString& prefix = QString(), QObject* parent = 0 )
-        : DatabaseCommand( parent ), m_prefix( prefix ), m_checkonly( false )
+        : DatabaseCommand( parent ), m_prefix( prefix ), m_checkonly( false ), m_requestId( 0 )
     {}
 
     explicit DatabaseCommand_FileMtimes( const QStringList& prefixes, QObject* parent = 0 )
-    : DatabaseCommand( parent ), m_prefixes( prefixes ), m_checkonly( false )
+    : DatabaseCommand( parent ), m_prefixes( prefixes ), m_checkonly( false ), m_requestId( 0 )
     {}
 
     //NOTE: when this is called we actually ignore the boolean flag; it's just used to give us the right constructor
     explicit DatabaseCommand_FileMtimes( bool /*checkonly*/, QObject* parent = 0 )
-    : DatabaseCommand( parent ), m_checkonly( true )
+    : DatabaseCommand( parent ), m_checkonly( true ), m_requestId( 0 )
     {}
     
+    /**
+     * Also load the files directly inside each of these directories, but not the ones
+     * in their subdirectories. This is what the scanner uses to compare one directory
+     * at a time, instead of keeping the mtimes of the whole collection around.
+     */
+    void setDirectories( const QStringList& directories ) { m_directories = directories; }
+
+    /**
+     * When loading all local files, skip those that are directly inside one of
+     * these directories. Leaves us with the files in directories that are gone.
+     */
+    void setExcludedDirectories( const QSet< QString >& directories ) { m_excludedDirectories = directories; }
+
+    /// Passed back with mtimesLoaded(), so callers can tell their requests apart
+    void setRequestId( uint requestId ) { m_requestId = requestId; }
+
     virtual void exec( DatabaseImpl* );
     virtual bool doesMutates() const { return false; }
     virtual QString commandname() const { return "filemtimes"; }
 
 signals:
     void done( const QMap< QString, QMap< unsigned int, unsigned int > >& );
+    void mtimesLoaded( uint requestId, const QMap< QString, QMap< unsigned int, unsigned int > >& );
 
 public slots:
 
 private:
     void execSelectPath( DatabaseImpl *dbi, const QDir& path, QMap< QString, QMap< unsigned int, unsigned int > > &mtimes );
+    void execSelectDirectory( DatabaseImpl *dbi, const QString& directory, QMap< QString, QMap< unsigned int, unsigned int > > &mtimes );
     void execSelect( DatabaseImpl* dbi );
+    void execSelectExcluding( DatabaseImpl* dbi, QMap< QString, QMap< unsigned int, unsigned int > > &mtimes );
     QString m_prefix;
     QStringList m_prefixes;
+    QStringList m_directories;
+    QSet< QString > m_excludedDirectories;
     bool m_checkonly;
+    uint m_requestId;
 };
 
 }
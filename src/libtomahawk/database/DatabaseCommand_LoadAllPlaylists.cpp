@@ -19,7 +19,6 @@
 
 #include "DatabaseCommand_LoadAllPlaylists_p.h"
 
-#include "utils/Json.h"
 
 #include "DatabaseImpl.h"
 #include "Playlist.h"
@@ -59,14 +58,12 @@ DatabaseCommand_LoadAllPlaylists::exec( DatabaseImpl* dbi )
         sourceToken = QString( "AND source %1 " ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
 
     QString trackIdJoin;
-    QString trackIdFields;
     if ( d->returnPlEntryIds )
     {
-        trackIdFields = ", pr.entries";
         trackIdJoin = "JOIN playlist_revision pr ON pr.playlist = p.guid AND pr.guid = p.currentrevision";
     }
 
-    query.exec( QString( " SELECT p.guid, p.title, p.info, p.creator, p.lastmodified, p.shared, p.currentrevision, p.createdOn %6 "
+    query.exec( QString( " SELECT p.guid, p.title, p.info, p.creator, p.lastmodified, p.shared, p.currentrevision, p.createdOn "
                          " FROM playlist p "
                          " %5 "
                          " WHERE ( ( dynplaylist = 'false' ) OR ( dynplaylist = 0 ) ) "
@@ -78,7 +75,6 @@ DatabaseCommand_LoadAllPlaylists::exec( DatabaseImpl* dbi )
                 .arg( d->sortDescending ? "DESC" : QString() )
                 .arg( d->limitAmount > 0 ? QString( "LIMIT 0, %1" ).arg( d->limitAmount ) : QString() )
                 .arg( trackIdJoin )
-                .arg( trackIdFields )
                 );
 
     QList<playlist_ptr> plists;
@@ -100,7 +96,8 @@ DatabaseCommand_LoadAllPlaylists::exec( DatabaseImpl* dbi )
 
         if ( d->returnPlEntryIds )
         {
-            QStringList trackIds = TomahawkUtils::parseJson( query.value( 8 ).toByteArray() ).toStringList();
+            // revisions may be stored as deltas, so resolve the entries of the current one
+            QStringList trackIds = dbi->playlistEntries( query.value( 6 ).toString() );
             phash.insert( p, trackIds );
         }
     }
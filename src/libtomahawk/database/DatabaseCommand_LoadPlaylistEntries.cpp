@@ -26,8 +26,12 @@
 #include "Query.h"
 #include "Source.h"
 
+#include <QSet>
 #include <QSqlQuery>
 
+// SQLite's default limit of bound variables per statement is 999
+#define MAX_BOUND_GUIDS 500
+
 using namespace Tomahawk;
 
 
@@ -44,60 +48,58 @@ void
 DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
 {
     TomahawkSqlQuery query_entries = dbi->newquery();
-    query_entries.prepare( "SELECT entries, playlist, author, timestamp, previous_revision "
+    query_entries.prepare( "SELECT playlist, previous_revision "
                            "FROM playlist_revision "
                            "WHERE guid = :guid" );
     query_entries.bindValue( ":guid", m_revguid );
     query_entries.exec();
 
     tLog( LOGVERBOSE ) << "trying to load playlist entries for guid:" << m_revguid;
+    QString playlist;
     QString prevrev;
-    bool ok;
 
     if ( query_entries.next() )
     {
-        if ( !query_entries.value( 0 ).isNull() )
-        {
-            // entries should be a list of strings:
-            QVariant v = TomahawkUtils::parseJson( query_entries.value( 0 ).toByteArray(), &ok );
-            Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
+        playlist = query_entries.value( 0 ).toString();
+        prevrev = query_entries.value( 1 ).toString();
 
-            m_guids = v.toStringList();
-            QString inclause = QString( "('%1')" ).arg( m_guids.join( "', '" ) );
+        // revisions are stored as deltas, let the db resolve the full list of entries
+        m_guids = dbi->playlistEntries( m_revguid );
+        QSet< QString > wanted = m_guids.toSet();
 
+        if ( !wanted.isEmpty() )
+        {
+            // entries of a playlist normally belong to it, so look them up by the indexed playlist column
             TomahawkSqlQuery query = dbi->newquery();
-            QString sql = QString( "SELECT guid, trackname, artistname, albumname, annotation, "
-                                "duration, addedon, addedby, result_hint "
-                                "FROM playlist_item "
-                                "WHERE guid IN %1" ).arg( inclause );
-
-            query.exec( sql );
-            while ( query.next() )
+            query.prepare( "SELECT guid, trackname, artistname, albumname, annotation, "
+                           "duration, addedon, addedby, result_hint "
+                           "FROM playlist_item "
+                           "WHERE playlist = ?" );
+            query.addBindValue( playlist );
+            query.exec();
+            addEntries( query, wanted );
+
+            // anything left over (e.g. entries copied from another playlist) gets looked up by guid
+            QStringList missing = wanted.toList();
+            for ( int i = 0; i < missing.count(); i += MAX_BOUND_GUIDS )
             {
-                plentry_ptr e( new PlaylistEntry );
-                e->setGuid( query.value( 0 ).toString() );
-                e->setAnnotation( query.value( 4 ).toString() );
-                e->setDuration( query.value( 5 ).toUInt() );
-                e->setLastmodified( 0 ); // TODO e->lastmodified = query.value( 6 ).toInt();
-                const QString resultHint = query.value( 8 ).toString();
-                e->setResultHint( resultHint );
-
-                Tomahawk::query_ptr q = Tomahawk::Query::get( query.value( 2 ).toString(), query.value( 1 ).toString(), query.value( 3 ).toString() );
-                if ( q.isNull() )
-                    continue;
-
-                q->setResultHint( resultHint );
-                if ( resultHint.startsWith( "http" ) )
-                    q->setSaveHTTPResultHint( true );
-
-                q->setProperty( "annotation", e->annotation() );
-                e->setQuery( q );
-
-                m_entrymap.insert( e->guid(), e );
+                const QStringList chunk = missing.mid( i, MAX_BOUND_GUIDS );
+
+                QStringList placeholders;
+                for ( int j = 0; j < chunk.count(); j++ )
+                    placeholders << "?";
+
+                TomahawkSqlQuery query_missing = dbi->newquery();
+                query_missing.prepare( QString( "SELECT guid, trackname, artistname, albumname, annotation, "
+                                                "duration, addedon, addedby, result_hint "
+                                                "FROM playlist_item "
+                                                "WHERE guid IN (%1)" ).arg( placeholders.join( ", " ) ) );
+                foreach ( const QString& guid, chunk )
+                    query_missing.addBindValue( guid );
+                query_missing.exec();
+                addEntries( query_missing, wanted );
             }
         }
-
-        prevrev = query_entries.value( 4 ).toString();
     }
     else
     {
@@ -106,34 +108,59 @@ DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
 
     if ( !prevrev.isEmpty() )
     {
-        TomahawkSqlQuery query_entries_old = dbi->newquery();
-        query_entries_old.prepare( "SELECT entries, "
-                                   "(SELECT currentrevision = ? FROM playlist WHERE guid = ?) "
-                                   "FROM playlist_revision "
-                                   "WHERE guid = ?" );
-        query_entries_old.addBindValue( m_revguid );
-        query_entries_old.addBindValue( query_entries.value( 1 ).toString() );
-        query_entries_old.addBindValue( prevrev );
-
-        query_entries_old.exec();
-        if ( !query_entries_old.next() )
-        {
+        bool found = false;
+        const QStringList oldentries = dbi->playlistEntries( prevrev, &found );
+        if ( !found )
             return;
-            Q_ASSERT( false );
-        }
 
-        if ( !query_entries_old.value( 0 ).isNull() )
-        {
-            QVariant v = TomahawkUtils::parseJson( query_entries_old.value( 0 ).toByteArray(), &ok );
-            Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
-            m_oldentries = v.toStringList();
-        }
-        m_islatest = query_entries_old.value( 1 ).toBool();
+        m_oldentries = oldentries;
+
+        TomahawkSqlQuery query_latest = dbi->newquery();
+        query_latest.prepare( "SELECT currentrevision = ? FROM playlist WHERE guid = ?" );
+        query_latest.addBindValue( m_revguid );
+        query_latest.addBindValue( playlist );
+        query_latest.exec();
+        if ( query_latest.next() )
+            m_islatest = query_latest.value( 0 ).toBool();
     }
 
 //    qDebug() << Q_FUNC_INFO << "entrymap:" << m_entrymap;
 }
 
+
+void
+DatabaseCommand_LoadPlaylistEntries::addEntries( TomahawkSqlQuery& query, QSet< QString >& wanted )
+{
+    while ( query.next() )
+    {
+        const QString guid = query.value( 0 ).toString();
+        if ( !wanted.remove( guid ) )
+            continue;
+
+        plentry_ptr e( new PlaylistEntry );
+        e->setGuid( guid );
+        e->setAnnotation( query.value( 4 ).toString() );
+        e->setDuration( query.value( 5 ).toUInt() );
+        e->setLastmodified( 0 ); // TODO e->lastmodified = query.value( 6 ).toInt();
+        const QString resultHint = query.value( 8 ).toString();
+        e->setResultHint( resultHint );
+
+        Tomahawk::query_ptr q = Tomahawk::Query::get( query.value( 2 ).toString(), query.value( 1 ).toString(), query.value( 3 ).toString() );
+        if ( q.isNull() )
+            continue;
+
+        q->setResultHint( resultHint );
+        if ( resultHint.startsWith( "http" ) )
+            q->setSaveHTTPResultHint( true );
+
+        q->setProperty( "annotation", e->annotation() );
+        e->setQuery( q );
+
+        m_entrymap.insert( e->guid(), e );
+    }
+}
+
+
 DatabaseCommand_LoadPlaylistEntries::DatabaseCommand_LoadPlaylistEntries( QString revision_guid, QObject *parent )
     : DatabaseCommand( parent )
     , m_islatest( true )
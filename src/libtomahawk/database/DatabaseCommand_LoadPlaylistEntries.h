@@ -25,9 +25,12 @@
 #include "Playlist.h"
 
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 #include <QVariantMap>
 
+class TomahawkSqlQuery;
+
 namespace Tomahawk
 {
 
@@ -61,6 +64,9 @@ protected:
     QStringList m_oldentries;
 
 private:
+    // turns the playlist_item rows of query into entries, for the guids still in wanted
+    void addEntries( TomahawkSqlQuery& query, QSet< QString >& wanted );
+
     QString m_revguid;
 };
 
@@ -39,6 +39,13 @@ DatabaseCommand_Resolve::DatabaseCommand_Resolve( const query_ptr& query )
 }
 
 
+DatabaseCommand_Resolve::DatabaseCommand_Resolve( const QList< query_ptr >& queries )
+    : DatabaseCommand()
+    , m_queries( queries )
+{
+}
+
+
 DatabaseCommand_Resolve::~DatabaseCommand_Resolve()
 {
 }
@@ -54,39 +61,128 @@ DatabaseCommand_Resolve::exec( DatabaseImpl* lib )
      *           results that are less than MINSCORE
      */
 
-    if ( !m_query->resultHint().isEmpty() )
+    if ( !m_queries.isEmpty() )
     {
-        tDebug() << "Using result-hint to speed up resolving:" << m_query->resultHint();
-
-        Tomahawk::result_ptr result = lib->resultFromHint( m_query );
-        if ( result && ( !result->resolvedByCollection() || result->resolvedByCollection()->isOnline() ) )
-        {
-            QList<Tomahawk::result_ptr> res;
-            res << result;
-            emit results( m_query->id(), res );
-            return;
-        }
+        batchResolve( lib );
+        return;
     }
 
+    if ( hintResolve( lib, m_query ) )
+        return;
+
     if ( m_query->isFullTextQuery() )
-        fullTextResolve( lib );
+        fullTextResolve( lib, m_query );
     else
-        resolve( lib );
+        resolve( lib, m_query );
+}
+
+
+bool
+DatabaseCommand_Resolve::hintResolve( DatabaseImpl* lib, const query_ptr& query )
+{
+    if ( query->resultHint().isEmpty() )
+        return false;
+
+    tDebug() << "Using result-hint to speed up resolving:" << query->resultHint();
+
+    Tomahawk::result_ptr result = lib->resultFromHint( query );
+    if ( result && ( !result->resolvedByCollection() || result->resolvedByCollection()->isOnline() ) )
+    {
+        QList<Tomahawk::result_ptr> res;
+        res << result;
+        emit results( query->id(), res );
+        return true;
+    }
+
+    return false;
+}
+
+
+QString
+DatabaseCommand_Resolve::filesSql( const QString& whereToken )
+{
+    return QString( "SELECT "
+                    "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
+                    "file_join.artist, file_join.album, file_join.track, "  //7
+                    "file_join.composer, file_join.discnumber, "            //10
+                    "artist.name as artname, "                              //12
+                    "album.name as albname, "                               //13
+                    "track.name as trkname, "                               //14
+                    "composer.name as cmpname, "                            //15
+                    "file.source, "                                         //16
+                    "file_join.albumpos, "                                  //17
+                    "artist.id as artid, "                                  //18
+                    "album.id as albid, "                                   //19
+                    "composer.id as cmpid, "                                //20
+                    "albumArtist.id as albumartistid, "                     //21
+                    "albumArtist.name as albumartistname "                  //22
+                    "FROM file, file_join, artist, track "
+                    "LEFT JOIN album ON album.id = file_join.album "
+                    "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
+                    "LEFT JOIN artist AS albumArtist ON albumArtist.id = album.artist "
+                    "WHERE "
+                    "artist.id = file_join.artist AND "
+                    "track.id = file_join.track AND "
+                    "file.id = file_join.file AND "
+                    "(%1)" )
+           .arg( whereToken );
+}
+
+
+Tomahawk::result_ptr
+DatabaseCommand_Resolve::resultFromFilesQuery( TomahawkSqlQuery& files_query )
+{
+    QString url = files_query.value( 0 ).toString();
+    source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
+    if ( !s )
+    {
+        tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
+        return Tomahawk::result_ptr();
+    }
+    if ( !s->isLocal() )
+        url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
+
+    Tomahawk::result_ptr result = Tomahawk::Result::getCached( url );
+    if ( result )
+    {
+        tDebug( LOGVERBOSE ) << "Result already cached:" << result->toString();
+        return result;
+    }
+
+    track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(),
+                                  files_query.value( 13 ).toString(), files_query.value( 22 ).toString(), files_query.value( 5 ).toUInt(),
+                                  files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
+    if ( !track )
+        return Tomahawk::result_ptr();
+    track->loadAttributes();
+
+    result = Result::get( url, track );
+    if ( !result )
+        return Tomahawk::result_ptr();
+
+    result->setModificationTime( files_query.value( 1 ).toUInt() );
+    result->setSize( files_query.value( 2 ).toUInt() );
+    result->setMimetype( files_query.value( 4 ).toString() );
+    result->setBitrate( files_query.value( 6 ).toUInt() );
+    result->setRID( uuid() );
+    result->setResolvedByCollection( s->dbCollection() );
+
+    return result;
 }
 
 
 void
-DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
+DatabaseCommand_Resolve::resolve( DatabaseImpl* lib, const query_ptr& query )
 {
     QList<Tomahawk::result_ptr> res;
 
     // STEP 1
-    QList< QPair<int, float> > tracks = lib->search( m_query );
+    QList< QPair<int, float> > tracks = lib->search( query );
 
     if ( tracks.isEmpty() )
     {
-        qDebug() << "No candidates found in first pass, aborting resolve" << m_query->queryTrack()->toString();
-        emit results( m_query->id(), res );
+        qDebug() << "No candidates found in first pass, aborting resolve" << query->queryTrack()->toString();
+        emit results( query->id(), res );
         return;
     }
 
@@ -99,89 +195,92 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
 
     QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
 
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid, "                                //20
-                            "albumArtist.id as albumartistid, "                     //21
-                            "albumArtist.name as albumartistname "                  //22
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "LEFT JOIN artist AS albumArtist ON albumArtist.id = album.artist "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "(%1)" )
-         .arg( trksToken );
-
-    files_query.prepare( sql );
+    files_query.prepare( filesSql( trksToken ) );
     files_query.exec();
 
     while ( files_query.next() )
     {
-        QString url = files_query.value( 0 ).toString();
-        source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-        if ( !s )
-        {
-            tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-            continue;
-        }
-        if ( !s->isLocal() )
-            url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
-
-        Tomahawk::result_ptr result = Tomahawk::Result::getCached( url );
+        Tomahawk::result_ptr result = resultFromFilesQuery( files_query );
         if ( result )
-        {
-            tDebug( LOGVERBOSE ) << "Result already cached:" << result->toString();
             res << result;
-            continue;
-        }
+    }
+
+    emit results( query->id(), res );
+}
 
-        track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(),
-                                      files_query.value( 13 ).toString(), files_query.value( 22 ).toString(), files_query.value( 5 ).toUInt(),
-                                      files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
-        if ( !track )
-            continue;
-        track->loadAttributes();
 
-        result = Result::get( url, track );
-        if ( !result )
+void
+DatabaseCommand_Resolve::batchResolve( DatabaseImpl* lib )
+{
+    QList< query_ptr > trackQueries;
+    foreach ( const query_ptr& query, m_queries )
+    {
+        if ( hintResolve( lib, query ) )
             continue;
 
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setRID( uuid() );
-        result->setResolvedByCollection( s->dbCollection() );
+        // full-text queries also look up albums, don't bother batching them
+        if ( query->isFullTextQuery() )
+            fullTextResolve( lib, query );
+        else
+            trackQueries << query;
+    }
 
-        res << result;
+    if ( trackQueries.isEmpty() )
+        return;
+
+    // STEP 1
+    const QHash< QID, QList< QPair<int, float> > > candidates = lib->search( trackQueries );
+
+    QHash< int, QList< QID > > qidsForTrack;
+    foreach ( const QID& qid, candidates.keys() )
+    {
+        const QList< QPair<int, float> >& tracks = candidates[ qid ];
+        for ( int k = 0; k < tracks.count(); k++ )
+            qidsForTrack[ tracks.at( k ).first ] << qid;
+    }
+
+    QHash< QID, QList< Tomahawk::result_ptr > > res;
+    if ( !qidsForTrack.isEmpty() )
+    {
+        // STEP 2
+        TomahawkSqlQuery files_query = lib->newquery();
+
+        QStringList trksl;
+        foreach ( int trackId, qidsForTrack.keys() )
+            trksl.append( QString::number( trackId ) );
+
+        QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
+
+        files_query.prepare( filesSql( trksToken ) );
+        files_query.exec();
+
+        while ( files_query.next() )
+        {
+            Tomahawk::result_ptr result = resultFromFilesQuery( files_query );
+            if ( !result )
+                continue;
+
+            foreach ( const QID& qid, qidsForTrack.value( files_query.value( 9 ).toInt() ) )
+                res[ qid ] << result;
+        }
     }
+    else
+        tDebug( LOGVERBOSE ) << "No candidates found in first pass for a batch of" << trackQueries.count() << "queries";
 
-    emit results( m_query->id(), res );
+    foreach ( const query_ptr& query, trackQueries )
+        emit results( query->id(), res.value( query->id() ) );
 }
 
 
 void
-DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
+DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib, const query_ptr& q )
 {
     QList<Tomahawk::result_ptr> res;
     typedef QPair<int, float> scorepair_t;
 
     // STEP 1
-    QList< QPair<int, float> > trackPairs = lib->search( m_query );
-    QList< QPair<int, float> > albumPairs = lib->searchAlbum( m_query, 20 );
+    QList< QPair<int, float> > trackPairs = lib->search( q );
+    QList< QPair<int, float> > albumPairs = lib->searchAlbum( q, 20 );
 
     TomahawkSqlQuery query = lib->newquery();
     query.prepare( "SELECT album.name, artist.id, artist.name FROM album, artist WHERE artist.id = album.artist AND album.id = ?" );
@@ -199,13 +298,13 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
             albumList << album;
         }
 
-        emit albums( m_query->id(), albumList );
+        emit albums( q->id(), albumList );
     }
 
     if ( trackPairs.isEmpty() )
     {
-        qDebug() << "No candidates found in first pass, aborting resolve" << m_query->fullTextQuery();
-        emit results( m_query->id(), res );
+        qDebug() << "No candidates found in first pass, aborting resolve" << q->fullTextQuery();
+        emit results( q->id(), res );
         return;
     }
 
@@ -217,70 +316,16 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
         trksl.append( QString::number( trackPairs.at( k ).first ) );
 
     QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid, "                                //20
-                            "albumArtist.id as albumartistid, "                     //21
-                            "albumArtist.name as albumartistname "                  //22
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "LEFT JOIN artist AS albumArtist ON albumArtist.id = album.artist "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "%1" )
-                        .arg( !trksl.isEmpty() ? trksToken : QString( "0" ) );
-
-    files_query.prepare( sql );
+
+    files_query.prepare( filesSql( trksToken ) );
     files_query.exec();
 
     while ( files_query.next() )
     {
-        QString url = files_query.value( 0 ).toString();
-        source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-        if ( !s )
-        {
-            tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-            continue;
-        }
-        if ( !s->isLocal() )
-            url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
-
-        Tomahawk::result_ptr result = Tomahawk::Result::getCached( url );
+        Tomahawk::result_ptr result = resultFromFilesQuery( files_query );
         if ( result )
-        {
-            tDebug( LOGVERBOSE ) << "Result already cached:" << result->toString();
             res << result;
-            continue;
-        }
-
-        track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(),
-                                      files_query.value( 13 ).toString(), files_query.value( 22 ).toString(), files_query.value( 5 ).toUInt(),
-                                      files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
-        track->loadAttributes();
-
-        result = Result::get( url, track );
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setRID( uuid() );
-        result->setResolvedByCollection( s->dbCollection() );
-
-        res << result;
     }
 
-    emit results( m_query->id(), res );
+    emit results( q->id(), res );
 }
@@ -37,6 +37,11 @@ class DLLEXPORT DatabaseCommand_Resolve : public DatabaseCommand
 Q_OBJECT
 public:
     explicit DatabaseCommand_Resolve( const Tomahawk::query_ptr& query );
+    /**
+     * Resolves all queries at once, using a single index pass and a single
+     * file lookup. Signals are still emitted per query.
+     */
+    explicit DatabaseCommand_Resolve( const QList< Tomahawk::query_ptr >& queries );
     virtual ~DatabaseCommand_Resolve();
 
     QString commandname() const override { return "dbresolve"; }
@@ -52,10 +57,16 @@ signals:
 private:
     DatabaseCommand_Resolve();
 
-    void fullTextResolve( DatabaseImpl* lib );
-    void resolve( DatabaseImpl* lib );
+    bool hintResolve( DatabaseImpl* lib, const Tomahawk::query_ptr& query );
+    void fullTextResolve( DatabaseImpl* lib, const Tomahawk::query_ptr& query );
+    void resolve( DatabaseImpl* lib, const Tomahawk::query_ptr& query );
+    void batchResolve( DatabaseImpl* lib );
+
+    static QString filesSql( const QString& whereToken );
+    static Tomahawk::result_ptr resultFromFilesQuery( TomahawkSqlQuery& files_query );
 
     Tomahawk::query_ptr m_query;
+    QList< Tomahawk::query_ptr > m_queries;
 };
 
 }
@@ -24,6 +24,7 @@
 #include "utils/Logger.h"
 
 #include "DatabaseImpl.h"
+#include "PlaylistDelta.h"
 #include "PlaylistEntry.h"
 #include "Source.h"
 #include "TomahawkSqlQuery.h"
@@ -31,6 +32,9 @@
 
 #include <QSqlQuery>
 
+// Store the full list of entries again after this many deltas, so loading a revision stays cheap
+#define SNAPSHOT_INTERVAL 50
+
 using namespace Tomahawk;
 
 
@@ -147,8 +151,9 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
         return;
     }
 
-    QVariantList vlist = m_orderedguids;
-    const QByteArray entries = TomahawkUtils::toJson( vlist );
+    QStringList orderedguids;
+    foreach ( const QVariant& v, m_orderedguids )
+        orderedguids << v.toString();
 
     // add any new items:
     TomahawkSqlQuery adde = lib->newquery();
@@ -224,6 +229,22 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
         }
     }
 
+    // store the changes to the revision we're based on, unless the chain of deltas got
+    // long or the delta wouldn't be much smaller than the full list
+    bool previousFound = false;
+    int previousDeltas = 0;
+    const QStringList previousEntries = m_oldrev.isEmpty() ? QStringList() : lib->playlistEntries( m_oldrev, &previousFound, &previousDeltas );
+
+    QByteArray entries;
+    if ( previousFound && previousDeltas < SNAPSHOT_INTERVAL )
+    {
+        const QVariantMap delta = PlaylistDelta::create( previousEntries, orderedguids );
+        if ( !delta.isEmpty() && PlaylistDelta::size( delta ) < orderedguids.count() / 2 )
+            entries = TomahawkUtils::toJson( delta );
+    }
+    if ( entries.isEmpty() )
+        entries = TomahawkUtils::toJson( m_orderedguids );
+
     // add / update the revision:
     TomahawkSqlQuery query = lib->newquery();
     QString sql = "INSERT INTO playlist_revision(guid, playlist, entries, author, timestamp, previous_revision) "
@@ -252,22 +273,10 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
 
         m_applied = true;
 
-        // load previous revision entries, which we need to pass on
+        // previous revision entries, which we need to pass on
         // so the change can be diffed
-        TomahawkSqlQuery query_entries = lib->newquery();
-        query_entries.prepare( "SELECT entries, playlist, author, timestamp, previous_revision "
-                               "FROM playlist_revision "
-                               "WHERE guid = :guid" );
-        query_entries.bindValue( ":guid", m_oldrev );
-        query_entries.exec();
-        if ( query_entries.next() )
-        {
-            bool ok;
-            QVariant v = TomahawkUtils::parseJson( query_entries.value( 0 ).toByteArray(), &ok );
-            Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
-
-            m_previous_rev_orderedguids = v.toStringList();
-        }
+        if ( previousFound )
+            m_previous_rev_orderedguids = previousEntries;
     }
     else if ( !m_oldrev.isEmpty() )
     {
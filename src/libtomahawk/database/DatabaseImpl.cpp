@@ -22,6 +22,7 @@
 #include "DatabaseImpl.h"
 
 #include "database/Database.h"
+#include "utils/Json.h"
 #include "utils/Logger.h"
 #include "utils/ResultUrlChecker.h"
 #include "utils/TomahawkUtils.h"
@@ -29,15 +30,18 @@
 #include "Album.h"
 #include "Artist.h"
 #include "fuzzyindex/DatabaseFuzzyIndex.h"
+#include "PlaylistDelta.h"
 #include "PlaylistEntry.h"
 #include "Result.h"
 #include "SourceList.h"
+#include "TomahawkSettings.h"
 #include "Track.h"
 
 #include <QtAlgorithms>
 #include <QCoreApplication>
 #include <QFile>
 #include <QRegExp>
+#include <QSet>
 #include <QStringList>
 #include <QTime>
 #include <QTimer>
@@ -51,6 +55,8 @@
 #define CURRENT_SCHEMA_VERSION 31
 
 Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname )
+    : m_cacheSize( 0 )
+    , m_mmapSize( 0 )
 {
     QTime t;
     t.start();
@@ -80,8 +86,27 @@ Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname )
 
     tLog() << "Database ID:" << m_dbid;
     init();
-    query.exec( "PRAGMA auto_vacuum = FULL" );
-    query.exec( "PRAGMA synchronous = NORMAL" );
+
+    // Don't shuffle pages around on every commit that deletes rows (e.g. removing
+    // a large collection), just hand free pages back once on startup.
+    query.exec( "PRAGMA auto_vacuum = INCREMENTAL" );
+    query.exec( "PRAGMA incremental_vacuum" );
+    while ( query.next() );
+
+    TomahawkSettings* s = TomahawkSettings::instance();
+    if ( s && s->databaseWalMode() )
+    {
+        // With a write-ahead log the read-only worker connections never block on the RW worker
+        query.exec( "PRAGMA journal_mode = WAL" );
+        query.exec( QString( "PRAGMA wal_autocheckpoint = %1" ).arg( s->databaseWalAutoCheckpoint() ) );
+    }
+    else
+    {
+        query.exec( "PRAGMA journal_mode = DELETE" );
+    }
+
+    if ( s )
+        setConnectionTuning( s->databaseCacheSize(), s->databaseMmapSize() );
 
     tDebug( LOGVERBOSE ) << "Tweaked db pragmas:" << t.elapsed();
 
@@ -101,6 +126,8 @@ Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname )
 
 
 Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname, bool internal )
+    : m_cacheSize( 0 )
+    , m_mmapSize( 0 )
 {
     Q_UNUSED( internal );
     openDatabase( dbname, false );
@@ -117,6 +144,36 @@ Tomahawk::DatabaseImpl::init()
 
      // make sqlite behave how we want:
     query.exec( "PRAGMA foreign_keys = ON" );
+    query.exec( "PRAGMA synchronous = NORMAL" );
+}
+
+
+void
+Tomahawk::DatabaseImpl::setConnectionTuning( int cacheSize, int mmapSize )
+{
+    m_cacheSize = cacheSize;
+    m_mmapSize = mmapSize;
+
+    TomahawkSqlQuery query = newquery();
+    if ( cacheSize > 0 )
+    {
+        // a negative value is a size in KiB rather than a number of pages
+        query.exec( QString( "PRAGMA cache_size = -%1" ).arg( cacheSize ) );
+    }
+    query.exec( QString( "PRAGMA mmap_size = %1" ).arg( (qint64)mmapSize * 1024 * 1024 ) );
+}
+
+
+void
+Tomahawk::DatabaseImpl::checkpoint()
+{
+    TomahawkSqlQuery query = newquery();
+    query.exec( "PRAGMA journal_mode" );
+    if ( query.next() && query.value( 0 ).toString() == "wal" )
+    {
+        tDebug() << "Checkpointing database write-ahead log";
+        query.exec( "PRAGMA wal_checkpoint(TRUNCATE)" );
+    }
 }
 
 
@@ -164,6 +221,7 @@ Tomahawk::DatabaseImpl::clone() const
     DatabaseImpl* impl = new DatabaseImpl( m_db.databaseName(), true );
     impl->setDatabaseID( m_dbid );
     impl->setFuzzyIndex( m_fuzzyIndex );
+    impl->setConnectionTuning( m_cacheSize, m_mmapSize );
     return impl;
 }
 
@@ -472,6 +530,60 @@ Tomahawk::DatabaseImpl::albumId( int artistid, const QString& name_orig, bool au
 }
 
 
+QStringList
+Tomahawk::DatabaseImpl::playlistEntries( const QString& revisionGuid, bool* found, int* deltas )
+{
+    QList< QVariantMap > chain;
+    QStringList entries;
+    QSet< QString > visited;
+    bool complete = false;
+
+    TomahawkSqlQuery query = newquery();
+    query.prepare( "SELECT entries, previous_revision FROM playlist_revision WHERE guid = ?" );
+
+    // walk back until we hit a full list of entries
+    QString guid = revisionGuid;
+    while ( !guid.isEmpty() && !visited.contains( guid ) )
+    {
+        visited << guid;
+        query.bindValue( 0, guid );
+        query.exec();
+        if ( !query.next() )
+            break;
+
+        if ( query.value( 0 ).isNull() )
+        {
+            complete = true;
+            break;
+        }
+
+        const QVariant v = TomahawkUtils::parseJson( query.value( 0 ).toByteArray() );
+        if ( v.type() != QVariant::Map )
+        {
+            entries = v.toStringList();
+            complete = true;
+            break;
+        }
+
+        chain.prepend( v.toMap() );
+        guid = query.value( 1 ).toString();
+    }
+
+    if ( found )
+        *found = complete || !chain.isEmpty();
+    if ( deltas )
+        *deltas = chain.count();
+
+    if ( !complete && !chain.isEmpty() )
+        tLog() << Q_FUNC_INFO << "Revision chain of" << revisionGuid << "is broken at" << guid;
+
+    foreach ( const QVariantMap& delta, chain )
+        entries = PlaylistDelta::apply( entries, delta );
+
+    return entries;
+}
+
+
 QList< QPair<int, float> >
 Tomahawk::DatabaseImpl::search( const Tomahawk::query_ptr& query, uint limit )
 {
@@ -497,6 +609,28 @@ Tomahawk::DatabaseImpl::search( const Tomahawk::query_ptr& query, uint limit )
 }
 
 
+QHash< Tomahawk::QID, QList< QPair<int, float> > >
+Tomahawk::DatabaseImpl::search( const QList< Tomahawk::query_ptr >& queries )
+{
+    QHash< Tomahawk::QID, QList< QPair<int, float> > > resultslists;
+
+    const QHash< Tomahawk::QID, QMap< int, float > > resultsmaps = m_fuzzyIndex->search( queries );
+    foreach ( const Tomahawk::QID& qid, resultsmaps.keys() )
+    {
+        const QMap< int, float >& resultsmap = resultsmaps[ qid ];
+        QList< QPair<int, float> >& resultslist = resultslists[ qid ];
+
+        foreach ( int i, resultsmap.keys() )
+        {
+            resultslist << QPair<int, float>( i, (float)resultsmap.value( i ) );
+        }
+        qSort( resultslist.begin(), resultslist.end(), Tomahawk::DatabaseImpl::scorepairSorter );
+    }
+
+    return resultslists;
+}
+
+
 QList< QPair<int, float> >
 Tomahawk::DatabaseImpl::searchAlbum( const Tomahawk::query_ptr& query, uint limit )
 {
@@ -30,6 +30,7 @@
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QStringList>
 #include <QHash>
 #include <QThread>
 
@@ -50,6 +51,8 @@ Q_OBJECT
 
 friend class DatabaseFuzzyIndex;
 friend class DatabaseCommand_UpdateSearchIndex;
+friend class DatabaseCommand_AddFiles;
+friend class DatabaseCommand_DeleteFiles;
 
 public:
     DatabaseImpl( const QString& dbname );
@@ -65,9 +68,17 @@ public:
     int albumId( int artistid, const QString& name_orig, bool autoCreate );
 
     QList< QPair<int, float> > search( const Tomahawk::query_ptr& query, uint limit = 0 );
+    QHash< Tomahawk::QID, QList< QPair<int, float> > > search( const QList< Tomahawk::query_ptr >& queries );
     QList< QPair<int, float> > searchAlbum( const Tomahawk::query_ptr& query, uint limit = 0 );
     QList< int > getTrackFids( int tid );
 
+    /**
+     * Ordered entry guids of a playlist revision. Revisions are stored as deltas
+     * against their previous revision, so this follows the chain back to the last
+     * full list. @p deltas is set to the number of deltas that had to be applied.
+     */
+    QStringList playlistEntries( const QString& revisionGuid, bool* found = 0, int* deltas = 0 );
+
     static QString sortname( const QString& str, bool replaceArticle = false );
 
     QVariantMap artist( int id );
@@ -85,6 +96,9 @@ public:
 
     void loadIndex();
 
+    /// Moves everything from the write-ahead log back into the database file
+    void checkpoint();
+
 signals:
     void indexStarted();
     void indexReady();
@@ -99,6 +113,7 @@ private:
     void setDatabaseID( const QString& dbid ) { m_dbid = dbid; }
 
     void init();
+    void setConnectionTuning( int cacheSize, int mmapSize );
     bool openDatabase( const QString& dbname, bool checkSchema = true );
     bool updateSchema( int oldVersion );
     void dumpDatabase();
@@ -113,6 +128,10 @@ private:
     QString m_dbid;
     Tomahawk::DatabaseFuzzyIndex* m_fuzzyIndex;
     mutable QMutex m_mutex;
+
+    // per connection page cache in KiB and mmap size in MiB, 0 keeps SQLite's defaults
+    int m_cacheSize;
+    int m_mmapSize;
 };
 
 }
@@ -38,8 +38,26 @@ DatabaseResolver::DatabaseResolver( int weight )
 void
 DatabaseResolver::resolve( const Tomahawk::query_ptr& query )
 {
-    Tomahawk::DatabaseCommand_Resolve* cmd = new Tomahawk::DatabaseCommand_Resolve( query );
+    enqueue( new Tomahawk::DatabaseCommand_Resolve( query ) );
+}
+
+
+void
+DatabaseResolver::resolveBatch( const QList< Tomahawk::query_ptr >& queries )
+{
+    if ( queries.isEmpty() )
+        return;
 
+    if ( queries.count() == 1 )
+        resolve( queries.first() );
+    else
+        enqueue( new Tomahawk::DatabaseCommand_Resolve( queries ) );
+}
+
+
+void
+DatabaseResolver::enqueue( Tomahawk::DatabaseCommand_Resolve* cmd )
+{
     connect( cmd, SIGNAL( results( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ),
                     SLOT( gotResults( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ), Qt::QueuedConnection );
     connect( cmd, SIGNAL( albums( Tomahawk::QID, QList< Tomahawk::album_ptr > ) ),
@@ -59,7 +77,7 @@ DatabaseResolver::gotResults( const Tomahawk::QID qid, QList< Tomahawk::result_p
     foreach ( const Tomahawk::result_ptr& r, results )
         r->setResolvedByResolver( this );
 
-    Tomahawk::Pipeline::instance()->reportResults( qid, results );
+    Tomahawk::Pipeline::instance()->reportResults( qid, this, results );
 }
 
 
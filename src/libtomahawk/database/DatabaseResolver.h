@@ -26,6 +26,11 @@
 
 #include "DllMacro.h"
 
+namespace Tomahawk
+{
+    class DatabaseCommand_Resolve;
+}
+
 class DLLEXPORT DatabaseResolver : public Tomahawk::Resolver
 {
 Q_OBJECT
@@ -39,6 +44,7 @@ public:
 
 public slots:
     virtual void resolve( const Tomahawk::query_ptr& query );
+    virtual void resolveBatch( const QList< Tomahawk::query_ptr >& queries );
 
 private slots:
     void gotResults( const Tomahawk::QID qid, QList< Tomahawk::result_ptr> results );
@@ -46,6 +52,8 @@ private slots:
     void gotArtists( const Tomahawk::QID qid, QList< Tomahawk::artist_ptr> artists );
 
 private:
+    void enqueue( Tomahawk::DatabaseCommand_Resolve* cmd );
+
     int m_weight;
 };
 
@@ -88,8 +88,16 @@ DatabaseWorker::DatabaseWorker( Database* db, bool mutates )
     : QObject()
     , m_db( db )
     , m_outstanding( 0 )
+    , m_groupCommitSize( 1 )
+    , m_groupCommitLatency( 0 )
 {
-    Q_UNUSED( mutates );
+    // only the RW worker runs mutating commands, so it's the only one grouping commits
+    if ( mutates )
+    {
+        m_groupCommitSize = db->groupCommitSize();
+        m_groupCommitLatency = db->groupCommitLatency();
+    }
+
     tDebug() << Q_FUNC_INFO << "New db connection with name:" << Database::instance()->impl()->database().connectionName() << "on thread" << this->thread();
 }
 
@@ -114,6 +122,7 @@ DatabaseWorker::enqueue( const QList< Tomahawk::dbcmd_ptr >& cmds )
     QMutexLocker lock( &m_mut );
     m_outstanding += cmds.count();
     m_commands << cmds;
+    m_commandAdded.wakeAll();
 
     if ( m_outstanding == cmds.count() )
         QTimer::singleShot( 0, this, SLOT( doWork() ) );
@@ -126,6 +135,7 @@ DatabaseWorker::enqueue( const Tomahawk::dbcmd_ptr& cmd )
     QMutexLocker lock( &m_mut );
     m_outstanding++;
     m_commands << cmd;
+    m_commandAdded.wakeAll();
 
     if ( m_outstanding == 1 )
         QTimer::singleShot( 0, this, SLOT( doWork() ) );
@@ -141,6 +151,9 @@ DatabaseWorker::doWork()
         If the cmd is modifying local content (ie source->isLocal()) then
         log to the database oplog for replication to peers.
 
+        Queued groupable cmds share a transaction. With group commits enabled,
+        any queued mutating cmds do (up to m_groupCommitSize of them), each one
+        inside its own savepoint, so a failing cmd gets rolled back on its own.
      */
 
 #ifdef DEBUG_TIMING
@@ -148,85 +161,57 @@ DatabaseWorker::doWork()
     timer.start();
 #endif
 
+    QTime started;
+    started.start();
+
     QList< Tomahawk::dbcmd_ptr > cmdGroup;
+    // every cmd we took off the queue, including failed ones, they all get finished()
+    QList< Tomahawk::dbcmd_ptr > cmdsTaken;
     Tomahawk::dbcmd_ptr cmd;
     {
         QMutexLocker lock( &m_mut );
         cmd = m_commands.takeFirst();
     }
 
+    const bool mutates = cmd->doesMutates();
+    const bool isolated = mutates && m_groupCommitSize > 1;
+
     DatabaseImpl* impl = Database::instance()->impl();
-    if ( cmd->doesMutates() )
+    if ( mutates )
     {
         bool transok = impl->database().transaction();
         Q_ASSERT( transok );
         Q_UNUSED( transok );
     }
 
-    unsigned int completed = 0;
+    int completed = 0;
     try
     {
-        bool finished = false;
         {
-            while ( !finished )
+            forever
             {
                 completed++;
-                cmd->_exec( impl ); // runs actual SQL stuff
-
-                if ( cmd->loggable() )
+                cmdsTaken << cmd;
+                if ( !isolated )
                 {
-                    // We only save our own ops to the oplog, since incoming ops from peers
-                    // are applied immediately.
-                    //
-                    // Crazy idea: if peers had keypairs and could sign ops/msgs, in theory it
-                    // would be safe to sync ops for friend A from friend B's cache, if he saved them,
-                    // which would mean you could get updates even if a peer was offline.
-                    if ( cmd->source()->isLocal() && !cmd->localOnly() )
-                    {
-                        // save to op-log
-                        DatabaseCommandLoggable* command = (DatabaseCommandLoggable*)cmd.data();
-                        logOp( command );
-                    }
-                    else
-                    {
-                        // Make a note of the last guid we applied for this source
-                        // so we can always request just the newer ops in future.
-                        //
-                        if ( !cmd->singletonCmd() )
-                        {
-                            TomahawkSqlQuery query = impl->newquery();
-                            query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
-                            query.addBindValue( cmd->guid() );
-                            query.addBindValue( cmd->source()->id() );
-
-                            if ( !query.exec() )
-                            {
-                                throw "Failed to set lastop";
-                            }
-                        }
-                    }
+                    applyCommand( impl, cmd ); // runs actual SQL stuff
+                    cmdGroup << cmd;
                 }
-
-                cmdGroup << cmd;
-                if ( cmd->groupable() && !m_commands.isEmpty() )
+                else if ( applyCommandIsolated( impl, cmd ) )
                 {
-                    QMutexLocker lock( &m_mut );
-                    if ( m_commands.first()->groupable() )
-                    {
-                        cmd = m_commands.takeFirst();
-                    }
-                    else
-                    {
-                        finished = true;
-                    }
+                    cmdGroup << cmd;
                 }
-                else
-                    finished = true;
+
+                Tomahawk::dbcmd_ptr next = nextCommand( cmd, completed, started );
+                if ( !next )
+                    break;
+
+                cmd = next;
             }
 
-            if ( cmd->doesMutates() )
+            if ( mutates )
             {
-                qDebug() << "Committing" << cmd->commandname() << cmd->guid();
+                qDebug() << "Committing" << cmdGroup.count() << "of" << completed << "commands, last:" << cmd->commandname() << cmd->guid();
                 if ( !impl->newquery().commitTransaction() )
                 {
                     tDebug() << "FAILED TO COMMIT TRANSACTION*";
@@ -257,7 +242,7 @@ DatabaseWorker::doWork()
                  << impl->database().lastError().driverText()
                  << endl;
 
-        if ( cmd->doesMutates() )
+        if ( mutates )
             impl->database().rollback();
 
         Q_ASSERT( false );
@@ -265,14 +250,15 @@ DatabaseWorker::doWork()
     catch (...)
     {
         qDebug() << "Uncaught exception processing dbcmd";
-        if ( cmd->doesMutates() )
+        if ( mutates )
             impl->database().rollback();
 
         Q_ASSERT( false );
         throw;
     }
 
-    foreach ( Tomahawk::dbcmd_ptr c, cmdGroup )
+    // failed cmds don't get committed(), but whoever waits for them must not wait forever
+    foreach ( Tomahawk::dbcmd_ptr c, cmdsTaken )
         c->emitFinished();
 
     QMutexLocker lock( &m_mut );
@@ -282,6 +268,104 @@ DatabaseWorker::doWork()
 }
 
 
+void
+DatabaseWorker::applyCommand( DatabaseImpl* impl, const Tomahawk::dbcmd_ptr& cmd )
+{
+    cmd->_exec( impl ); // runs actual SQL stuff
+
+    if ( cmd->loggable() )
+    {
+        // We only save our own ops to the oplog, since incoming ops from peers
+        // are applied immediately.
+        //
+        // Crazy idea: if peers had keypairs and could sign ops/msgs, in theory it
+        // would be safe to sync ops for friend A from friend B's cache, if he saved them,
+        // which would mean you could get updates even if a peer was offline.
+        if ( cmd->source()->isLocal() && !cmd->localOnly() )
+        {
+            // save to op-log
+            DatabaseCommandLoggable* command = (DatabaseCommandLoggable*)cmd.data();
+            logOp( command );
+        }
+        else
+        {
+            // Make a note of the last guid we applied for this source
+            // so we can always request just the newer ops in future.
+            //
+            if ( !cmd->singletonCmd() )
+            {
+                TomahawkSqlQuery query = impl->newquery();
+                query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
+                query.addBindValue( cmd->guid() );
+                query.addBindValue( cmd->source()->id() );
+
+                if ( !query.exec() )
+                {
+                    throw "Failed to set lastop";
+                }
+            }
+        }
+    }
+}
+
+
+bool
+DatabaseWorker::applyCommandIsolated( DatabaseImpl* impl, const Tomahawk::dbcmd_ptr& cmd )
+{
+    if ( !impl->newquery().exec( "SAVEPOINT dbcmd" ) )
+        throw "Failed to create savepoint";
+
+    try
+    {
+        applyCommand( impl, cmd );
+    }
+    catch ( const char * msg )
+    {
+        tLog() << endl
+                 << "*ERROR* processing databasecommand, rolling it back:"
+                 << cmd->commandname()
+                 << msg
+                 << impl->database().lastError().databaseText()
+                 << impl->database().lastError().driverText()
+                 << endl;
+
+        impl->newquery().exec( "ROLLBACK TO SAVEPOINT dbcmd" );
+        impl->newquery().exec( "RELEASE SAVEPOINT dbcmd" );
+        return false;
+    }
+
+    if ( !impl->newquery().exec( "RELEASE SAVEPOINT dbcmd" ) )
+        throw "Failed to release savepoint";
+
+    return true;
+}
+
+
+Tomahawk::dbcmd_ptr
+DatabaseWorker::nextCommand( const Tomahawk::dbcmd_ptr& previous, int applied, const QTime& started )
+{
+    QMutexLocker lock( &m_mut );
+
+    const bool groupCommit = m_groupCommitSize > 1 && previous->doesMutates() && applied < m_groupCommitSize;
+    if ( groupCommit && m_commands.isEmpty() )
+    {
+        // give more commands a chance to join this transaction
+        const int remaining = m_groupCommitLatency - started.elapsed();
+        if ( remaining > 0 )
+            m_commandAdded.wait( &m_mut, remaining );
+    }
+
+    if ( m_commands.isEmpty() )
+        return Tomahawk::dbcmd_ptr();
+
+    const Tomahawk::dbcmd_ptr next = m_commands.first();
+    if ( ( previous->groupable() && next->groupable() ) || ( groupCommit && next->doesMutates() ) )
+        return m_commands.takeFirst();
+
+    return Tomahawk::dbcmd_ptr();
+}
+
+
 // this should take a const command, need to check/make json stuff mutable for some objs tho maybe.
 void
 DatabaseWorker::logOp( DatabaseCommandLoggable* command )
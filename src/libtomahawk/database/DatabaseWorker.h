@@ -24,6 +24,8 @@
 #include <QMutex>
 #include <QList>
 #include <QPointer>
+#include <QTime>
+#include <QWaitCondition>
 
 #include "DatabaseCommand.h"
 
@@ -32,6 +34,7 @@ namespace Tomahawk
 
 class Database;
 class DatabaseCommandLoggable;
+class DatabaseImpl;
 
 class DatabaseWorker : public QObject
 {
@@ -53,11 +56,18 @@ private slots:
 
 private:
     void logOp( DatabaseCommandLoggable* command );
+    void applyCommand( DatabaseImpl* impl, const Tomahawk::dbcmd_ptr& cmd );
+    bool applyCommandIsolated( DatabaseImpl* impl, const Tomahawk::dbcmd_ptr& cmd );
+    Tomahawk::dbcmd_ptr nextCommand( const Tomahawk::dbcmd_ptr& previous, int applied, const QTime& started );
 
     QMutex m_mut;
+    QWaitCondition m_commandAdded;
     Database* m_db;
     QList< Tomahawk::dbcmd_ptr > m_commands;
     int m_outstanding;
+
+    int m_groupCommitSize;
+    int m_groupCommitLatency;
 };
 
 class DatabaseWorkerThread : public QThread
@@ -0,0 +1,162 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PlaylistDelta.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+
+namespace Tomahawk
+{
+
+namespace PlaylistDelta
+{
+
+// Indices into values of a longest strictly increasing subsequence
+static QVector< bool >
+longestIncreasing( const QVector< int >& values )
+{
+    QVector< int > tails; // index of the smallest tail of an increasing run per length
+    QVector< int > previous( values.count(), -1 );
+
+    for ( int i = 0; i < values.count(); i++ )
+    {
+        int lo = 0;
+        int hi = tails.count();
+        while ( lo < hi )
+        {
+            const int mid = ( lo + hi ) / 2;
+            if ( values.at( tails.at( mid ) ) < values.at( i ) )
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        if ( lo > 0 )
+            previous[ i ] = tails.at( lo - 1 );
+
+        if ( lo == tails.count() )
+            tails << i;
+        else
+            tails[ lo ] = i;
+    }
+
+    QVector< bool > kept( values.count(), false );
+    for ( int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous.at( i ) )
+        kept[ i ] = true;
+
+    return kept;
+}
+
+
+QVariantMap
+create( const QStringList& from, const QStringList& to )
+{
+    QHash< QString, int > fromPositions;
+    fromPositions.reserve( from.count() );
+    for ( int i = 0; i < from.count(); i++ )
+        fromPositions.insert( from.at( i ), i );
+
+    const QSet< QString > toGuids = to.toSet();
+    if ( fromPositions.count() != from.count() || toGuids.count() != to.count() )
+        return QVariantMap();
+
+    QVariantList deleted;
+    foreach ( const QString& guid, from )
+    {
+        if ( !toGuids.contains( guid ) )
+            deleted << guid;
+    }
+
+    // the entries that stay put are the ones whose old positions keep increasing in the new order
+    QVector< int > oldPositions;
+    QVector< int > newPositions;
+    for ( int i = 0; i < to.count(); i++ )
+    {
+        if ( fromPositions.contains( to.at( i ) ) )
+        {
+            oldPositions << fromPositions.value( to.at( i ) );
+            newPositions << i;
+        }
+    }
+
+    QVector< bool > stays( to.count(), false );
+    const QVector< bool > kept = longestIncreasing( oldPositions );
+    for ( int i = 0; i < kept.count(); i++ )
+    {
+        if ( kept.at( i ) )
+            stays[ newPositions.at( i ) ] = true;
+    }
+
+    QVariantList inserted;
+    for ( int i = 0; i < to.count(); i++ )
+    {
+        if ( stays.at( i ) )
+            continue;
+
+        QVariantList insert;
+        insert << i << to.at( i );
+        inserted << QVariant( insert );
+    }
+
+    QVariantMap delta;
+    delta[ "del" ] = deleted;
+    delta[ "ins" ] = inserted;
+    return delta;
+}
+
+
+QStringList
+apply( const QStringList& from, const QVariantMap& delta )
+{
+    const QVariantList inserted = delta.value( "ins" ).toList();
+
+    QSet< QString > removed;
+    foreach ( const QVariant& guid, delta.value( "del" ).toList() )
+        removed << guid.toString();
+    foreach ( const QVariant& insert, inserted )
+        removed << insert.toList().value( 1 ).toString();
+
+    QStringList entries;
+    entries.reserve( from.count() + inserted.count() );
+    foreach ( const QString& guid, from )
+    {
+        if ( !removed.contains( guid ) )
+            entries << guid;
+    }
+
+    // in ascending order, so everything in front of each position is in place already
+    foreach ( const QVariant& insert, inserted )
+    {
+        const QVariantList pair = insert.toList();
+        entries.insert( qBound( 0, pair.value( 0 ).toInt(), entries.count() ), pair.value( 1 ).toString() );
+    }
+
+    return entries;
+}
+
+
+int
+size( const QVariantMap& delta )
+{
+    return delta.value( "del" ).toList().count() + delta.value( "ins" ).toList().count();
+}
+
+}
+
+}
@@ -0,0 +1,59 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLISTDELTA_H
+#define PLAYLISTDELTA_H
+
+#include <QStringList>
+#include <QVariantMap>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/**
+ * Playlist revisions are stored as the changes to the entry guids of the
+ * revision they are based on:
+ *
+ *   { "del": [ guid, ... ], "ins": [ [ position, guid ], ... ] }
+ *
+ * "del" are the guids that are gone. "ins" are the guids that were added or
+ * moved, with their position in the new revision, in ascending order. All
+ * other entries keep their relative order.
+ */
+namespace PlaylistDelta
+{
+    /**
+     * The changes that turn @p from into @p to. Returns an empty map if the
+     * lists can't be expressed as a delta, i.e. if they contain a guid twice.
+     */
+    DLLEXPORT QVariantMap create( const QStringList& from, const QStringList& to );
+
+    /**
+     * Applies a delta made by create() to the list it was made from.
+     */
+    DLLEXPORT QStringList apply( const QStringList& from, const QVariantMap& delta );
+
+    /**
+     * Number of changes in @p delta.
+     */
+    DLLEXPORT int size( const QVariantMap& delta );
+}
+
+}
+
+#endif // PLAYLISTDELTA_H
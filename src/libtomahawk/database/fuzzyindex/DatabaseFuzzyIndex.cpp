@@ -20,9 +20,11 @@
 
 #include "database/DatabaseImpl.h"
 #include "database/Database.h"
+#include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
 
 #include <QDir>
+#include <QTimer>
 
 
 namespace Tomahawk {
@@ -32,6 +34,12 @@ static QString s_indexPathName = "tomahawk.lucene";
 DatabaseFuzzyIndex::DatabaseFuzzyIndex( QObject* parent, bool wipe )
     : FuzzyIndex( parent, s_indexPathName, wipe )
 {
+    // Indexes written by older versions can't be updated incrementally
+    if ( !supportsIncrementalUpdates() )
+    {
+        tLog() << "Rebuilding fuzzy index to enable incremental updates";
+        QTimer::singleShot( 0, this, SLOT( updateIndexSlot() ) );
+    }
 }
 
 
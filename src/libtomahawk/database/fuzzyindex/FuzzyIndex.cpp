@@ -31,11 +31,17 @@
 
 #include <lucene++/FuzzyQuery.h>
 
+// Merge segments created by incremental updates every X commits
+#define MERGE_INTERVAL 50
+// ... down to at most X segments
+#define MERGE_MAX_SEGMENTS 5
+
 using namespace Lucene;
 
 
 FuzzyIndex::FuzzyIndex( QObject* parent, const QString& filename, bool wipe )
     : QObject( parent )
+    , m_incrementalCommits( 0 )
 {
     m_lucenePath = TomahawkUtils::appDataDir().absoluteFilePath( filename );
 
@@ -45,8 +51,7 @@ FuzzyIndex::FuzzyIndex( QObject* parent, const QString& filename, bool wipe )
     {
         m_analyzer = newLucene<SimpleAnalyzer>();
         m_luceneDir = FSDirectory::open( m_lucenePath.toStdWString() );
-        m_luceneReader = IndexReader::open( m_luceneDir );
-        m_luceneSearcher = newLucene<IndexSearcher>( m_luceneReader );
+        setReader( IndexReader::open( m_luceneDir ) );
     }
     catch ( LuceneException& error )
     {
@@ -117,9 +122,9 @@ FuzzyIndex::endIndexing()
     m_luceneWriter->optimize();
     m_luceneWriter->close();
     m_luceneWriter.reset();
+    m_incrementalCommits = 0;
 
-    m_luceneReader = IndexReader::open( m_luceneDir );
-    m_luceneSearcher = newLucene<IndexSearcher>( m_luceneReader );
+    setReader( IndexReader::open( m_luceneDir ) );
 
     m_mutex.unlock();
     emit indexReady();
@@ -131,60 +136,241 @@ FuzzyIndex::appendFields( const Tomahawk::IndexData& data )
 {
     try
     {
-        DocumentPtr doc = newLucene<Document>();
+        DocumentPtr doc = document( data );
+        if ( doc )
+            m_luceneWriter->addDocument( doc );
+    }
+    catch( LuceneException& error )
+    {
+        tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
 
-        if ( !data.track.isEmpty() )
-        {
-            doc->add(newLucene<Field>( L"fulltext", Tomahawk::DatabaseImpl::sortname( QString( "%1 %2" ).arg( data.artist ).arg( data.track ) ).toStdWString(),
-                                       Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+        QTimer::singleShot( 0, this, SLOT( wipeIndex() ) );
+    }
+}
 
-            doc->add(newLucene<Field>( L"track", Tomahawk::DatabaseImpl::sortname( data.track ).toStdWString(),
-                                       Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
 
-            doc->add(newLucene<Field>( L"artist", Tomahawk::DatabaseImpl::sortname( data.artist ).toStdWString(),
-                                       Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+void
+FuzzyIndex::updateEntries( const QList< Tomahawk::IndexData >& entries )
+{
+    if ( entries.isEmpty() )
+        return;
 
-            doc->add(newLucene<Field>( L"artistid", QString::number( data.artistId ).toStdWString(),
-                                       Field::STORE_YES, Field::INDEX_NO ) );
+    QMutexLocker lock( &m_mutex );
 
-            doc->add(newLucene<Field>( L"trackid", QString::number( data.id ).toStdWString(),
-                                       Field::STORE_YES, Field::INDEX_NO ) );
-        }
-        else if ( !data.album.isEmpty() )
+    try
+    {
+        IndexWriterPtr writer = openWriter();
+        foreach ( const Tomahawk::IndexData& data, entries )
         {
-            doc->add(newLucene<Field>( L"album", Tomahawk::DatabaseImpl::sortname( data.album ).toStdWString(),
-                                       Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
-
-            doc->add(newLucene<Field>( L"albumid", QString::number( data.id ).toStdWString(),
-                                       Field::STORE_YES, Field::INDEX_NO ) );
+            DocumentPtr doc = document( data );
+            if ( !doc )
+                continue;
+
+            if ( !data.track.isEmpty() )
+                writer->updateDocument( newLucene<Term>( L"trackid", QString::number( data.id ).toStdWString() ), doc );
+            else
+                writer->updateDocument( newLucene<Term>( L"albumid", QString::number( data.id ).toStdWString() ), doc );
         }
-        else
-            return;
 
-        m_luceneWriter->addDocument( doc );
+        commitWriter( writer );
     }
     catch( LuceneException& error )
     {
         tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
 
         QTimer::singleShot( 0, this, SLOT( wipeIndex() ) );
+        return;
     }
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Updated" << entries.count() << "entries in" << m_lucenePath;
 }
 
 
 void
-FuzzyIndex::deleteIndex()
+FuzzyIndex::deleteTracks( const QList< unsigned int >& trackIds )
+{
+    if ( trackIds.isEmpty() )
+        return;
+
+    QMutexLocker lock( &m_mutex );
+
+    try
+    {
+        IndexWriterPtr writer = openWriter();
+        foreach ( unsigned int id, trackIds )
+            writer->deleteDocuments( newLucene<Term>( L"trackid", QString::number( id ).toStdWString() ) );
+
+        commitWriter( writer );
+    }
+    catch( LuceneException& error )
+    {
+        tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
+
+        QTimer::singleShot( 0, this, SLOT( wipeIndex() ) );
+        return;
+    }
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Deleted" << trackIds.count() << "tracks from" << m_lucenePath;
+}
+
+
+DocumentPtr
+FuzzyIndex::document( const Tomahawk::IndexData& data )
+{
+    DocumentPtr doc = newLucene<Document>();
+
+    // ids are indexed so entries can be replaced and deleted incrementally
+    if ( !data.track.isEmpty() )
+    {
+        doc->add(newLucene<Field>( L"fulltext", Tomahawk::DatabaseImpl::sortname( QString( "%1 %2" ).arg( data.artist ).arg( data.track ) ).toStdWString(),
+                                   Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+
+        doc->add(newLucene<Field>( L"track", Tomahawk::DatabaseImpl::sortname( data.track ).toStdWString(),
+                                   Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+
+        doc->add(newLucene<Field>( L"artist", Tomahawk::DatabaseImpl::sortname( data.artist ).toStdWString(),
+                                   Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+
+        doc->add(newLucene<Field>( L"artistid", QString::number( data.artistId ).toStdWString(),
+                                   Field::STORE_YES, Field::INDEX_NO ) );
+
+        doc->add(newLucene<Field>( L"trackid", QString::number( data.id ).toStdWString(),
+                                   Field::STORE_YES, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+    }
+    else if ( !data.album.isEmpty() )
+    {
+        doc->add(newLucene<Field>( L"album", Tomahawk::DatabaseImpl::sortname( data.album ).toStdWString(),
+                                   Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+
+        doc->add(newLucene<Field>( L"albumid", QString::number( data.id ).toStdWString(),
+                                   Field::STORE_YES, Field::INDEX_NOT_ANALYZED_NO_NORMS ) );
+    }
+    else
+        return DocumentPtr();
+
+    return doc;
+}
+
+
+IndexWriterPtr
+FuzzyIndex::openWriter()
+{
+    const bool create = !IndexReader::indexExists( m_luceneDir );
+    return newLucene<IndexWriter>( m_luceneDir, m_analyzer, create, IndexWriter::MaxFieldLengthLIMITED );
+}
+
+
+void
+FuzzyIndex::commitWriter( const IndexWriterPtr& writer )
+{
+    // Keep the number of segments small, every segment slows down searching
+    if ( ++m_incrementalCommits % MERGE_INTERVAL == 0 )
+    {
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Merging segments:" << m_lucenePath;
+        writer->optimize( MERGE_MAX_SEGMENTS );
+    }
+
+    writer->commit();
+    writer->close();
+
+    reopenReader();
+}
+
+
+void
+FuzzyIndex::reopenReader()
+{
+    // only called with m_mutex held, nobody else replaces the reader meanwhile
+    IndexReaderPtr current;
+    {
+        QMutexLocker lock( &m_readerMutex );
+        current = m_luceneReader;
+    }
+
+    // reopen() only loads the segments that changed since the reader was opened
+    IndexReaderPtr reader = current ? current->reopen() : IndexReader::open( m_luceneDir );
+    if ( reader != current )
+        setReader( reader );
+}
+
+
+void
+FuzzyIndex::setReader( const IndexReaderPtr& reader )
 {
-    if ( m_luceneReader )
+    IndexReaderPtr old;
     {
-        tDebug( LOGVERBOSE ) << "Deleting old lucene stuff.";
+        QMutexLocker lock( &m_readerMutex );
+        old = m_luceneReader;
+        m_luceneReader = reader;
+        m_luceneSearcher = reader ? newLucene<IndexSearcher>( reader ) : IndexSearcherPtr();
+    }
+
+    // Searches still running on the old reader hold a reference to it,
+    // it actually gets closed when the last of them releases it
+    if ( old )
+        old->close();
+}
+
+
+bool
+FuzzyIndex::acquireSearcher( IndexReaderPtr& reader, IndexSearcherPtr& searcher )
+{
+    QMutexLocker lock( &m_readerMutex );
+    if ( !m_luceneReader || !m_luceneSearcher )
+        return false;
+
+    reader = m_luceneReader;
+    searcher = m_luceneSearcher;
+    reader->incRef();
+
+    return true;
+}
+
 
-        m_luceneSearcher->close();
-        m_luceneReader->close();
-        m_luceneSearcher.reset();
-        m_luceneReader.reset();
+void
+FuzzyIndex::releaseSearcher( const IndexReaderPtr& reader )
+{
+    try
+    {
+        reader->decRef();
+    }
+    catch( LuceneException& error )
+    {
+        tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
+    }
+}
+
+
+bool
+FuzzyIndex::supportsIncrementalUpdates()
+{
+    IndexReaderPtr reader;
+    IndexSearcherPtr searcher;
+    if ( !acquireSearcher( reader, searcher ) )
+        return true;
+
+    bool supported = false;
+    try
+    {
+        supported = reader->numDocs() == 0 ||
+                    reader->getFieldNames( IndexReader::FIELD_OPTION_INDEXED ).contains( L"trackid" );
+    }
+    catch( LuceneException& error )
+    {
+        tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
     }
 
+    releaseSearcher( reader );
+    return supported;
+}
+
+
+void
+FuzzyIndex::deleteIndex()
+{
+    tDebug( LOGVERBOSE ) << "Deleting old lucene stuff.";
+    setReader( IndexReaderPtr() );
+
     TomahawkUtils::removeDirectory( m_lucenePath );
 }
 
@@ -206,66 +392,85 @@ FuzzyIndex::loadLuceneIndex()
 QMap< int, float >
 FuzzyIndex::search( const Tomahawk::query_ptr& query )
 {
-//    QMutexLocker lock( &m_mutex );
-    QMap< int, float > resultsmap;
-    if ( !m_luceneReader || !m_luceneSearcher )
-        return resultsmap;
+    QList< Tomahawk::query_ptr > queries;
+    queries << query;
 
-    try
+    return search( queries ).value( query->id() );
+}
+
+
+QHash< Tomahawk::QID, QMap< int, float > >
+FuzzyIndex::search( const QList< Tomahawk::query_ptr >& queries )
+{
+    QHash< Tomahawk::QID, QMap< int, float > > resultsmaps;
+
+    // all queries of a batch are run against the same searcher, even if the index gets reloaded meanwhile
+    IndexReaderPtr reader;
+    IndexSearcherPtr searcher;
+    if ( !acquireSearcher( reader, searcher ) )
+        return resultsmaps;
+
+    foreach ( const Tomahawk::query_ptr& query, queries )
     {
-//        float minScore = 0.00;
-        Collection<String> fields; // = newCollection<String>();
-        BooleanQueryPtr qry = newLucene<BooleanQuery>();
+        QMap< int, float >& resultsmap = resultsmaps[ query->id() ];
 
-        if ( query->isFullTextQuery() )
+        try
         {
-            const QString q = Tomahawk::DatabaseImpl::sortname( query->fullTextQuery() );
+//            float minScore = 0.00;
+            Collection<String> fields; // = newCollection<String>();
+            BooleanQueryPtr qry = newLucene<BooleanQuery>();
 
-            FuzzyQueryPtr fqry = newLucene<FuzzyQuery>( newLucene<Term>( L"track", q.toStdWString() ) );
-            qry->add( boost::dynamic_pointer_cast<Query>( fqry ), BooleanClause::SHOULD );
+            if ( query->isFullTextQuery() )
+            {
+                const QString q = Tomahawk::DatabaseImpl::sortname( query->fullTextQuery() );
 
-            FuzzyQueryPtr fqry2 = newLucene<FuzzyQuery>( newLucene<Term>( L"artist", q.toStdWString() ) );
-            qry->add( boost::dynamic_pointer_cast<Query>( fqry2 ), BooleanClause::SHOULD );
+                FuzzyQueryPtr fqry = newLucene<FuzzyQuery>( newLucene<Term>( L"track", q.toStdWString() ) );
+                qry->add( boost::dynamic_pointer_cast<Query>( fqry ), BooleanClause::SHOULD );
 
-            FuzzyQueryPtr fqry3 = newLucene<FuzzyQuery>( newLucene<Term>( L"fulltext", q.toStdWString() ) );
-            qry->add( boost::dynamic_pointer_cast<Query>( fqry3 ), BooleanClause::SHOULD );
-        }
-        else
-        {
-            const QString track = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->track() );
-            const QString artist = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->artist() );
-            //QString album = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->album() );
+                FuzzyQueryPtr fqry2 = newLucene<FuzzyQuery>( newLucene<Term>( L"artist", q.toStdWString() ) );
+                qry->add( boost::dynamic_pointer_cast<Query>( fqry2 ), BooleanClause::SHOULD );
 
-            FuzzyQueryPtr fqry = newLucene<FuzzyQuery>( newLucene<Term>( L"track", track.toStdWString() ), 0.5, 3 );
-            qry->add( boost::dynamic_pointer_cast<Query>( fqry ), BooleanClause::MUST );
+                FuzzyQueryPtr fqry3 = newLucene<FuzzyQuery>( newLucene<Term>( L"fulltext", q.toStdWString() ) );
+                qry->add( boost::dynamic_pointer_cast<Query>( fqry3 ), BooleanClause::SHOULD );
+            }
+            else
+            {
+                const QString track = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->track() );
+                const QString artist = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->artist() );
+                //QString album = Tomahawk::DatabaseImpl::sortname( query->queryTrack()->album() );
 
-            FuzzyQueryPtr fqry2 = newLucene<FuzzyQuery>( newLucene<Term>( L"artist", artist.toStdWString() ), 0.5, 3 );
-            qry->add( boost::dynamic_pointer_cast<Query>( fqry2 ), BooleanClause::MUST );
-        }
+                FuzzyQueryPtr fqry = newLucene<FuzzyQuery>( newLucene<Term>( L"track", track.toStdWString() ), 0.5, 3 );
+                qry->add( boost::dynamic_pointer_cast<Query>( fqry ), BooleanClause::MUST );
 
-        TopScoreDocCollectorPtr collector = TopScoreDocCollector::create( 20, true );
-        m_luceneSearcher->search( qry, collector );
-        Collection<ScoreDocPtr> hits = collector->topDocs()->scoreDocs;
+                FuzzyQueryPtr fqry2 = newLucene<FuzzyQuery>( newLucene<Term>( L"artist", artist.toStdWString() ), 0.5, 3 );
+                qry->add( boost::dynamic_pointer_cast<Query>( fqry2 ), BooleanClause::MUST );
+            }
 
-        for ( int i = 0; i < collector->getTotalHits() && i < 20; i++ )
-        {
-            DocumentPtr d = m_luceneSearcher->doc( hits[i]->doc );
-            const float score = hits[i]->score;
-            const int id = QString::fromStdWString( d->get( L"trackid" ) ).toInt();
+            TopScoreDocCollectorPtr collector = TopScoreDocCollector::create( 20, true );
+            searcher->search( qry, collector );
+            Collection<ScoreDocPtr> hits = collector->topDocs()->scoreDocs;
 
-//            if ( score > minScore )
+            for ( int i = 0; i < collector->getTotalHits() && i < 20; i++ )
             {
-                resultsmap.insert( id, score );
-//                tDebug() << "Index hit:" << id << score << QString::fromWCharArray( ((Query*)qry)->toString() );
+                DocumentPtr d = searcher->doc( hits[i]->doc );
+                const float score = hits[i]->score;
+                const int id = QString::fromStdWString( d->get( L"trackid" ) ).toInt();
+
+//                if ( score > minScore )
+                {
+                    resultsmap.insert( id, score );
+//                    tDebug() << "Index hit:" << id << score << QString::fromWCharArray( ((Query*)qry)->toString() );
+                }
             }
         }
-    }
-    catch( LuceneException& error )
-    {
-        tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() ) << query->toString();
+        catch( LuceneException& error )
+        {
+            tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() ) << query->toString();
+        }
     }
 
-    return resultsmap;
+    releaseSearcher( reader );
+    return resultsmaps;
 }
 
 
@@ -274,9 +479,10 @@ FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
 {
     Q_ASSERT( query->isFullTextQuery() );
 
-//    QMutexLocker lock( &m_mutex );
     QMap< int, float > resultsmap;
-    if ( !m_luceneReader || !m_luceneSearcher )
+    IndexReaderPtr reader;
+    IndexSearcherPtr searcher;
+    if ( !acquireSearcher( reader, searcher ) )
         return resultsmap;
 
     try
@@ -286,12 +492,12 @@ FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
 
         FuzzyQueryPtr qry = newLucene<FuzzyQuery>( newLucene<Term>( L"album", q.toStdWString() ) );
         TopScoreDocCollectorPtr collector = TopScoreDocCollector::create( 99999, false );
-        m_luceneSearcher->search( boost::dynamic_pointer_cast<Query>( qry ), collector );
+        searcher->search( boost::dynamic_pointer_cast<Query>( qry ), collector );
         Collection<ScoreDocPtr> hits = collector->topDocs()->scoreDocs;
 
         for ( int i = 0; i < collector->getTotalHits(); i++ )
         {
-            DocumentPtr d = m_luceneSearcher->doc( hits[i]->doc );
+            DocumentPtr d = searcher->doc( hits[i]->doc );
             float score = hits[i]->score;
             int id = QString::fromStdWString( d->get( L"albumid" ) ).toInt();
 
@@ -307,5 +513,6 @@ FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
         tDebug() << "Caught Lucene error:" << QString::fromWCharArray( error.getError().c_str() );
     }
 
+    releaseSearcher( reader );
     return resultsmap;
 }
@@ -42,6 +42,17 @@ public:
     void endIndexing();
     void appendFields( const Tomahawk::IndexData& data );
 
+    /**
+     * Add the given entries to the index, replacing documents with the same
+     * track / album id, without rebuilding the whole index.
+     */
+    void updateEntries( const QList< Tomahawk::IndexData >& entries );
+
+    /**
+     * Remove the documents of the given tracks from the index.
+     */
+    void deleteTracks( const QList< unsigned int >& trackIds );
+
     /**
      * Delete the index from the harddrive.
      *
@@ -60,13 +71,31 @@ public slots:
     bool wipeIndex();
 
     QMap< int, float > search( const Tomahawk::query_ptr& query );
+    QHash< Tomahawk::QID, QMap< int, float > > search( const QList< Tomahawk::query_ptr >& queries );
     QMap< int, float > searchAlbum( const Tomahawk::query_ptr& query );
 
+protected:
+    /// Whether the index on disk supports updating and deleting by id
+    bool supportsIncrementalUpdates();
+
 private slots:
     void updateIndexSlot();
 
 private:
+    static Lucene::DocumentPtr document( const Tomahawk::IndexData& data );
+    Lucene::IndexWriterPtr openWriter();
+    void commitWriter( const Lucene::IndexWriterPtr& writer );
+    void reopenReader();
+    void setReader( const Lucene::IndexReaderPtr& reader );
+
+    /// Copies the current reader / searcher pair, the reader stays open until releaseSearcher()
+    bool acquireSearcher( Lucene::IndexReaderPtr& reader, Lucene::IndexSearcherPtr& searcher );
+    void releaseSearcher( const Lucene::IndexReaderPtr& reader );
+
+    // Held while the index is written
     QMutex m_mutex;
+    // Guards swapping m_luceneReader and m_luceneSearcher, searches only hold it to copy them
+    QMutex m_readerMutex;
     QString m_lucenePath;
 
     boost::shared_ptr<Lucene::SimpleAnalyzer> m_analyzer;
@@ -74,6 +103,8 @@ private:
     Lucene::IndexReaderPtr m_luceneReader;
     Lucene::FSDirectoryPtr m_luceneDir;
     Lucene::IndexSearcherPtr m_luceneSearcher;
+
+    unsigned int m_incrementalCommits;
 };
 
 #endif // FUZZYINDEX_H
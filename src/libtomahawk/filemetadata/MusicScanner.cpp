@@ -35,8 +35,40 @@
 
 #include "config.h"
 
+#include <QRunnable>
+
+// How many files per tag reading thread DirLister may hand out ahead of the scanner
+#define FILES_PER_THREAD 8
+// Longest DirLister waits for the database to list known files, in ms
+#define MTIMES_TIMEOUT 20000
+
 using namespace Tomahawk;
 
+
+// Reads the tags of a single file on MusicScanner's thread pool
+class TagReader : public QRunnable
+{
+public:
+    TagReader( QObject* receiver, uint job, const QFileInfo& fi )
+        : m_receiver( receiver )
+        , m_job( job )
+        , m_fileInfo( fi.absoluteFilePath() ) // don't share QFileInfo's data across threads
+    {
+    }
+
+    void run()
+    {
+        const QVariant m = MusicScanner::readTags( m_fileInfo );
+        QMetaObject::invokeMethod( m_receiver, "tagsRead", Qt::QueuedConnection, Q_ARG( uint, m_job ), Q_ARG( QVariant, m ) );
+    }
+
+private:
+    QObject* m_receiver;
+    uint m_job;
+    QFileInfo m_fileInfo;
+};
+
+
 void
 DirLister::go()
 {
@@ -51,12 +83,9 @@ DirLister::go()
 void
 DirLister::scanDir( QDir dir, int depth )
 {
-    if ( isDeleting() )
+    if ( isDeleting() || m_aborted )
     {
-        m_opcount--;
-        if ( m_opcount == 0 )
-            emit finished();
-
+        opFinished();
         return;
     }
 
@@ -64,22 +93,87 @@ DirLister::scanDir( QDir dir, int depth )
     if ( !dir.exists() || m_processedDirs.contains( dir.canonicalPath() ) )
     {
         tDebug( LOGVERBOSE ) << "Dir no longer exists or already scanned, ignoring";
-
-        m_opcount--;
-        if ( m_opcount == 0 )
-            emit finished();
-
+        opFinished();
         return;
     }
 
-    m_processedDirs << dir.canonicalPath();
+    const QString path = dir.canonicalPath();
+    m_processedDirs << path;
+    m_dirMtimes.insert( path, QFileInfo( path ).lastModified().toUTC().toTime_t() );
 
     QFileInfoList filteredEntries;
     dir.setFilter( QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
     dir.setSorting( QDir::Name );
     filteredEntries = dir.entryInfoList();
-    foreach ( const QFileInfo& di, filteredEntries )
+
+    QFileInfoList files;
+    if ( m_compare )
+    {
+        // files may be symlinks into other dirs, look those up as well
+        QStringList dirs;
+        dirs << path;
+        foreach ( const QFileInfo& fi, filteredEntries )
+        {
+            const QString fileDir = QFileInfo( fi.canonicalFilePath() ).absolutePath();
+            if ( !dirs.contains( fileDir ) )
+                dirs << fileDir;
+        }
+        foreach ( const QString& d, dirs )
+            m_comparedDirs << d;
+
+        DatabaseCommand_FileMtimes* cmd = new DatabaseCommand_FileMtimes();
+        cmd->setDirectories( dirs );
+        QMap< QString, QMap< unsigned int, unsigned int > > known;
+        if ( !loadMtimes( cmd, known ) )
+        {
+            // Without the known files every file would look new and get added a second time.
+            // Stop here, the next scan picks up whatever we didn't get to.
+            tLog() << Q_FUNC_INFO << "Aborting scan, could not load known files of" << path;
+            m_aborted = true;
+            opFinished();
+            return;
+        }
+
+        QVariantList stale;
+        foreach ( const QFileInfo& fi, filteredEntries )
+        {
+            const QString url = "file://" + fi.canonicalFilePath();
+            if ( known.contains( url ) )
+            {
+                const QMap< unsigned int, unsigned int > entry = known.take( url );
+                if ( !entry.isEmpty() )
+                {
+                    if ( fi.lastModified().toUTC().toTime_t() == entry.values().first() )
+                        continue;
+
+                    stale << entry.keys().first();
+                }
+            }
+
+            files << fi;
+        }
+
+        // whatever is left in this dir is gone from disk
+        const QString prefix = "file://" + ( path.endsWith( '/' ) ? path : path + '/' );
+        foreach ( const QString& url, known.keys() )
+        {
+            if ( url.startsWith( prefix ) && url.indexOf( '/', prefix.length() ) < 0 && !known.value( url ).isEmpty() )
+                stale << known.value( url ).keys().first();
+        }
+
+        if ( !stale.isEmpty() )
+            emit filesDeleted( stale );
+    }
+    else
+        files = filteredEntries;
+
+    foreach ( const QFileInfo& di, files )
+    {
+        if ( !acquireFileSlot() )
+            break;
+
         emit fileToScan( di );
+    }
 
     dir.setFilter( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
     filteredEntries = dir.entryInfoList();
@@ -90,17 +184,121 @@ DirLister::scanDir( QDir dir, int depth )
         QMetaObject::invokeMethod( this, "scanDir", Qt::QueuedConnection, Q_ARG( QDir, di.canonicalFilePath() ), Q_ARG( int, depth + 1 ) );
     }
 
+    opFinished();
+}
+
+
+void
+DirLister::opFinished()
+{
     m_opcount--;
-    if ( m_opcount == 0 )
+    if ( m_opcount > 0 )
+        return;
+
+    // files in dirs we never came across are gone, unless we were interrupted
+    QMap< QString, QMap< unsigned int, unsigned int > > orphans;
+    if ( m_compare && !isDeleting() && !m_aborted )
     {
-        tDebug() << Q_FUNC_INFO << "emitting finished";
-        emit finished();
+        DatabaseCommand_FileMtimes* cmd = new DatabaseCommand_FileMtimes();
+        cmd->setExcludedDirectories( m_comparedDirs );
+        m_aborted = !loadMtimes( cmd, orphans );
     }
+
+    if ( m_compare && !isDeleting() && !m_aborted )
+    {
+        QVariantList stale;
+        foreach ( const QString& url, orphans.keys() )
+        {
+            if ( !orphans.value( url ).isEmpty() )
+                stale << orphans.value( url ).keys().first();
+        }
+
+        tDebug( LOGVERBOSE ) << "Files in dirs that are gone:" << stale.count();
+        if ( !stale.isEmpty() )
+            emit filesDeleted( stale );
+
+        emit dirsScanned( m_dirMtimes );
+    }
+    else if ( m_aborted )
+        tLog() << Q_FUNC_INFO << "Scan aborted, leaving the remaining dirs for the next scan";
+
+    tDebug() << Q_FUNC_INFO << "emitting finished";
+    emit finished();
+}
+
+
+bool
+DirLister::loadMtimes( DatabaseCommand_FileMtimes* cmd, QMap< QString, QMap< unsigned int, unsigned int > >& mtimes )
+{
+    {
+        QMutexLocker locker( &m_mtimesMutex );
+        cmd->setRequestId( ++m_mtimesRequest );
+    }
+
+    connect( cmd, SIGNAL( mtimesLoaded( uint, QMap< QString, QMap< unsigned int, unsigned int > > ) ),
+                    SLOT( onMtimes( uint, QMap< QString, QMap< unsigned int, unsigned int > > ) ), Qt::DirectConnection );
+    Database::instance()->enqueue( dbcmd_ptr( cmd ) );
+
+    // onMtimes() is called on the database's thread, we just wait for it here. If the
+    // database is busy or shutting down, give up rather than hang.
+    int waited = 0;
+    while ( !m_mtimesReady.tryAcquire( 1, 100 ) )
+    {
+        waited += 100;
+        if ( isDeleting() || waited >= MTIMES_TIMEOUT )
+        {
+            tLog() << Q_FUNC_INFO << "Gave up waiting for known files, after" << waited << "ms";
+
+            // a late answer to this request must not be taken for the next one's
+            QMutexLocker locker( &m_mtimesMutex );
+            ++m_mtimesRequest;
+            m_mtimesReady.tryAcquire();
+            return false;
+        }
+    }
+
+    QMutexLocker locker( &m_mtimesMutex );
+    mtimes = m_mtimes;
+    m_mtimes.clear();
+
+    return true;
+}
+
+
+void
+DirLister::onMtimes( uint requestId, const QMap< QString, QMap< unsigned int, unsigned int > >& mtimes )
+{
+    // released under the lock, so loadMtimes() giving up can't miss it
+    QMutexLocker locker( &m_mtimesMutex );
+    if ( requestId != m_mtimesRequest )
+        return;
+
+    m_mtimes = mtimes;
+    m_mtimesReady.release();
+}
+
+
+bool
+DirLister::acquireFileSlot()
+{
+    if ( !m_fileSlots )
+        return true;
+
+    // wait until the scanner caught up, but don't block forever when we're being stopped
+    while ( !m_fileSlots->tryAcquire( 1, 100 ) )
+    {
+        if ( isDeleting() )
+            return false;
+    }
+
+    return true;
 }
 
 
 DirListerThreadController::DirListerThreadController( QObject *parent )
     : QThread( parent )
+    , m_fileSlots( 0 )
+    , m_compare( false )
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
 }
@@ -112,12 +310,25 @@ DirListerThreadController::~DirListerThreadController()
 }
 
 
+void
+DirListerThreadController::stop()
+{
+    if ( !m_dirLister.isNull() )
+        m_dirLister.data()->setIsDeleting();
+}
+
+
 void
 DirListerThreadController::run()
 {
-    m_dirLister = QPointer< DirLister >( new DirLister( m_paths ) );
+    m_dirLister = QPointer< DirLister >( new DirLister( m_paths, m_fileSlots ) );
+    m_dirLister.data()->setCompareWithDatabase( m_compare );
     connect( m_dirLister.data(), SIGNAL( fileToScan( QFileInfo ) ),
              parent(), SLOT( scanFile( QFileInfo ) ), Qt::QueuedConnection );
+    connect( m_dirLister.data(), SIGNAL( filesDeleted( QVariantList ) ),
+             parent(), SLOT( deleteFiles( QVariantList ) ), Qt::QueuedConnection );
+    connect( m_dirLister.data(), SIGNAL( dirsScanned( QMap< QString, unsigned int > ) ),
+             parent(), SLOT( setDirMtimes( QMap< QString, unsigned int > ) ), Qt::QueuedConnection );
 
     // queued, so will only fire after all dirs have been scanned:
     connect( m_dirLister.data(), SIGNAL( finished() ),
@@ -141,7 +352,12 @@ MusicScanner::MusicScanner( MusicScanner::ScanMode scanMode, const QStringList&
     , m_cmdQueue( 0 )
     , m_batchsize( bs )
     , m_dirListerThreadController( 0 )
+    , m_compareMtimes( false )
+    , m_nextJob( 0 )
+    , m_nextResult( 0 )
+    , m_listingFinished( false )
 {
+    m_tagPool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() ) );
 }
 
 
@@ -151,12 +367,15 @@ MusicScanner::~MusicScanner()
 
     if ( m_dirListerThreadController )
     {
+        m_dirListerThreadController->stop();
         m_dirListerThreadController->quit();
         m_dirListerThreadController->wait( 60000 );
 
         delete m_dirListerThreadController;
         m_dirListerThreadController = 0;
     }
+
+    m_tagPool.waitForDone();
 }
 
 
@@ -188,20 +407,56 @@ MusicScanner::verbose()
 }
 
 
+void
+MusicScanner::setThreads( int threads )
+{
+    m_tagPool.setMaxThreadCount( qMax( 1, threads ) );
+}
+
+
+int
+MusicScanner::threads() const
+{
+    return m_tagPool.maxThreadCount();
+}
+
+
 void
 MusicScanner::startScan()
 {
-    tDebug( LOGVERBOSE ) << "Loading mtimes...";
     m_scanned = m_skipped = m_cmdQueue = 0;
     m_skippedFiles.clear();
 
     emit progress( m_scanned );
 
-    // trigger the scan once we've loaded old filemtimes
-    //FIXME: For multiple collection support make sure the right prefix gets passed in...or not...
-    //bear in mind that simply passing in the top-level of a defined collection means it will not return items that need
-    //to be removed that aren't in that root any longer -- might have to do the filtering in setMTimes based on strings
-    DatabaseCommand_FileMtimes *cmd = new DatabaseCommand_FileMtimes();
+    if ( m_scanMode == MusicScanner::DirScan )
+    {
+        // DirLister compares with the database one dir at a time, no need to load all mtimes up front
+        m_compareMtimes = true;
+        scan();
+        return;
+    }
+
+    // trigger the scan once we've loaded the old mtimes of the files and dirs we were given
+    tDebug( LOGVERBOSE ) << "Loading mtimes...";
+    QStringList files;
+    QStringList dirs;
+    foreach ( const QString& path, m_paths )
+    {
+        if ( QFileInfo( path ).isFile() )
+            files << path;
+        else
+            dirs << path;
+    }
+
+    if ( files.isEmpty() && dirs.isEmpty() )
+    {
+        scan();
+        return;
+    }
+
+    DatabaseCommand_FileMtimes *cmd = new DatabaseCommand_FileMtimes( files );
+    cmd->setDirectories( dirs );
     connect( cmd, SIGNAL( done( QMap< QString, QMap< unsigned int, unsigned int > > ) ),
                     SLOT( setFileMtimes( QMap< QString, QMap< unsigned int, unsigned int > > ) ) );
 
@@ -227,14 +482,25 @@ MusicScanner::scan()
     connect( this, SIGNAL( batchReady( QVariantList, QVariantList ) ),
                      SLOT( commitBatch( QVariantList, QVariantList ) ), Qt::DirectConnection );
 
+    // these lazily fill static tables, make sure that happened before the tag readers use them
+    TomahawkUtils::supportedExtensions();
+    TomahawkUtils::extensionToMimetype( QString() );
+
+    tDebug( LOGVERBOSE ) << "Reading tags with" << threads() << "threads";
+
     if ( m_scanMode == MusicScanner::FileScan )
     {
         scanFilePaths();
         return;
     }
 
+    // DirLister may only list as many files ahead as we can keep our tag readers busy with
+    m_fileSlots.release( threads() * FILES_PER_THREAD );
+
     m_dirListerThreadController = new DirListerThreadController( this );
     m_dirListerThreadController->setPaths( m_paths );
+    m_dirListerThreadController->setFileSlots( &m_fileSlots );
+    m_dirListerThreadController->setCompareWithDatabase( m_compareMtimes );
     m_dirListerThreadController->start( QThread::IdlePriority );
 }
 
@@ -246,7 +512,16 @@ MusicScanner::scanFilePaths()
     foreach( QString path, m_paths )
     {
         QFileInfo fi( path );
-        if ( fi.exists() && fi.isReadable() )
+        if ( fi.isDir() )
+        {
+            // a dir stands for the files directly inside of it
+            QDir dir( path );
+            dir.setFilter( QDir::Files | QDir::Readable | QDir::NoDotAndDotDot );
+            dir.setSorting( QDir::Name );
+            foreach ( const QFileInfo& file, dir.entryInfoList() )
+                scanFile( file );
+        }
+        else if ( fi.exists() && fi.isReadable() )
             scanFile( fi );
     }
 
@@ -259,12 +534,18 @@ MusicScanner::postOps()
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
 
-    if ( m_scanMode == MusicScanner::DirScan )
+    // tagsRead() calls us again once the last file has been handled
+    m_listingFinished = true;
+    if ( !m_pendingFiles.isEmpty() )
+        return;
+
+    if ( m_scanMode == MusicScanner::FileScan )
     {
-        // any remaining stuff that wasnt emitted as a batch:
+        // files we knew about in the given paths, but which are gone now
+        // (DirLister takes care of this for dir scans)
         foreach( const QString& key, m_filemtimes.keys() )
         {
-            if ( !m_filemtimes[ key ].keys().isEmpty() )
+            if ( !m_filemtimes[ key ].keys().isEmpty() && !QFileInfo( key.mid( 7 ) ).exists() )
                 m_filesToDelete << m_filemtimes[ key ].keys().first();
         }
     }
@@ -285,6 +566,9 @@ MusicScanner::postOps()
         m_filesToDelete.clear();
     }
 
+    if ( !m_dirmtimes.isEmpty() && !m_dryRun )
+        executeCommand( dbcmd_ptr( new DatabaseCommand_DirMtimes( m_dirmtimes ) ) );
+
     m_processedFiles.clear();
 
     if ( !m_cmdQueue )
@@ -349,9 +633,16 @@ MusicScanner::commandFinished()
 void
 MusicScanner::scanFile( const QFileInfo& fi )
 {
+    // files from DirLister each took a slot we need to give back once we're done with them
+    const bool listed = ( m_scanMode == MusicScanner::DirScan );
+
     // Don't process a single file twice, this might happen if you add a subfolder of another collection folder to your collection
     if ( m_processedFiles.contains( fi.canonicalFilePath() ) )
+    {
+        if ( listed )
+            m_fileSlots.release();
         return;
+    }
     else
         m_processedFiles << fi.canonicalFilePath();
 
@@ -362,6 +653,8 @@ MusicScanner::scanFile( const QFileInfo& fi )
                 fi.lastModified().toUTC().toTime_t() == m_filemtimes.value( "file://" + fi.canonicalFilePath() ).values().first() )
         {
             m_filemtimes.remove( "file://" + fi.canonicalFilePath() );
+            if ( listed )
+                m_fileSlots.release();
             return;
         }
 
@@ -371,9 +664,64 @@ MusicScanner::scanFile( const QFileInfo& fi )
     }
 
     //tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Scanning file:" << fi.canonicalFilePath();
-    QVariant m = readFile( fi );
+    const uint job = m_nextJob++;
+    m_pendingFiles.insert( job, fi );
+    m_tagPool.start( new TagReader( this, job, fi ) );
+}
+
+
+void
+MusicScanner::tagsRead( uint job, const QVariant& m )
+{
+    m_results.insert( job, m );
+
+    // hand results on in the order the files were listed in
+    while ( m_results.contains( m_nextResult ) )
+    {
+        handleTags( m_pendingFiles.take( m_nextResult ), m_results.take( m_nextResult ) );
+        m_nextResult++;
+
+        if ( m_scanMode == MusicScanner::DirScan )
+            m_fileSlots.release();
+    }
+
+    if ( m_listingFinished && m_pendingFiles.isEmpty() )
+        postOps();
+}
+
+
+void
+MusicScanner::deleteFiles( const QVariantList& ids )
+{
+    m_filesToDelete << ids;
+}
+
+
+void
+MusicScanner::setDirMtimes( const QMap< QString, unsigned int >& m )
+{
+    m_dirmtimes = m;
+}
+
+
+void
+MusicScanner::handleTags( const QFileInfo& fi, const QVariant& m )
+{
+    if ( m_scanned )
+        if ( m_scanned % 3 == 0 )
+            emit progress( m_scanned );
+
+    if ( m_scanned % 100 == 0 || m_verbose )
+      tDebug( LOGINFO ) << "Scanning file:" << m_scanned << fi.canonicalFilePath();
+
     if ( m.toMap().isEmpty() )
+    {
+        m_skippedFiles << fi.canonicalFilePath();
+        m_skipped++;
         return;
+    }
+
+    m_scanned++;
 
     m_scannedfiles << m;
     if ( m_batchsize != 0 && (quint32)m_scannedfiles.length() >= m_batchsize )
@@ -446,30 +794,3 @@ MusicScanner::readTags( const QFileInfo& fi )
 
     return m;
 }
-
-
-QVariant
-MusicScanner::readFile( const QFileInfo& fi )
-{
-    const QVariant m = readTags( fi );
-
-    if ( m_scanned )
-        if ( m_scanned % 3 == 0 )
-            emit progress( m_scanned );
-
-    if ( m_scanned % 100 == 0 || m_verbose )
-      tDebug( LOGINFO ) << "Scanning file:" << m_scanned << fi.canonicalFilePath();
-
-    if ( m.toMap().isEmpty() )
-    {
-        m_skippedFiles << fi.canonicalFilePath();
-        m_skipped++;
-    }
-    else
-    {
-        m_scanned++;
-    }
-
-    return m;
-}
-
@@ -34,22 +34,29 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QPointer>
+#include <QSemaphore>
 #include <QString>
 #include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVariantMap>
 
-// descend dir tree comparing dir mtimes to last known mtime
-// emit signal for any dir with new content, so we can scan it.
-// finally, emit the list of new mtimes we observed.
+namespace Tomahawk
+{
+    class DatabaseCommand_FileMtimes;
+}
+
+// descend dir tree comparing file mtimes to the ones in the database, one dir at a time
+// emit signal for any file that is new or changed, so we can scan it.
+// finally, emit the list of dir mtimes we observed.
 class DirLister : public QObject
 {
 Q_OBJECT
 
 public:
 
-    DirLister( const QStringList& dirs )
-        : QObject(), m_dirs( dirs ), m_opcount( 0 ), m_deleting( false )
+    DirLister( const QStringList& dirs, QSemaphore* fileSlots = 0 )
+        : QObject(), m_dirs( dirs ), m_fileSlots( fileSlots ), m_compare( false ), m_aborted( false ), m_mtimesRequest( 0 ), m_opcount( 0 ), m_deleting( false )
     {
         qDebug() << Q_FUNC_INFO;
     }
@@ -62,17 +69,42 @@ public:
     bool isDeleting() { QMutexLocker locker( &m_deletingMutex ); return m_deleting; };
     void setIsDeleting() { QMutexLocker locker( &m_deletingMutex ); m_deleting = true; };
 
+    /// Only hand out files that are new or changed compared to the database
+    void setCompareWithDatabase( bool compare ) { m_compare = compare; }
+
 signals:
     void fileToScan( QFileInfo );
+    /// Files in the database that are gone or changed on disk
+    void filesDeleted( const QVariantList& ids );
+    /// Mtimes of all dirs we listed, emitted right before finished()
+    void dirsScanned( const QMap< QString, unsigned int >& mtimes );
     void finished();
 
 private slots:
     void go();
     void scanDir( QDir dir, int depth );
+    void onMtimes( uint requestId, const QMap< QString, QMap< unsigned int, unsigned int > >& mtimes );
 
 private:
+    bool acquireFileSlot();
+    void opFinished();
+    /// Runs @p cmd and waits for its result, false if the database didn't answer in time
+    bool loadMtimes( Tomahawk::DatabaseCommand_FileMtimes* cmd, QMap< QString, QMap< unsigned int, unsigned int > >& mtimes );
+
     QStringList m_dirs;
     QSet< QString > m_processedDirs;
+    QSemaphore* m_fileSlots;
+
+    bool m_compare;
+    // Gave up on the database, the rest of the scan is skipped
+    bool m_aborted;
+    QSet< QString > m_comparedDirs;
+    QMap< QString, unsigned int > m_dirMtimes;
+    QMutex m_mtimesMutex;
+    QSemaphore m_mtimesReady;
+    // Number of the request loadMtimes() waits for, answers to earlier ones are dropped
+    uint m_mtimesRequest;
+    QMap< QString, QMap< unsigned int, unsigned int > > m_mtimes;
 
     uint m_opcount;
     QMutex m_deletingMutex;
@@ -88,11 +120,17 @@ public:
     virtual ~DirListerThreadController();
 
     void setPaths( const QStringList& paths ) { m_paths = paths; }
+    /// DirLister takes one of these per file it hands over to the scanner
+    void setFileSlots( QSemaphore* fileSlots ) { m_fileSlots = fileSlots; }
+    void setCompareWithDatabase( bool compare ) { m_compare = compare; }
+    void stop();
     void run();
 
 private:
     QPointer< DirLister > m_dirLister;
     QStringList m_paths;
+    QSemaphore* m_fileSlots;
+    bool m_compare;
 };
 
 class DLLEXPORT MusicScanner : public QObject
@@ -124,6 +162,17 @@ public:
     void setVerbose( bool _verbose );
     bool verbose();
 
+    /**
+     * Number of threads reading tags in parallel, QThread::idealThreadCount() by default.
+     */
+    void setThreads( int threads );
+    int threads() const;
+
+    /**
+     * Number of files that were scanned (successfully or not) so far.
+     */
+    unsigned int filesScanned() const { return m_scanned + m_skipped; }
+
 signals:
     //void fileScanned( QVariantMap );
     void finished();
@@ -131,12 +180,15 @@ signals:
     void progress( unsigned int files );
 
 private:
-    QVariant readFile( const QFileInfo& fi );
+    void handleTags( const QFileInfo& fi, const QVariant& m );
     void executeCommand( Tomahawk::dbcmd_ptr cmd );
 
 private slots:
     void postOps();
     void scanFile( const QFileInfo& fi );
+    void tagsRead( uint job, const QVariant& m );
+    void deleteFiles( const QVariantList& ids );
+    void setDirMtimes( const QMap< QString, unsigned int >& m );
     void setFileMtimes( const QMap< QString, QMap< unsigned int, unsigned int > >& m );
     void startScan();
     void scan();
@@ -165,6 +217,17 @@ private:
     quint32 m_batchsize;
 
     DirListerThreadController* m_dirListerThreadController;
+    bool m_compareMtimes;
+    QMap< QString, unsigned int > m_dirmtimes;
+
+    // tags are read by a pool of workers, results are handled in the order files were listed
+    QThreadPool m_tagPool;
+    QSemaphore m_fileSlots;
+    uint m_nextJob;
+    uint m_nextResult;
+    QMap< uint, QFileInfo > m_pendingFiles;
+    QMap< uint, QVariant > m_results;
+    bool m_listingFinished;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "database/Database.h"
 #include "database/DatabaseCommand_FileMTimes.h"
 #include "database/DatabaseCommand_DeleteFiles.h"
+#include "database/DatabaseCommand_DirMtimes.h"
 #include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
 
@@ -32,9 +33,14 @@
 
 #include <QThread>
 #include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileSystemWatcher>
 #include <QTimer>
 #include <QSet>
 
+// Copying an album causes a burst of changes, wait for them to settle before scanning
+#define CHANGE_SCAN_DELAY 3000
+
 using namespace Tomahawk;
 
 MusicScannerThreadController::MusicScannerThreadController( QObject* parent )
@@ -82,6 +88,7 @@ ScanManager::ScanManager( QObject* parent )
     , m_currScannerPaths()
     , m_cachedScannerDirs()
     , m_queuedScanType( MusicScanner::None )
+    , m_fsWatcher( 0 )
     , m_updateGUI( true )
 {
     s_instance = this;
@@ -89,6 +96,10 @@ ScanManager::ScanManager( QObject* parent )
     m_scanTimer = new QTimer( this );
     m_scanTimer->setSingleShot( false );
     m_scanTimer->setInterval( TomahawkSettings::instance()->scannerTime() * 1000 );
+
+    m_changeTimer = new QTimer( this );
+    m_changeTimer->setSingleShot( true );
+    m_changeTimer->setInterval( CHANGE_SCAN_DELAY );
 }
 
 
@@ -113,6 +124,13 @@ ScanManager::init()
 {
     connect( TomahawkSettings::instance(), SIGNAL( changed() ), SLOT( onSettingsChanged() ) );
     connect( m_scanTimer, SIGNAL( timeout() ), SLOT( scanTimerTimeout() ) );
+    connect( m_changeTimer, SIGNAL( timeout() ), SLOT( scanChangedDirs() ) );
+
+#ifdef Q_OS_LINUX
+    // inotify makes watching a whole collection cheap, elsewhere we stick to periodic scans
+    m_fsWatcher = new QFileSystemWatcher( this );
+    connect( m_fsWatcher, SIGNAL( directoryChanged( QString ) ), SLOT( onDirectoryChanged( QString ) ) );
+#endif
 
     if ( TomahawkSettings::instance()->hasScannerPaths() )
     {
@@ -127,8 +145,13 @@ ScanManager::init()
 void
 ScanManager::onSettingsChanged()
 {
-    if ( !TomahawkSettings::instance()->watchForChanges() && m_scanTimer->isActive() )
-        m_scanTimer->stop();
+    if ( !TomahawkSettings::instance()->watchForChanges() )
+    {
+        if ( m_scanTimer->isActive() )
+            m_scanTimer->stop();
+
+        stopWatching();
+    }
 
     m_scanTimer->setInterval( TomahawkSettings::instance()->scannerTime() * 1000 );
 
@@ -139,7 +162,7 @@ ScanManager::onSettingsChanged()
         runNormalScan();
     }
 
-    if ( TomahawkSettings::instance()->watchForChanges() && !m_scanTimer->isActive() )
+    if ( TomahawkSettings::instance()->watchForChanges() && !m_scanTimer->isActive() && m_watchedDirs.isEmpty() )
         m_scanTimer->start();
 }
 
@@ -311,6 +334,20 @@ ScanManager::scannerFinished()
     m_updateGUI = true;
     emit finished();
 
+    if ( m_currScanMode == MusicScanner::DirScan && m_fsWatcher && TomahawkSettings::instance()->watchForChanges() )
+    {
+        if ( TomahawkSettings::instance()->scannerPaths().isEmpty() )
+            stopWatching();
+        else
+        {
+            // the scan stored all the dirs it came across, watch those
+            DatabaseCommand_DirMtimes* cmd = new DatabaseCommand_DirMtimes();
+            connect( cmd, SIGNAL( done( QMap< QString, unsigned int > ) ),
+                          SLOT( watchDirs( QMap< QString, unsigned int > ) ) );
+            Database::instance()->enqueue( dbcmd_ptr( cmd ) );
+        }
+    }
+
     if ( m_queuedScanType != MusicScanner::File )
         m_currScannerPaths.clear();
     switch ( m_queuedScanType )
@@ -320,12 +357,144 @@ ScanManager::scannerFinished()
             QMetaObject::invokeMethod( this, "runNormalScan", Qt::QueuedConnection, Q_ARG( bool, m_queuedScanType == MusicScanner::Full ) );
             break;
         case MusicScanner::File:
-            QMetaObject::invokeMethod( this, "", Qt::QueuedConnection, Q_ARG( QStringList, QStringList() ) );
+            QMetaObject::invokeMethod( this, "runFileScan", Qt::QueuedConnection, Q_ARG( QStringList, QStringList() ) );
             break;
         default:
             break;
     }
     m_queuedScanType = MusicScanner::None;
 
-    m_scanTimer->start();
+    if ( m_watchedDirs.isEmpty() )
+        m_scanTimer->start();
+
+    // changes that came in while we were busy
+    if ( !m_changedDirs.isEmpty() )
+        m_changeTimer->start();
+}
+
+
+void
+ScanManager::watchDirs( const QMap< QString, unsigned int >& mtimes )
+{
+    if ( !m_fsWatcher || !TomahawkSettings::instance()->watchForChanges() )
+        return;
+
+    const QSet< QString > dirs = mtimes.keys().toSet();
+    const QStringList removed = ( m_watchedDirs - dirs ).toList();
+    const QStringList added = ( dirs - m_watchedDirs ).toList();
+    if ( !removed.isEmpty() )
+        m_fsWatcher->removePaths( removed );
+    if ( !added.isEmpty() )
+        m_fsWatcher->addPaths( added );
+    m_watchedDirs = dirs;
+
+    // there's only so many inotify watches (fs.inotify.max_user_watches), without all of them we'd miss changes
+    const int watched = m_fsWatcher->directories().count();
+    if ( watched < dirs.count() )
+    {
+        tLog() << "Could only watch" << watched << "of" << dirs.count() << "dirs for changes, falling back to periodic scans";
+        stopWatching();
+
+        if ( !m_scanTimer->isActive() )
+            m_scanTimer->start();
+        return;
+    }
+
+    tLog() << "Watching" << watched << "dirs for changes";
+    m_scanTimer->stop();
+}
+
+
+void
+ScanManager::stopWatching()
+{
+    if ( m_fsWatcher && !m_fsWatcher->directories().isEmpty() )
+        m_fsWatcher->removePaths( m_fsWatcher->directories() );
+
+    m_watchedDirs.clear();
+    m_changedDirs.clear();
+    m_changeTimer->stop();
+}
+
+
+void
+ScanManager::onDirectoryChanged( const QString& path )
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << path;
+
+    m_changedDirs << path;
+    m_changeTimer->start();
+}
+
+
+void
+ScanManager::scanChangedDirs()
+{
+    if ( m_changedDirs.isEmpty() )
+        return;
+
+    // scannerFinished() brings us back here
+    if ( m_musicScannerThreadController )
+        return;
+
+    if ( !Database::instance() || !Database::instance()->isReady() )
+    {
+        m_changeTimer->start();
+        return;
+    }
+
+    QStringList paths;
+    QStringList newDirs;
+    QStringList goneDirs;
+    foreach ( const QString& dir, m_changedDirs )
+    {
+        paths << dir;
+        if ( !QFileInfo( dir ).isDir() )
+        {
+            goneDirs << dir;
+            continue;
+        }
+
+        // dirs that were moved away only show up as a change of their parent
+        foreach ( const QString& watched, m_watchedDirs )
+        {
+            if ( watched.startsWith( dir + '/' ) && !QFileInfo( watched ).isDir() )
+                goneDirs << watched;
+        }
+
+        // dirs that were created or moved here, with everything beneath them
+        QDirIterator it( dir, QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
+        while ( it.hasNext() )
+        {
+            const QString sub = QFileInfo( it.next() ).canonicalFilePath();
+            if ( sub.isEmpty() || m_watchedDirs.contains( sub ) )
+                continue;
+
+            newDirs << sub;
+            QDirIterator subIt( sub, QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot, QDirIterator::Subdirectories );
+            while ( subIt.hasNext() )
+                newDirs << QFileInfo( subIt.next() ).canonicalFilePath();
+        }
+    }
+    m_changedDirs.clear();
+
+    goneDirs.removeDuplicates();
+    foreach ( const QString& dir, goneDirs )
+        m_watchedDirs.remove( dir );
+    if ( !goneDirs.isEmpty() )
+        m_fsWatcher->removePaths( goneDirs );
+
+    newDirs.removeDuplicates();
+    newDirs.removeAll( QString() );
+    foreach ( const QString& dir, newDirs )
+        m_watchedDirs << dir;
+    if ( !newDirs.isEmpty() )
+        m_fsWatcher->addPaths( newDirs );
+
+    // MusicScanner treats each dir as the files directly inside of it
+    paths << goneDirs << newDirs;
+    paths.removeDuplicates();
+
+    tDebug( LOGVERBOSE ) << "Rescanning" << paths.count() << "changed dirs";
+    runFileScan( paths );
 }
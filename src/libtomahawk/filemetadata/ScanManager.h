@@ -90,7 +90,13 @@ private slots:
     void fileMtimesCheck( const QMap< QString, QMap< unsigned int, unsigned int > >& mtimes );
     void filesDeleted();
 
+    void watchDirs( const QMap< QString, unsigned int >& mtimes );
+    void onDirectoryChanged( const QString& path );
+    void scanChangedDirs();
+
 private:
+    void stopWatching();
+
     static ScanManager* s_instance;
 
     MusicScanner::ScanMode m_currScanMode;
@@ -101,6 +107,12 @@ private:
     QTimer* m_scanTimer;
     MusicScanner::ScanType m_queuedScanType;
 
+    // with inotify we only rescan dirs that changed instead of walking everything periodically
+    QFileSystemWatcher* m_fsWatcher;
+    QSet< QString > m_watchedDirs;
+    QSet< QString > m_changedDirs;
+    QTimer* m_changeTimer;
+
     bool m_updateGUI;
 };
 
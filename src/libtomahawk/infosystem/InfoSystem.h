@@ -49,6 +49,13 @@ enum PushInfoFlags { // must be powers of 2
     PushShortUrlFlag = 2
 };
 
+// Order in which requests waiting for a busy plugin get handed to it
+enum InfoRequestPriority {
+    InfoPriorityHigh = 0,   // something on screen is waiting for it
+    InfoPriorityNormal = 1,
+    InfoPriorityLow = 2     // background prefetching
+};
+
 
 struct DLLEXPORT InfoRequestData {
     quint64 requestId;
@@ -59,6 +66,7 @@ struct DLLEXPORT InfoRequestData {
     QVariantMap customData;
     uint timeoutMillis;
     bool allSources;
+    InfoRequestPriority priority;
 
     InfoRequestData();
 
@@ -21,14 +21,21 @@
 #include <QDesktopServices>
 
 #include "InfoSystemCache.h"
+#include "InfoSystemCacheBackend.h"
 #include "TomahawkSettings.h"
 #include "utils/Logger.h"
 #include "Source.h"
 
 #include <QDir>
 #include <QSettings>
+#include <QTime>
 #include <QCryptographicHash>
 
+// Upper bound for the stored size of all cached values
+#define MAX_CACHE_SIZE ( 256 * 1024 * 1024 )
+// Eviction frees space down to this, so it doesn't run again on the next insert
+#define EVICT_TARGET_SIZE ( MAX_CACHE_SIZE / 10 * 9 )
+
 namespace Tomahawk
 {
 
@@ -37,9 +44,11 @@ namespace InfoSystem
 
 const int InfoSystemCache::s_infosystemCacheVersion = 4;
 
-InfoSystemCache::InfoSystemCache( QObject* parent )
+InfoSystemCache::InfoSystemCache( QObject* parent, InfoSystemCacheBackend* backend )
     : QObject( parent )
     , m_cacheBaseDir( TomahawkSettings::instance()->storageCacheLocation() + "/InfoSystemCache/" )
+    , m_backend( backend )
+    , m_totalSize( 0 )
 {
     tDebug() << Q_FUNC_INFO;
 
@@ -49,6 +58,30 @@ InfoSystemCache::InfoSystemCache( QObject* parent )
         TomahawkSettings::instance()->setInfoSystemCacheVersion( s_infosystemCacheVersion );
     }
 
+    QDir().mkpath( m_cacheBaseDir );
+    if ( !m_backend )
+        m_backend = new SqliteCacheBackend( m_cacheBaseDir + "cache.db" );
+
+    if ( m_backend->open() )
+    {
+        QTime t;
+        t.start();
+
+        foreach ( const InfoSystemCacheBackend::Entry& e, m_backend->entries() )
+            insertEntry( e.key, e.expires, e.size );
+
+        migrateFileCache();
+        tDebug() << "Loaded" << m_index.count() << "infosystem cache entries," << m_totalSize / 1024 << "KB in" << t.elapsed() << "ms";
+
+        pruneTimerFired();
+        evict();
+    }
+    else
+    {
+        delete m_backend;
+        m_backend = 0;
+    }
+
     m_pruneTimer.setInterval( 300000 );
     m_pruneTimer.setSingleShot( false );
     connect( &m_pruneTimer, SIGNAL( timeout() ), SLOT( pruneTimerFired() ) );
@@ -59,128 +92,185 @@ InfoSystemCache::InfoSystemCache( QObject* parent )
 InfoSystemCache::~InfoSystemCache()
 {
     tDebug() << Q_FUNC_INFO;
+
+    delete m_backend;
 }
 
 
 void
-InfoSystemCache::pruneTimerFired()
+InfoSystemCache::migrateFileCache()
 {
-    qDebug() << Q_FUNC_INFO << "Pruning infosystemcache";
-    qlonglong currentMSecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+    // Older versions kept one INI file per entry in <type>/<criteria md5>.<expiry>
+    const QDir baseDir( m_cacheBaseDir );
+    const QStringList typeDirs = baseDir.entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+    if ( typeDirs.isEmpty() )
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int migrated = 0;
 
-    for ( int i = InfoNoInfo; i <= InfoLastInfo; i++ )
+    m_backend->beginBatch();
+    foreach ( const QString& typeDir, typeDirs )
     {
-        InfoType type = (InfoType)(i);
-        QHash< QString, QString > fileLocationHash = m_fileLocationCache[type];
-        const QString cacheDirName = m_cacheBaseDir + QString::number( (int)type );
-        QFileInfoList fileList = QDir( cacheDirName ).entryInfoList( QDir::Files | QDir::NoDotAndDotDot );
-        foreach ( QFileInfo file, fileList )
+        bool ok;
+        typeDir.toInt( &ok );
+        if ( !ok )
+            continue;
+
+        const QDir dir( baseDir.filePath( typeDir ) );
+        foreach ( const QFileInfo& file, dir.entryInfoList( QDir::Files | QDir::NoDotAndDotDot ) )
         {
-            QString baseName = file.baseName();
-            if ( file.suffix().toLongLong() < currentMSecsSinceEpoch )
+            const qint64 expires = file.suffix().toLongLong();
+            if ( expires < now )
+                continue;
+
+            const QString key = typeDir + '/' + file.baseName();
+            QSettings cachedSettings( file.filePath(), QSettings::IniFormat );
+            const qint64 size = m_backend->setValue( key, expires, cachedSettings.value( "data" ) );
+            if ( size >= 0 )
             {
-                if ( !QFile::remove( file.canonicalFilePath() ) )
-                    tLog() << "Failed to remove stale cache file" << file.canonicalFilePath();
-                else
-                    qDebug() << "Removed stale cache file" << file.canonicalFilePath();
+                insertEntry( key, expires, size );
+                migrated++;
             }
-            if ( fileLocationHash.contains( baseName ) )
-                fileLocationHash.remove( baseName );
         }
-        m_fileLocationCache[type] = fileLocationHash;
+
+        TomahawkUtils::removeDirectory( dir.absolutePath() );
     }
+    m_backend->endBatch();
+
+    tLog() << "Migrated" << migrated << "infosystem cache entries from the old file cache";
 }
 
 
 void
-InfoSystemCache::getCachedInfoSlot( Tomahawk::InfoSystem::InfoStringHash criteria, qint64 newMaxAge, Tomahawk::InfoSystem::InfoRequestData requestData )
+InfoSystemCache::insertEntry( const QString& key, qint64 expires, qint64 size )
 {
-    QObject* sendingObj = sender();
-    const QString criteriaHashVal = criteriaMd5( criteria );
-    const QString criteriaHashValWithType = criteriaMd5( criteria, requestData.type );
-    QHash< QString, QString > fileLocationHash = m_fileLocationCache[ requestData.type ];
-    if ( !fileLocationHash.contains( criteriaHashVal ) )
+    QHash< QString, CacheEntry >::iterator it = m_index.find( key );
+    if ( it != m_index.end() )
     {
-        if ( !fileLocationHash.isEmpty() )
-        {
-            //We already know of some values, so no need to re-read the directory again as it's already happened
-            //qDebug() << Q_FUNC_INFO << "notInCache -- filelocationhash empty";
-            notInCache( sendingObj, criteria, requestData );
-            return;
-        }
+        m_expiryQueue.remove( it->expires, key );
+        m_totalSize -= it->size;
+    }
 
-        const QString cacheDir = m_cacheBaseDir + QString::number( (int)requestData.type );
-        QDir dir( cacheDir );
-        if ( !dir.exists() )
-        {
-            //Dir doesn't exist so clearly not in cache
-            //qDebug() << Q_FUNC_INFO << "notInCache -- dir doesn't exist";
-            notInCache( sendingObj, criteria, requestData );
-            return;
-        }
+    CacheEntry entry;
+    entry.expires = expires;
+    entry.size = size;
+    m_index.insert( key, entry );
+    m_expiryQueue.insert( expires, key );
+    m_totalSize += size;
+}
 
-        QFileInfoList fileList = dir.entryInfoList( QDir::Files | QDir::NoDotAndDotDot );
-        foreach ( QFileInfo file, fileList )
-        {
-            QString baseName = file.baseName();
-            fileLocationHash[ baseName ] = file.canonicalFilePath();
-        }
 
-        //Store what we've loaded up
-        m_fileLocationCache[ requestData.type ] = fileLocationHash;
-        if ( !fileLocationHash.contains( criteriaHashVal ) )
-        {
-            //Still didn't find it? It's really not in the cache then
-            //qDebug() << Q_FUNC_INFO << "notInCache -- filelocationhash doesn't contain criteria val";
-            notInCache( sendingObj, criteria, requestData );
-            return;
-        }
+void
+InfoSystemCache::removeEntries( const QStringList& keys )
+{
+    foreach ( const QString& key, keys )
+    {
+        QHash< QString, CacheEntry >::iterator it = m_index.find( key );
+        if ( it == m_index.end() )
+            continue;
+
+        m_expiryQueue.remove( it->expires, key );
+        m_totalSize -= it->size;
+        m_index.erase( it );
+        m_dataCache.remove( key );
     }
 
-    QFileInfo file( fileLocationHash[ criteriaHashVal ] );
-    qlonglong currMaxAge = file.suffix().toLongLong();
+    m_backend->remove( keys );
+}
+
 
-    if ( currMaxAge < QDateTime::currentMSecsSinceEpoch() )
+void
+InfoSystemCache::evict()
+{
+    if ( m_totalSize <= MAX_CACHE_SIZE )
+        return;
+
+    // Whatever would expire first is the least valuable to keep
+    QStringList keys;
+    qint64 size = m_totalSize;
+    for ( QMultiMap< qint64, QString >::const_iterator it = m_expiryQueue.constBegin();
+          it != m_expiryQueue.constEnd() && size > EVICT_TARGET_SIZE; ++it )
     {
-        if ( !QFile::remove( file.canonicalFilePath() ) )
-            tLog() << "Failed to remove stale cache file" << file.canonicalFilePath();
-        else
-            qDebug() << "Removed stale cache file" << file.canonicalFilePath();
+        keys << it.value();
+        size -= m_index.value( it.value() ).size;
+    }
 
-        fileLocationHash.remove( criteriaHashVal );
-        m_fileLocationCache[ requestData.type ] = fileLocationHash;
-        m_dataCache.remove( criteriaHashValWithType );
+    tDebug() << "Evicting" << keys.count() << "infosystem cache entries to stay below" << MAX_CACHE_SIZE / 1024 / 1024 << "MB";
+    removeEntries( keys );
+}
+
+
+void
+InfoSystemCache::pruneTimerFired()
+{
+    if ( !m_backend )
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QStringList stale;
+    for ( QMultiMap< qint64, QString >::const_iterator it = m_expiryQueue.constBegin();
+          it != m_expiryQueue.constEnd() && it.key() < now; ++it )
+    {
+        stale << it.value();
+    }
 
-        qDebug() << Q_FUNC_INFO << "notInCache -- file was stale";
+    if ( stale.isEmpty() )
+        return;
+
+    qDebug() << Q_FUNC_INFO << "Pruning" << stale.count() << "stale infosystemcache entries";
+    removeEntries( stale );
+}
+
+
+void
+InfoSystemCache::getCachedInfoSlot( Tomahawk::InfoSystem::InfoStringHash criteria, qint64 newMaxAge, Tomahawk::InfoSystem::InfoRequestData requestData )
+{
+    QObject* sendingObj = sender();
+    const QString key = cacheKey( criteria, requestData.type );
+
+    QHash< QString, CacheEntry >::iterator it = m_index.find( key );
+    if ( !m_backend || it == m_index.end() )
+    {
         notInCache( sendingObj, criteria, requestData );
         return;
     }
-    else if ( newMaxAge > 0 )
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if ( it->expires < now )
     {
-        const QString newFilePath = QString( file.dir().canonicalPath() + '/' + criteriaHashVal + '.' + QString::number( QDateTime::currentMSecsSinceEpoch() + newMaxAge ) );
+        removeEntries( QStringList() << key );
 
-        if ( !QFile::rename( file.canonicalFilePath(), newFilePath ) )
+        qDebug() << Q_FUNC_INFO << "notInCache -- entry was stale";
+        notInCache( sendingObj, criteria, requestData );
+        return;
+    }
+    else if ( newMaxAge > 0 )
+    {
+        const qint64 expires = now + newMaxAge;
+        if ( !m_backend->setExpiry( key, expires ) )
         {
-            qDebug() << Q_FUNC_INFO << "notInCache -- failed to move old cache file to new location";
+            qDebug() << Q_FUNC_INFO << "notInCache -- failed to update the entry's expiry";
             notInCache( sendingObj, criteria, requestData );
             return;
         }
 
-        fileLocationHash[ criteriaHashVal ] = newFilePath;
-        m_fileLocationCache[ requestData.type ] = fileLocationHash;
+        m_expiryQueue.remove( it->expires, key );
+        it->expires = expires;
+        m_expiryQueue.insert( expires, key );
     }
 
-    if ( !m_dataCache.contains( criteriaHashValWithType ) )
+    if ( !m_dataCache.contains( key ) )
     {
-        QSettings cachedSettings( fileLocationHash[ criteriaHashVal ], QSettings::IniFormat );
-        QVariant output = cachedSettings.value( "data" );
-        m_dataCache.insert( criteriaHashValWithType, new QVariant( output ) );
+        QVariant output = m_backend->value( key );
+        m_dataCache.insert( key, new QVariant( output ) );
 
         emit info( requestData, output );
     }
     else
     {
-        emit info( requestData, QVariant( *( m_dataCache[ criteriaHashValWithType ] ) ) );
+        emit info( requestData, QVariant( *( m_dataCache[ key ] ) ) );
     }
 }
 
@@ -195,52 +285,28 @@ InfoSystemCache::notInCache( QObject *receiver, Tomahawk::InfoSystem::InfoString
 void
 InfoSystemCache::updateCacheSlot( Tomahawk::InfoSystem::InfoStringHash criteria, qint64 maxAge, Tomahawk::InfoSystem::InfoType type, QVariant output )
 {
-    const QString criteriaHashVal = criteriaMd5( criteria );
-    const QString criteriaHashValWithType = criteriaMd5( criteria, type );
-    const QString cacheDir = m_cacheBaseDir + QString::number( (int)type );
-    const QString settingsFilePath( cacheDir + '/' + criteriaHashVal + '.' + QString::number( QDateTime::currentMSecsSinceEpoch() + maxAge ) );
+    if ( !m_backend )
+        return;
 
-    QHash< QString, QString > fileLocationHash = m_fileLocationCache[ type ];
-    if ( fileLocationHash.contains( criteriaHashVal ) )
-    {
-        if ( !QFile::rename( fileLocationHash[ criteriaHashVal ], settingsFilePath ) )
-        {
-            tLog() << "Failed to move old cache file to new location!";
-            return;
-        }
-        fileLocationHash[ criteriaHashVal ] = settingsFilePath;
-        m_fileLocationCache[ type ] = fileLocationHash;
+    const QString key = cacheKey( criteria, type );
+    const qint64 expires = QDateTime::currentMSecsSinceEpoch() + maxAge;
 
-        QSettings cachedSettings( fileLocationHash[ criteriaHashVal ], QSettings::IniFormat );
-        cachedSettings.setValue( "data", output );
+    const qint64 size = m_backend->setValue( key, expires, output );
+    if ( size < 0 )
+        return;
 
-        m_dataCache.insert( criteriaHashValWithType, new QVariant( output ) );
+    insertEntry( key, expires, size );
+    m_dataCache.insert( key, new QVariant( output ) );
 
-        return;
-    }
+    evict();
+}
 
-    QDir dir( cacheDir );
-    if( !dir.exists( cacheDir ) )
-    {
-        qDebug() << "Creating cache directory" << cacheDir;
-        if( !dir.mkpath( cacheDir ) )
-        {
-            tLog() << "Failed to create cache dir! Bailing...";
-            return;
-        }
-    }
 
-    QSettings cachedSettings( settingsFilePath, QSettings::IniFormat );
-    QStringList keys = criteria.keys();
-    cachedSettings.beginGroup( "criteria" );
-    for( int i = 0; i < criteria.size(); i++ )
-        cachedSettings.setValue( keys.at( i ), criteria[keys.at( i )] );
-    cachedSettings.endGroup();
-    cachedSettings.setValue( "data", output );
-
-    fileLocationHash[criteriaHashVal] = settingsFilePath;
-    m_fileLocationCache[type] = fileLocationHash;
-    m_dataCache.insert( criteriaHashValWithType, new QVariant( output ) );
+QString
+InfoSystemCache::cacheKey( const Tomahawk::InfoSystem::InfoStringHash& criteria, Tomahawk::InfoSystem::InfoType type ) const
+{
+    // Same naming as the old <type>/<md5> file layout, see migrateFileCache()
+    return QString::number( (int)type ) + '/' + criteriaMd5( criteria );
 }
 
 
@@ -22,6 +22,8 @@
 
 #include <QCache>
 #include <QDateTime>
+#include <QHash>
+#include <QMultiMap>
 #include <QObject>
 #include <QtDebug>
 #include <QTimer>
@@ -34,12 +36,15 @@ namespace Tomahawk
 namespace InfoSystem
 {
 
+class InfoSystemCacheBackend;
+
 class DLLEXPORT InfoSystemCache : public QObject
 {
 Q_OBJECT
 
 public:
-    InfoSystemCache( QObject *parent = 0 );
+    /// Takes ownership of backend, defaults to a SqliteCacheBackend
+    InfoSystemCache( QObject *parent = 0, InfoSystemCacheBackend* backend = 0 );
 
     virtual ~InfoSystemCache();
 
@@ -61,11 +66,29 @@ private:
      */
     static const int s_infosystemCacheVersion;
 
+    struct CacheEntry
+    {
+        qint64 expires;
+        qint64 size;
+    };
+
     void notInCache( QObject *receiver, Tomahawk::InfoSystem::InfoStringHash criteria, Tomahawk::InfoSystem::InfoRequestData requestData );
     const QString criteriaMd5( const Tomahawk::InfoSystem::InfoStringHash &criteria, Tomahawk::InfoSystem::InfoType type = Tomahawk::InfoSystem::InfoNoInfo ) const;
+    QString cacheKey( const Tomahawk::InfoSystem::InfoStringHash& criteria, Tomahawk::InfoSystem::InfoType type ) const;
+
+    void migrateFileCache();
+    void insertEntry( const QString& key, qint64 expires, qint64 size );
+    void removeEntries( const QStringList& keys );
+    void evict();
 
     QString m_cacheBaseDir;
-    QHash< InfoType, QHash< QString, QString > > m_fileLocationCache;
+    InfoSystemCacheBackend* m_backend;
+
+    // Every stored key with its expiry and size, plus the keys ordered by expiry
+    QHash< QString, CacheEntry > m_index;
+    QMultiMap< qint64, QString > m_expiryQueue;
+    qint64 m_totalSize;
+
     QTimer m_pruneTimer;
     QCache< QString, QVariant > m_dataCache;
 };
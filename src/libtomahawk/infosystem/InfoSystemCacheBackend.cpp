@@ -0,0 +1,200 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InfoSystemCacheBackend.h"
+
+#include "utils/Logger.h"
+
+#include <QDataStream>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+// Keys removed per DELETE statement
+#define MAX_BOUND_KEYS 500
+
+namespace Tomahawk
+{
+
+namespace InfoSystem
+{
+
+SqliteCacheBackend::SqliteCacheBackend( const QString& fileName )
+    : m_fileName( fileName )
+    , m_connectionName( QString( "InfoSystemCache_%1" ).arg( (quintptr)this ) )
+    , m_batchDepth( 0 )
+{
+}
+
+
+SqliteCacheBackend::~SqliteCacheBackend()
+{
+    if ( m_db.isOpen() )
+        m_db.close();
+
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase( m_connectionName );
+}
+
+
+bool
+SqliteCacheBackend::open()
+{
+    m_db = QSqlDatabase::addDatabase( QSqlDatabase::drivers().contains( "QSQLITE3" ) ? "QSQLITE3" : "QSQLITE", m_connectionName );
+    m_db.setDatabaseName( m_fileName );
+    if ( !m_db.open() )
+    {
+        tLog() << "Failed to open infosystem cache" << m_fileName << m_db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery query( m_db );
+    query.exec( "PRAGMA journal_mode = WAL" );
+    query.exec( "PRAGMA synchronous = NORMAL" );
+    query.exec( "PRAGMA auto_vacuum = INCREMENTAL" );
+
+    if ( !query.exec( "CREATE TABLE IF NOT EXISTS cache ( key TEXT PRIMARY KEY, expires INTEGER NOT NULL, data BLOB NOT NULL )" ) )
+    {
+        tLog() << "Failed to create infosystem cache table" << query.lastError().text();
+        return false;
+    }
+
+    // Hand back the pages freed by the last session's pruning
+    query.exec( "PRAGMA incremental_vacuum" );
+    while ( query.next() );
+
+    return true;
+}
+
+
+QList< InfoSystemCacheBackend::Entry >
+SqliteCacheBackend::entries()
+{
+    QList< Entry > result;
+
+    QSqlQuery query( m_db );
+    query.setForwardOnly( true );
+    query.exec( "SELECT key, expires, length( data ) FROM cache" );
+    while ( query.next() )
+    {
+        Entry e;
+        e.key = query.value( 0 ).toString();
+        e.expires = query.value( 1 ).toLongLong();
+        e.size = query.value( 2 ).toLongLong();
+        result << e;
+    }
+
+    return result;
+}
+
+
+QVariant
+SqliteCacheBackend::value( const QString& key )
+{
+    QSqlQuery query( m_db );
+    query.prepare( "SELECT data FROM cache WHERE key = ?" );
+    query.addBindValue( key );
+    if ( !query.exec() || !query.next() )
+        return QVariant();
+
+    QVariant v;
+    QDataStream stream( query.value( 0 ).toByteArray() );
+    stream.setVersion( QDataStream::Qt_4_8 );
+    stream >> v;
+
+    return v;
+}
+
+
+qint64
+SqliteCacheBackend::setValue( const QString& key, qint64 expires, const QVariant& value )
+{
+    QByteArray data;
+    {
+        QDataStream stream( &data, QIODevice::WriteOnly );
+        stream.setVersion( QDataStream::Qt_4_8 );
+        stream << value;
+    }
+
+    QSqlQuery query( m_db );
+    query.prepare( "INSERT OR REPLACE INTO cache ( key, expires, data ) VALUES ( ?, ?, ? )" );
+    query.addBindValue( key );
+    query.addBindValue( expires );
+    query.addBindValue( data );
+    if ( !query.exec() )
+    {
+        tLog() << "Failed to store infosystem cache entry" << query.lastError().text();
+        return -1;
+    }
+
+    return data.size();
+}
+
+
+bool
+SqliteCacheBackend::setExpiry( const QString& key, qint64 expires )
+{
+    QSqlQuery query( m_db );
+    query.prepare( "UPDATE cache SET expires = ? WHERE key = ?" );
+    query.addBindValue( expires );
+    query.addBindValue( key );
+
+    return query.exec() && query.numRowsAffected() > 0;
+}
+
+
+void
+SqliteCacheBackend::remove( const QStringList& keys )
+{
+    beginBatch();
+
+    for ( int i = 0; i < keys.count(); i += MAX_BOUND_KEYS )
+    {
+        const QStringList chunk = keys.mid( i, MAX_BOUND_KEYS );
+
+        QStringList placeholders;
+        for ( int j = 0; j < chunk.count(); j++ )
+            placeholders << "?";
+
+        QSqlQuery query( m_db );
+        query.prepare( QString( "DELETE FROM cache WHERE key IN ( %1 )" ).arg( placeholders.join( "," ) ) );
+        foreach ( const QString& key, chunk )
+            query.addBindValue( key );
+        query.exec();
+    }
+
+    endBatch();
+}
+
+
+void
+SqliteCacheBackend::beginBatch()
+{
+    if ( m_batchDepth++ == 0 )
+        m_db.transaction();
+}
+
+
+void
+SqliteCacheBackend::endBatch()
+{
+    if ( --m_batchDepth == 0 )
+        m_db.commit();
+}
+
+} //namespace InfoSystem
+
+} //namespace Tomahawk
@@ -0,0 +1,98 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_INFOSYSTEMCACHEBACKEND_H
+#define TOMAHAWK_INFOSYSTEMCACHEBACKEND_H
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+namespace InfoSystem
+{
+
+/**
+ * Persistent storage behind InfoSystemCache.
+ *
+ * The cache keeps its own index of keys, expiry times and sizes in memory,
+ * so a backend only needs to store and hand back values by key.
+ */
+class DLLEXPORT InfoSystemCacheBackend
+{
+public:
+    struct Entry
+    {
+        QString key;
+        qint64 expires;
+        qint64 size;
+    };
+
+    virtual ~InfoSystemCacheBackend() {}
+
+    virtual bool open() = 0;
+    virtual QList< Entry > entries() = 0;
+
+    virtual QVariant value( const QString& key ) = 0;
+    /// Stores (or replaces) a value and returns its size on disk, or -1 on failure
+    virtual qint64 setValue( const QString& key, qint64 expires, const QVariant& value ) = 0;
+    virtual bool setExpiry( const QString& key, qint64 expires ) = 0;
+    virtual void remove( const QStringList& keys ) = 0;
+
+    /// Groups the following writes, e.g. into a single transaction
+    virtual void beginBatch() {}
+    virtual void endBatch() {}
+};
+
+
+/**
+ * Keeps all cached values in one SQLite file.
+ */
+class DLLEXPORT SqliteCacheBackend : public InfoSystemCacheBackend
+{
+public:
+    explicit SqliteCacheBackend( const QString& fileName );
+    virtual ~SqliteCacheBackend();
+
+    virtual bool open();
+    virtual QList< Entry > entries();
+
+    virtual QVariant value( const QString& key );
+    virtual qint64 setValue( const QString& key, qint64 expires, const QVariant& value );
+    virtual bool setExpiry( const QString& key, qint64 expires );
+    virtual void remove( const QStringList& keys );
+
+    virtual void beginBatch();
+    virtual void endBatch();
+
+private:
+    QString m_fileName;
+    QString m_connectionName;
+    QSqlDatabase m_db;
+    int m_batchDepth;
+};
+
+} //namespace InfoSystem
+
+} //namespace Tomahawk
+
+#endif //TOMAHAWK_INFOSYSTEMCACHEBACKEND_H
@@ -37,6 +37,9 @@
 #include <QNetworkConfiguration>
 #include <QNetworkProxy>
 
+// Requests a single plugin is given at once; the rest wait in its queue
+#define MAX_PLUGIN_REQUESTS 8
+
 namespace Tomahawk
 {
 
@@ -46,6 +49,7 @@ namespace InfoSystem
 InfoSystemWorker::InfoSystemWorker()
     : QObject()
     , m_cache( 0 )
+    , m_queueSequence( 0 )
 {
     tDebug() << Q_FUNC_INFO;
 
@@ -137,13 +141,25 @@ InfoSystemWorker::addInfoPlugin( Tomahawk::InfoSystem::InfoPluginPtr plugin )
     emit updatedSupportedGetTypes( QSet< InfoType >::fromList( m_infoGetMap.keys() ) );
     emit updatedSupportedPushTypes( QSet< InfoType >::fromList( m_infoPushMap.keys() ) );
 
-    connect( plugin.data(), SIGNAL( destroyed( QObject* ) ), SLOT( onInfoPluginDeleted() ) );
+    connect( plugin.data(), SIGNAL( destroyed( QObject* ) ), SLOT( onInfoPluginDeleted( QObject* ) ) );
 }
 
 
 void
-InfoSystemWorker::onInfoPluginDeleted()
+InfoSystemWorker::onInfoPluginDeleted( QObject* deleted )
 {
+    // Nobody is going to answer what the plugin had queued or was working on
+    const QMap< QPair< int, quint64 >, InfoRequestData > queued = m_pluginQueues.take( deleted );
+    m_pluginLoad.remove( deleted );
+    foreach ( quint64 requestId, m_dispatched.keys( deleted ) )
+    {
+        m_dispatched.remove( requestId );
+        if ( m_savedRequestMap.contains( requestId ) )
+            infoSlot( *m_savedRequestMap.value( requestId ), QVariant() );
+    }
+    foreach ( const InfoRequestData& requestData, queued )
+        infoSlot( requestData, QVariant() );
+
     foreach( const InfoPluginPtr& plugin, m_plugins )
     {
         if ( plugin.isNull() )
@@ -292,14 +308,9 @@ InfoSystemWorker::getInfo( Tomahawk::InfoSystem::InfoRequestData requestData )
         m_dataTracker[ requestData.caller ][ requestData.type ] = m_dataTracker[ requestData.caller ][ requestData.type ] + 1;
     //    qDebug() << "Current count in dataTracker for target" << requestData.caller << "and type" << requestData.type << "is" << m_dataTracker[ requestData.caller ][ requestData.type ];
 
-        InfoRequestData* data = new InfoRequestData;
-        data->caller = requestData.caller;
-        data->type = requestData.type;
-        data->input = requestData.input;
-        data->customData = requestData.customData;
-        m_savedRequestMap[ requestId ] = data;
+        m_savedRequestMap[ requestId ] = new InfoRequestData( requestData );
 
-        QMetaObject::invokeMethod( ptr.data(), "getInfo", Qt::QueuedConnection, Q_ARG( Tomahawk::InfoSystem::InfoRequestData, requestData ) );
+        dispatch( ptr.data(), requestData );
     }
 
     if ( !foundOne )
@@ -310,6 +321,109 @@ InfoSystemWorker::getInfo( Tomahawk::InfoSystem::InfoRequestData requestData )
 }
 
 
+QString
+InfoSystemWorker::coalescingKey( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData ) const
+{
+    // customData may change what a plugin does, so only plain requests get shared
+    if ( !requestData.customData.isEmpty() )
+        return QString();
+
+    QString input;
+    if ( requestData.input.canConvert< Tomahawk::InfoSystem::InfoStringHash >() )
+    {
+        const InfoStringHash hash = requestData.input.value< Tomahawk::InfoSystem::InfoStringHash >();
+        QStringList keys = hash.keys();
+        keys.sort();
+        foreach ( const QString& key, keys )
+            input += key + QChar( 0 ) + hash.value( key ) + QChar( 0 );
+    }
+    else if ( requestData.input.type() == QVariant::String )
+        input = requestData.input.toString();
+    else
+        return QString();
+
+    return QString( "%1/%2/" ).arg( (quintptr)plugin ).arg( (int)requestData.type ) + input;
+}
+
+
+void
+InfoSystemWorker::dispatch( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData )
+{
+    const QString key = coalescingKey( plugin, requestData );
+    if ( !key.isEmpty() )
+    {
+        QHash< QString, quint64 >::const_iterator it = m_inFlight.constFind( key );
+        if ( it != m_inFlight.constEnd() )
+        {
+            // Answered together with the identical request already on its way
+            m_coalesced[ it.value() ] << requestData.internalId;
+            return;
+        }
+
+        m_inFlight.insert( key, requestData.internalId );
+        m_inFlightKeys.insert( requestData.internalId, key );
+    }
+
+    if ( m_pluginLoad.value( plugin ) < MAX_PLUGIN_REQUESTS )
+        send( plugin, requestData );
+    else
+        m_pluginQueues[ plugin ].insert( qMakePair( (int)requestData.priority, m_queueSequence++ ), requestData );
+}
+
+
+void
+InfoSystemWorker::send( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData )
+{
+    m_pluginLoad[ plugin ]++;
+    m_dispatched.insert( requestData.internalId, plugin );
+
+    QMetaObject::invokeMethod( plugin, "getInfo", Qt::QueuedConnection, Q_ARG( Tomahawk::InfoSystem::InfoRequestData, requestData ) );
+}
+
+
+void
+InfoSystemWorker::release( quint64 requestId )
+{
+    QObject* plugin = m_dispatched.take( requestId );
+    if ( !plugin )
+        return;
+
+    m_pluginLoad[ plugin ]--;
+
+    QHash< QObject*, QMap< QPair< int, quint64 >, InfoRequestData > >::iterator it = m_pluginQueues.find( plugin );
+    while ( it != m_pluginQueues.end() && !it.value().isEmpty() && m_pluginLoad.value( plugin ) < MAX_PLUGIN_REQUESTS )
+    {
+        const InfoRequestData requestData = it.value().take( it.value().firstKey() );
+        if ( isWaitedFor( requestData.internalId ) )
+        {
+            send( plugin, requestData );
+        }
+        else
+        {
+            // Timed out while queued, along with everyone sharing it
+            m_inFlight.remove( m_inFlightKeys.take( requestData.internalId ) );
+            m_coalesced.remove( requestData.internalId );
+        }
+    }
+}
+
+
+bool
+InfoSystemWorker::isWaitedFor( quint64 requestId ) const
+{
+    if ( !m_requestSatisfiedMap.value( requestId, true ) )
+        return true;
+
+    foreach ( quint64 waiterId, m_coalesced.value( requestId ) )
+    {
+        if ( !m_requestSatisfiedMap.value( waiterId, true ) )
+            return true;
+    }
+
+    return false;
+}
+
+
 void
 InfoSystemWorker::pushInfo( Tomahawk::InfoSystem::InfoPushData pushData )
 {
@@ -330,6 +444,18 @@ InfoSystemWorker::infoSlot( Tomahawk::InfoSystem::InfoRequestData requestData, Q
 
     quint64 requestId = requestData.internalId;
 
+    release( requestId );
+    m_inFlight.remove( m_inFlightKeys.take( requestId ) );
+
+    // Hand the answer to everyone who asked the same question meanwhile
+    foreach ( quint64 waiterId, m_coalesced.take( requestId ) )
+    {
+        if ( m_requestSatisfiedMap.value( waiterId, true ) || !m_savedRequestMap.contains( waiterId ) )
+            continue;
+
+        infoSlot( *m_savedRequestMap.value( waiterId ), output );
+    }
+
     if ( m_dataTracker[ requestData.caller ][ requestData.type ] == 0 )
     {
 //        qDebug() << Q_FUNC_INFO << "Caller was not waiting for that type of data!";
@@ -391,6 +517,23 @@ InfoSystemWorker::checkTimeoutsTimerFired()
 //                qDebug() << Q_FUNC_INFO << "Doh, timed out for requestId" << requestId;
                 InfoRequestData *savedData = m_savedRequestMap[ requestId ];
 
+                // Don't let a plugin that never answers hold its slot, or new
+                // identical requests wait on this one
+                QObject* plugin = m_dispatched.value( requestId );
+                release( requestId );
+                m_inFlight.remove( m_inFlightKeys.take( requestId ) );
+
+                // Requests that were sharing this one still have time left, they get
+                // their own call. Still queued, it gets sent for them anyway.
+                if ( plugin )
+                {
+                    foreach ( quint64 waiterId, m_coalesced.take( requestId ) )
+                    {
+                        if ( !m_requestSatisfiedMap.value( waiterId, true ) && m_savedRequestMap.contains( waiterId ) )
+                            dispatch( plugin, *m_savedRequestMap.value( waiterId ) );
+                    }
+                }
+
                 InfoRequestData returnData;
                 returnData.caller = savedData->caller;
                 returnData.type = savedData->type;
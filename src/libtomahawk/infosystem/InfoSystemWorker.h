@@ -72,7 +72,7 @@ public slots:
 
 private slots:
     void checkTimeoutsTimerFired();
-    void onInfoPluginDeleted();
+    void onInfoPluginDeleted( QObject* plugin );
 
 private:
     void registerInfoTypes( const InfoPluginPtr &plugin, const QSet< InfoType > &getTypes, const QSet< InfoType > &pushTypes );
@@ -81,11 +81,29 @@ private:
     void checkFinished( const Tomahawk::InfoSystem::InfoRequestData &target );
     QList< InfoPluginPtr > determineOrderedMatches( const InfoType type ) const;
 
+    QString coalescingKey( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData ) const;
+    void dispatch( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData );
+    void send( QObject* plugin, const Tomahawk::InfoSystem::InfoRequestData& requestData );
+    void release( quint64 requestId );
+    bool isWaitedFor( quint64 requestId ) const;
+
     QHash< QString, QHash< InfoType, int > > m_dataTracker;
     QMultiMap< qint64, quint64 > m_timeRequestMapper;
     QHash< uint, bool > m_requestSatisfiedMap;
     QHash< uint, InfoRequestData* > m_savedRequestMap;
 
+    // Identical requests (same plugin, type and input) share one plugin call:
+    // key -> the request that got dispatched, and that request -> the ones waiting on it
+    QHash< QString, quint64 > m_inFlight;
+    QHash< quint64, QString > m_inFlightKeys;
+    QHash< quint64, QList< quint64 > > m_coalesced;
+
+    // Requests each plugin is working on, and the ones queued by priority until it has room
+    QHash< QObject*, int > m_pluginLoad;
+    QHash< quint64, QObject* > m_dispatched;
+    QHash< QObject*, QMap< QPair< int, quint64 >, InfoRequestData > > m_pluginQueues;
+    quint64 m_queueSequence;
+
     // NOTE Cache object lives in a different thread, do not call methods on it directly
     InfoSystemCache* m_cache;
 
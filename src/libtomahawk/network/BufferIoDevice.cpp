@@ -21,19 +21,32 @@
 #include "BufferIoDevice_p.h"
 
 #include <QCoreApplication>
+#include <QDir>
 #include <QMutexLocker>
 #include <QThread>
 
+#include <string.h>
+
 #include "utils/Logger.h"
 
 // Msgs are framed, this is the size each msg we send containing audio data:
 #define BLOCKSIZE 4096
+// Files bigger than this are buffered in a memory mapped temporary file
+#define SPILL_THRESHOLD ( 64 * 1024 * 1024 )
 
 
 BufferIODevice::BufferIODevice( unsigned int size, QObject* parent )
     : QIODevice( parent )
     , d_ptr( new BufferIODevicePrivate( this, size ) )
 {
+    Q_D( BufferIODevice );
+
+    // the size is known up front for peer streams, so allocate everything at once
+    if ( size > 0 )
+    {
+        reserve( size );
+        d->blocks.resize( maxBlocks() );
+    }
 }
 
 
@@ -117,17 +130,39 @@ void
 BufferIODevice::addData( int block, const QByteArray& ba )
 {
     Q_D( BufferIODevice );
+    if ( ba.isEmpty() )
+        return;
+
+    // ba may span several blocks
+    const int lastBlock = block + ( ba.count() - 1 ) / BLOCKSIZE;
+    unsigned int added = 0;
     {
         QMutexLocker lock( &d->mut );
 
-        while ( d->buffer.count() <= block )
-            d->buffer << QByteArray();
+        const qint64 start = (qint64)block * BLOCKSIZE;
+        if ( !reserve( start + ba.count() ) )
+            return;
+
+        memcpy( d->data + start, ba.constData(), ba.count() );
 
-        d->buffer.replace( block, ba );
+        if ( d->blocks.size() <= lastBlock )
+            d->blocks.resize( lastBlock + 1 );
+
+        for ( int i = block; i <= lastBlock; i++ )
+        {
+            if ( d->blocks.testBit( i ) )
+                continue;
+
+            d->blocks.setBit( i );
+            added += qMin( BLOCKSIZE, ba.count() - ( i - block ) * BLOCKSIZE );
+        }
+
+        while ( d->firstEmpty < d->blocks.size() && d->blocks.testBit( d->firstEmpty ) )
+            d->firstEmpty++;
     }
 
     // If this was the last block of the transfer, check if we need to fill up gaps
-    if ( block + 1 == maxBlocks() )
+    if ( lastBlock + 1 == maxBlocks() )
     {
         if ( nextEmptyBlock() >= 0 )
         {
@@ -135,7 +170,7 @@ BufferIODevice::addData( int block, const QByteArray& ba )
         }
     }
 
-    d->received += ba.count();
+    d->received += added;
     emit bytesWritten( ba.count() );
     emit readyRead();
 }
@@ -159,14 +194,27 @@ BufferIODevice::readData( char* data, qint64 maxSize )
     if ( atEnd() )
         return 0;
 
-    QByteArray ba;
-    ba.append( getData( d->pos, maxSize ) );
-    d->pos += ba.count();
+    QMutexLocker lock( &d->mut );
+
+    // copy straight from our buffer into the caller's, as far as we have contiguous data
+    const qint64 end = qMin( (qint64)d->pos + maxSize, (qint64)d->size );
+    qint64 copied = 0;
+    while ( d->pos + copied < end )
+    {
+        const qint64 pos = d->pos + copied;
+        const int block = blockForPos( pos );
+        if ( !hasBlock( block ) )
+            break;
+
+        const qint64 chunk = qMin( end, (qint64)( block + 1 ) * BLOCKSIZE ) - pos;
+        memcpy( data + copied, d->data + pos, chunk );
+        copied += chunk;
+    }
 
-//    qDebug() << Q_FUNC_INFO << maxSize << ba.count() << 2;
-    memcpy( data, ba.data(), ba.count() );
+    d->pos += copied;
 
-    return ba.count();
+//    qDebug() << Q_FUNC_INFO << maxSize << copied << 2;
+    return copied;
 }
 
 
@@ -214,7 +262,8 @@ BufferIODevice::clear()
     QMutexLocker lock( &d->mut );
 
     d->pos = 0;
-    d->buffer.clear();
+    d->blocks.fill( false );
+    d->firstEmpty = 0;
 }
 
 
@@ -258,15 +307,11 @@ int
 BufferIODevice::nextEmptyBlock() const
 {
     Q_D( const BufferIODevice );
+    QMutexLocker lock( &d->mut );
 
-    int i = 0;
-    foreach( const QByteArray& ba, d->buffer )
-    {
-        if ( ba.isEmpty() )
-            return i;
-
+    int i = d->firstEmpty;
+    while ( i < d->blocks.size() && d->blocks.testBit( i ) )
         i++;
-    }
 
     if ( i == maxBlocks() )
         return -1;
@@ -293,34 +338,95 @@ bool
 BufferIODevice::isBlockEmpty( int block ) const
 {
     Q_D( const BufferIODevice );
-    if ( block >= d->buffer.count() )
-        return true;
+    QMutexLocker lock( &d->mut );
 
-    return d->buffer.at( block ).isEmpty();
+    return !hasBlock( block );
 }
 
 
-QByteArray
-BufferIODevice::getData( qint64 pos, qint64 size )
+qint64
+BufferIODevice::receivedLength() const
 {
-    Q_D( BufferIODevice );
-//    qDebug() << Q_FUNC_INFO << pos << size << 1;
-    QByteArray ba;
-    int block = blockForPos( pos );
-    int offset = offsetForPos( pos );
+    Q_D( const BufferIODevice );
+    QMutexLocker lock( &d->mut );
+
+    return qMin( (qint64)d->firstEmpty * BLOCKSIZE, (qint64)d->size );
+}
+
 
+qint64
+BufferIODevice::copyData( char* data, qint64 pos, qint64 maxSize ) const
+{
+    Q_D( const BufferIODevice );
     QMutexLocker lock( &d->mut );
-    while( ba.count() < size )
+
+    const qint64 length = qMin( pos + maxSize, qMin( (qint64)d->firstEmpty * BLOCKSIZE, (qint64)d->size ) ) - pos;
+    if ( length <= 0 || !d->data )
+        return 0;
+
+    memcpy( data, d->data + pos, length );
+    return length;
+}
+
+
+bool
+BufferIODevice::hasBlock( int block ) const
+{
+    Q_D( const BufferIODevice );
+
+    return block >= 0 && block < d->blocks.size() && d->blocks.testBit( block );
+}
+
+
+bool
+BufferIODevice::reserve( qint64 bytes )
+{
+    Q_D( BufferIODevice );
+
+    if ( bytes <= d->capacity )
+        return true;
+
+    // grow in steps when we don't know the final size
+    const qint64 capacity = d->size > 0 ? qMax( bytes, (qint64)d->size ) : qMax( bytes, d->capacity * 2 );
+
+    if ( !d->spill && capacity < SPILL_THRESHOLD )
     {
-        if ( block > maxBlocks() )
-            break;
+        d->memory.resize( capacity );
+        d->data = (uchar*)d->memory.data();
+        d->capacity = capacity;
+        return true;
+    }
 
-        if ( isBlockEmpty( block ) )
-            break;
+    if ( !d->spill )
+    {
+        d->spill = new QTemporaryFile( QDir::tempPath() + "/tomahawk_stream_XXXXXX" );
+        if ( !d->spill->open() || d->spill->write( d->memory.constData(), d->capacity ) != d->capacity )
+        {
+            tLog() << Q_FUNC_INFO << "Could not create spill file:" << d->spill->errorString();
+            delete d->spill;
+            d->spill = 0;
+            return false;
+        }
+
+        d->memory.clear();
+    }
+    else
+        d->spill->unmap( d->data );
 
-        ba.append( d->buffer.at( block++ ).mid( offset ) );
+    d->data = 0;
+    if ( d->spill->resize( capacity ) )
+        d->data = d->spill->map( 0, capacity );
+
+    if ( !d->data )
+    {
+        // whatever we had received is gone now
+        tLog() << Q_FUNC_INFO << "Could not map spill file:" << d->spill->errorString();
+        d->capacity = 0;
+        d->blocks.fill( false );
+        d->firstEmpty = 0;
+        return false;
     }
 
-//    qDebug() << Q_FUNC_INFO << pos << size << 2;
-    return ba.left( size );
+    d->capacity = capacity;
+    return true;
 }
@@ -22,9 +22,11 @@
 
 #include <QIODevice>
 
+#include "DllMacro.h"
+
 class BufferIODevicePrivate;
 
-class BufferIODevice : public QIODevice
+class DLLEXPORT BufferIODevice : public QIODevice
 {
 Q_OBJECT
 
@@ -58,6 +60,11 @@ public:
     int nextEmptyBlock() const;
     bool isBlockEmpty( int block ) const;
 
+    /// Bytes received from the start without a gap
+    qint64 receivedLength() const;
+    /// Copies what receivedLength() covers from @p pos on, without moving the read position
+    qint64 copyData( char* data, qint64 pos, qint64 maxSize ) const;
+
 signals:
     void blockRequest( int block );
 
@@ -68,7 +75,8 @@ protected:
 private:
     int blockForPos( qint64 pos ) const;
     int offsetForPos( qint64 pos ) const;
-    QByteArray getData( qint64 pos, qint64 size );
+    bool hasBlock( int block ) const;
+    bool reserve( qint64 bytes );
 
     Q_DECLARE_PRIVATE( BufferIODevice )
     BufferIODevicePrivate* d_ptr;
@@ -22,7 +22,9 @@
 
 #include "BufferIoDevice.h"
 
+#include <QBitArray>
 #include <QMutex>
+#include <QTemporaryFile>
 
 class BufferIODevicePrivate
 {
@@ -32,18 +34,36 @@ public:
         , size( size )
         , received( 0 )
         , pos( 0 )
-
+        , spill( 0 )
+        , data( 0 )
+        , capacity( 0 )
+        , firstEmpty( 0 )
+    {
+    }
+    ~BufferIODevicePrivate()
     {
+        delete spill;
     }
     BufferIODevice* q_ptr;
     Q_DECLARE_PUBLIC ( BufferIODevice )
 
 private:
-    QList<QByteArray> buffer;
     mutable QMutex mut;
     unsigned int size;
     unsigned int received;
     unsigned int pos;
+
+    // Received data is stored contiguously, either in memory or, for large
+    // files, in a memory mapped temporary file. data points into either.
+    QByteArray memory;
+    QTemporaryFile* spill;
+    uchar* data;
+    qint64 capacity;
+
+    // One bit per block, set once the block has been received
+    QBitArray blocks;
+    // All blocks before this one have been received
+    int firstEmpty;
 };
 
 #endif // BUFFERIODEVICE_P_H
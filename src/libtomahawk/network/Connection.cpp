@@ -59,6 +59,8 @@ Connection::~Connection()
 {
     Q_D( Connection );
     tDebug( LOGVERBOSE ) << "DTOR connection (super)" << id() << thread() << d->sock.isNull();
+    tDebug( LOGVERBOSE ) << "Compression ratio out:" << d->msgprocessor_out.compressionRatio() << "in" << d->msgprocessor_out.compressionTime() << "ms,"
+                         << "in:" << d->msgprocessor_in.compressionRatio() << "in" << d->msgprocessor_in.compressionTime() << "ms";
     if ( !d->sock.isNull() )
     {
         d->sock->deleteLater();
@@ -282,6 +284,12 @@ Connection::bytesReceived() const
     return d_func()->rx_bytes;
 }
 
+qint64
+Connection::bytesPending() const
+{
+    return d_func()->tx_bytes_requested - d_func()->tx_bytes;
+}
+
 void
 Connection::setMsgProcessorModeOut(quint32 m)
 {
@@ -79,6 +79,8 @@ public:
 
     qint64 bytesSent() const;
     qint64 bytesReceived() const;
+    /// Bytes passed to sendMsg() that have not been written to the socket yet
+    qint64 bytesPending() const;
 
     void setMsgProcessorModeOut( quint32 m );
     void setMsgProcessorModeIn( quint32 m );
@@ -30,8 +30,10 @@
 #include "utils/Logger.h"
 
 #include "PlaylistEntry.h"
+#include "StreamChannelConnection.h"
 #include "StreamConnection.h"
 #include "SourceList.h"
+#include "TomahawkSettings.h"
 
 #define TCP_TIMEOUT 600
 
@@ -70,6 +72,8 @@ ControlConnection::~ControlConnection()
     servent()->unregisterControlConnection( this );
     if ( d->dbsyncconn )
         d->dbsyncconn->deleteLater();
+    if ( d->streamChannels )
+        d->streamChannels.data()->shutdown();
     delete d_ptr;
 }
 
@@ -143,6 +147,15 @@ ControlConnection::setup()
         d->pingtimer->start();
         d->pingtimer_mark.start();
         d->sourceLock.unlock();
+
+        // Older peers log this as unhandled and keep getting a connection per stream
+        if ( TomahawkSettings::instance()->streamChannels() )
+        {
+            QVariantMap m;
+            m.insert( "method", "stream-channels" );
+            m.insert( "version", 1 );
+            sendMsg( m );
+        }
     }
     else
     {
@@ -304,6 +317,10 @@ ControlConnection::handleMsg( msg_ptr msg )
             d->dbconnkey = m.value( "key" ).toString() ;
             setupDbSyncConnection();
         }
+        else if ( m.value( "method" ).toString() == "stream-channels" )
+        {
+            d->peerStreamChannels = m.value( "version" ).toInt() >= 1;
+        }
         else if ( m.value( "method" ) == "protovercheckfail" )
         {
             qDebug() << "*** Remote peer protocol version mismatch, connection closed";
@@ -350,6 +367,36 @@ ControlConnection::onPingTimer()
 }
 
 
+StreamChannelConnection*
+ControlConnection::streamChannelConnection()
+{
+    Q_D( ControlConnection );
+    if ( !d->peerStreamChannels || !TomahawkSettings::instance()->streamChannels() )
+        return 0;
+
+    if ( d->streamChannels.isNull() )
+    {
+        d->streamChannels = new StreamChannelConnection( servent(), this );
+        connect( d->streamChannels.data(), SIGNAL( failed() ), SLOT( onStreamChannelsFailed() ) );
+
+        servent()->createParallelConnection( this, d->streamChannels.data(), STREAM_CHANNELS_KEY );
+    }
+
+    return d->streamChannels.data();
+}
+
+
+void
+ControlConnection::onStreamChannelsFailed()
+{
+    Q_D( ControlConnection );
+
+    // Probably something between us and the peer we can't fix, don't try again with every stream
+    tLog() << Q_FUNC_INFO << "Could not connect stream channels to" << name() << "- falling back to a connection per stream";
+    d->peerStreamChannels = false;
+}
+
+
 void
 ControlConnection::addPeerInfo( const peerinfo_ptr& peerInfo )
 {
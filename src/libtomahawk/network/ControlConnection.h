@@ -35,6 +35,7 @@
 class ControlConnectionPrivate;
 class DBSyncConnection;
 class Servent;
+class StreamChannelConnection;
 
 class DLLEXPORT ControlConnection : public Connection
 {
@@ -59,6 +60,12 @@ public:
     void setShutdownOnEmptyPeerInfos( bool shutdownOnEmptyPeerInfos );
     const QSet< Tomahawk::peerinfo_ptr > peerInfos() const;
 
+    /**
+     * The connection streams from this peer run over, connected on first use.
+     * Null if either side doesn't do stream channels, streams need a connection of their own then.
+     */
+    StreamChannelConnection* streamChannelConnection();
+
 protected:
     virtual void setup();
 
@@ -70,6 +77,7 @@ private slots:
     void dbSyncConnFinished( QObject* c );
     void registerSource();
     void onPingTimer();
+    void onStreamChannelsFailed();
 
 private:
     Q_DECLARE_PRIVATE( ControlConnection )
@@ -23,6 +23,7 @@
 
 #include "ControlConnection.h"
 
+#include <QPointer>
 #include <QReadWriteLock>
 #include <QTime>
 #include <QTimer>
@@ -36,6 +37,7 @@ public:
         , registered( false )
         , shutdownOnEmptyPeerInfos( true )
         , pingtimer( 0 )
+        , peerStreamChannels( false )
     {
     }
     ControlConnection* q_ptr;
@@ -58,6 +60,10 @@ private:
     QTime pingtimer_mark;
 
     QSet< Tomahawk::peerinfo_ptr > peerInfos;
+
+    // The peer announced it can run streams as channels, see StreamChannelConnection
+    bool peerStreamChannels;
+    QPointer< StreamChannelConnection > streamChannels;
 };
 
 #endif // CONTROLCONNECTION_P_H
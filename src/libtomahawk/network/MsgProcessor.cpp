@@ -23,16 +23,46 @@
 #include "utils/Json.h"
 #include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
+#include "TomahawkSettings.h"
 
+#include <QElapsedTimer>
 #include <QThread>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <qtconcurrentrun.h>
 
+// Only keep compressed payloads that are at most this big, relative to the original
+#define MIN_RATIO 0.9
+// After this many msgs in a row that didn't compress well, only compress every PROBE_INTERVALth msg
+#define POOR_STREAK 8
+#define PROBE_INTERVAL 16
+
 MsgProcessor::MsgProcessor( quint32 mode, quint32 t ) :
-    QObject(), m_mode( mode ), m_threshold( t ), m_totmsgsize( 0 )
+    QObject(), m_mode( mode ), m_threshold( t ), m_level( 3 ), m_stats( new MsgProcessorStats ), m_totmsgsize( 0 )
 {
     moveToThread( Servent::instance()->thread() );
+
+    if ( TomahawkSettings::instance() )
+        m_level = qBound( 0, TomahawkSettings::instance()->msgCompressionLevel(), 9 );
+}
+
+
+float
+MsgProcessor::compressionRatio() const
+{
+    QMutexLocker lock( &m_stats->mutex );
+    if ( m_stats->bytesIn == 0 )
+        return 1.0;
+
+    return (float)m_stats->bytesOut / m_stats->bytesIn;
+}
+
+
+qint64
+MsgProcessor::compressionTime() const
+{
+    QMutexLocker lock( &m_stats->mutex );
+    return m_stats->nsecs / 1000000;
 }
 
 
@@ -58,7 +88,10 @@ MsgProcessor::append( msg_ptr msg )
         return;
     }
 
-    QFuture<msg_ptr> fut = QtConcurrent::run(&MsgProcessor::process, msg, m_mode, m_threshold);
+    // level 0 means we don't compress at all
+    const quint32 mode = m_level > 0 ? m_mode : ( m_mode & ~COMPRESS_IF_LARGE );
+
+    QFuture<msg_ptr> fut = QtConcurrent::run( &MsgProcessor::process, msg, mode, m_threshold, m_level, m_stats );
     QFutureWatcher<msg_ptr> * watcher = new QFutureWatcher<msg_ptr>;
     connect( watcher, SIGNAL( finished() ),
              this, SLOT( processed() ),
@@ -107,15 +140,29 @@ MsgProcessor::handleProcessedMsg( msg_ptr msg )
 
 /// This method is run by QtConcurrent:
 msg_ptr
-MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
+MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold, int level, QSharedPointer< MsgProcessorStats > stats )
 {
+    QElapsedTimer timer;
+
     // uncompress if needed
     if( (mode & UNCOMPRESS_ALL) && msg->is( Msg::COMPRESSED ) )
     {
 //        qDebug() << "MsgProcessor::UNCOMPRESSING";
+        timer.start();
+        const quint32 compressedLength = msg->length();
+
         msg->d_func()->payload = qUncompress( msg->payload() );
         msg->d_func()->length  = msg->d_func()->payload.length();
         msg->d_func()->flags ^= Msg::COMPRESSED;
+
+        if ( stats )
+        {
+            QMutexLocker lock( &stats->mutex );
+            stats->compressed++;
+            stats->bytesIn += msg->length();
+            stats->bytesOut += compressedLength;
+            stats->nsecs += timer.nsecsElapsed();
+        }
     }
 
     // parse json payload into qvariant if needed
@@ -129,15 +176,56 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
         msg->d_func()->json_parsed = true;
     }
 
-    // compress if needed
+    // compress if needed. Payloads that are compressed already (e.g. ops from the oplog) are flagged as such
     if( (mode & COMPRESS_IF_LARGE) &&
         !msg->is( Msg::COMPRESSED )
         && msg->length() > threshold )
     {
-//        qDebug() << "MsgProcessor::COMPRESSING";
-        msg->d_func()->payload = qCompress( msg->payload(), 9 );
-        msg->d_func()->length  = msg->d_func()->payload.length();
-        msg->d_func()->flags |= Msg::COMPRESSED;
+        bool probe = true;
+        if ( stats )
+        {
+            // this connection's msgs didn't compress well lately, so only try now and then
+            QMutexLocker lock( &stats->mutex );
+            probe = stats->poorStreak < POOR_STREAK || ( stats->skipped % PROBE_INTERVAL ) == 0;
+        }
+
+        QByteArray compressed;
+        if ( probe )
+        {
+//            qDebug() << "MsgProcessor::COMPRESSING";
+            timer.start();
+            compressed = qCompress( msg->payload(), level );
+        }
+
+        // qCompress prepends 4 bytes of the uncompressed size
+        const bool worthIt = probe && compressed.length() <= msg->length() * MIN_RATIO;
+        if ( stats )
+        {
+            QMutexLocker lock( &stats->mutex );
+            if ( probe )
+                stats->nsecs += timer.nsecsElapsed();
+
+            stats->bytesIn += msg->length();
+            stats->bytesOut += worthIt ? compressed.length() : msg->length();
+            if ( worthIt )
+            {
+                stats->compressed++;
+                stats->poorStreak = 0;
+            }
+            else
+            {
+                stats->skipped++;
+                if ( probe )
+                    stats->poorStreak++;
+            }
+        }
+
+        if ( worthIt )
+        {
+            msg->d_func()->payload = compressed;
+            msg->d_func()->length  = msg->d_func()->payload.length();
+            msg->d_func()->flags |= Msg::COMPRESSED;
+        }
     }
     return msg;
 }
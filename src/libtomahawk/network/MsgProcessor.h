@@ -33,7 +33,30 @@
 #include "Typedefs.h"
 #include "Msg.h" // Needed because we have msg_ptr in a slot
 
+#include <QMutex>
 #include <QObject>
+#include <QSharedPointer>
+
+/// Compression stats of one MsgProcessor, updated by the QtConcurrent workers
+struct MsgProcessorStats
+{
+    MsgProcessorStats()
+        : compressed( 0 )
+        , skipped( 0 )
+        , bytesIn( 0 )
+        , bytesOut( 0 )
+        , nsecs( 0 )
+        , poorStreak( 0 )
+    {}
+
+    QMutex mutex;
+    quint64 compressed;  // msgs we compressed
+    quint64 skipped;     // msgs not worth compressing
+    quint64 bytesIn;     // payload bytes before compression
+    quint64 bytesOut;    // ... and after, uncompressed size of skipped msgs
+    quint64 nsecs;       // time spent (un)compressing
+    int poorStreak;      // consecutive msgs that didn't compress well
+};
 
 class MsgProcessor : public QObject
 {
@@ -51,10 +74,16 @@ public:
 
     void setMode( quint32 m ) { m_mode = m ; }
 
-    static msg_ptr process( msg_ptr msg, quint32 mode, quint32 threshold );
+    static msg_ptr process( msg_ptr msg, quint32 mode, quint32 threshold,
+                            int level = 9, QSharedPointer< MsgProcessorStats > stats = QSharedPointer< MsgProcessorStats >() );
 
     int length() const { return m_msgs.length(); }
 
+    /// compressed / uncompressed size of all msgs above the threshold so far
+    float compressionRatio() const;
+    /// msecs spent (un)compressing so far
+    qint64 compressionTime() const;
+
 signals:
     void ready( msg_ptr );
     void empty();
@@ -68,6 +97,8 @@ private:
 
     quint32 m_mode;
     quint32 m_threshold;
+    int m_level;
+    QSharedPointer< MsgProcessorStats > m_stats;
     QList<msg_ptr> m_msgs;
     QMap< Msg*, bool> m_msg_ready;
     unsigned int m_totmsgsize;
@@ -44,7 +44,11 @@
 #include "QTcpSocketExtra.h"
 #include "Source.h"
 #include "SourceList.h"
+#include "BufferIoDevice.h"
+#include "StreamCache.h"
+#include "StreamChannelConnection.h"
 #include "StreamConnection.h"
+#include "TomahawkSettings.h"
 #include "UrlHandler.h"
 
 #include <QCoreApplication>
@@ -56,6 +60,9 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 
+// Blocks of the next track fetched ahead of time, about 10 seconds of a 320 kbit/s mp3
+#define PREFETCH_BLOCKS 100
+
 
 typedef QPair< QList< SipInfo >, Connection* > sipConnectionPair;
 Q_DECLARE_METATYPE( sipConnectionPair )
@@ -1124,8 +1131,8 @@ Servent::claimOffer( ControlConnection* cc, const QString &nodeid, const QString
 {
     Q_D( Servent );
 
-    // magic key for stream connections:
-    if ( key.startsWith( "FILE_REQUEST_KEY:" ) )
+    // magic keys for stream connections:
+    if ( key.startsWith( "FILE_REQUEST_KEY:" ) || key == STREAM_CHANNELS_KEY )
     {
         // check if the source IP matches an existing, authenticated connection
         if ( !d->noAuth && peer != QHostAddress::Any && !isIPWhitelisted( peer ) )
@@ -1154,6 +1161,9 @@ Servent::claimOffer( ControlConnection* cc, const QString &nodeid, const QString
             }
         }
 
+        if ( key == STREAM_CHANNELS_KEY )
+            return new StreamChannelConnection( this, cc );
+
         QString fid = key.right( key.length() - 17 );
         StreamConnection* sc = new StreamConnection( this, cc, fid );
         return sc;
@@ -1258,6 +1268,15 @@ Servent::remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QStrin
     QStringList parts = url.mid( QString( "servent://" ).length() ).split( "\t" );
     const QString sourceName = parts.at( 0 );
     const QString fileId = parts.at( 1 );
+    const QString cacheKey = StreamCache::key( sourceName, fileId, result );
+
+    sp = StreamCache::instance()->open( cacheKey );
+    if ( sp )
+    {
+        callback( result->url(), sp );
+        return;
+    }
+
     source_ptr s = SourceList::instance()->get( sourceName );
     if ( s.isNull() || !s->controlConnection() )
     {
@@ -1265,9 +1284,21 @@ Servent::remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QStrin
         return;
     }
 
-    ControlConnection* cc = s->controlConnection();
-    StreamConnection* sc = new StreamConnection( this, cc, fileId, result );
-    createParallelConnection( cc, sc, QString( "FILE_REQUEST_KEY:%1" ).arg( fileId ) );
+    // The prefetch of this track is already running, let it fetch the rest as well
+    StreamConnection* sc = StreamCache::instance()->takePrefetch( cacheKey );
+    if ( sc )
+    {
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Continuing prefetch" << sc->id();
+        sc->setPrefetchBlocks( 0 );
+    }
+    else
+    {
+        ControlConnection* cc = s->controlConnection();
+        sc = new StreamConnection( this, cc, fileId, result );
+        sc->setCacheKey( cacheKey );
+        StreamCache::instance()->fill( cacheKey, (BufferIODevice*)sc->iodevice().data() );
+        startStream( cc, sc );
+    }
 
     // std::functions cannot accept temporaries as parameters
     sp = sc->iodevice();
@@ -1275,6 +1306,49 @@ Servent::remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QStrin
 }
 
 
+void
+Servent::prefetchStream( const Tomahawk::result_ptr& result )
+{
+    if ( result.isNull() || !result->url().startsWith( "servent://" ) )
+        return;
+
+    QStringList parts = result->url().mid( QString( "servent://" ).length() ).split( "\t" );
+    if ( parts.count() < 2 || TomahawkSettings::instance()->streamCacheSize() == 0 )
+        return;
+
+    const QString sourceName = parts.at( 0 );
+    const QString fileId = parts.at( 1 );
+    const QString cacheKey = StreamCache::key( sourceName, fileId, result );
+    if ( StreamCache::instance()->contains( cacheKey ) || StreamCache::instance()->isPrefetching( cacheKey ) )
+        return;
+
+    source_ptr s = SourceList::instance()->get( sourceName );
+    if ( s.isNull() || !s->controlConnection() )
+        return;
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Prefetching" << result->toString();
+
+    ControlConnection* cc = s->controlConnection();
+    StreamConnection* sc = new StreamConnection( this, cc, fileId, result );
+    sc->setCacheKey( cacheKey );
+    sc->setPrefetchBlocks( PREFETCH_BLOCKS );
+    StreamCache::instance()->addPrefetch( cacheKey, sc );
+    startStream( cc, sc );
+}
+
+
+void
+Servent::startStream( ControlConnection* cc, StreamConnection* sc )
+{
+    // Saves a connect, handshake and ACL check per track with peers that can do it
+    StreamChannelConnection* channels = cc->streamChannelConnection();
+    if ( channels )
+        channels->addStream( sc );
+    else
+        createParallelConnection( cc, sc, QString( "FILE_REQUEST_KEY:%1" ).arg( sc->fid() ) );
+}
+
+
 void
 Servent::registerStreamConnection( StreamConnection* sc )
 {
@@ -93,6 +93,8 @@ public:
 
     void remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QString& url,
                                     std::function< void ( const QString&, QSharedPointer< QIODevice >& ) > callback );
+    /// Fetches the beginning of a peer's track into the StreamCache, so it starts right away when played
+    void prefetchStream( const Tomahawk::result_ptr& result );
 
     // you may call this method as often as you like for the same peerInfo, dupe checking is done inside
     void registerPeer( const Tomahawk::peerinfo_ptr& peerInfo );
@@ -190,6 +192,8 @@ private:
     ServentPrivate* d_ptr;
 
     void handoverSocket( Connection* conn, QTcpSocketExtra* sock );
+    /// Connects a receiving stream, over the peer's stream channels if possible
+    void startStream( ControlConnection* cc, StreamConnection* sc );
     void cleanupSocket( QTcpSocketExtra* sock );
     void printCurrentTransfers();
 
@@ -0,0 +1,381 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamCache.h"
+
+#include "network/BufferIoDevice.h"
+#include "network/StreamConnection.h"
+#include "utils/Logger.h"
+
+#include "Result.h"
+#include "TomahawkSettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+
+// Cached files are written in pieces of this size
+#define WRITE_CHUNK_SIZE ( 1024 * 1024 )
+
+StreamCache* StreamCache::s_instance = 0;
+
+
+namespace
+{
+
+class StreamWriter : public QRunnable
+{
+public:
+    StreamWriter( const QString& key, const QSharedPointer< BufferIODevice >& dev, qint64 length,
+                  const QString& path, bool complete )
+        : m_key( key )
+        , m_dev( dev )
+        , m_length( length )
+        , m_path( path )
+        , m_complete( complete )
+    {
+    }
+
+    void run()
+    {
+        // Written under a temporary name first, nobody must ever open a half written file
+        const QString tmpPath = m_path + ".tmp";
+        QFile file( tmpPath );
+        if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+            tLog() << Q_FUNC_INFO << "Could not write" << tmpPath << file.errorString();
+            return;
+        }
+
+        QByteArray buffer;
+        buffer.resize( WRITE_CHUNK_SIZE );
+
+        qint64 written = 0;
+        while ( written < m_length )
+        {
+            const qint64 copied = m_dev->copyData( buffer.data(), written, qMin( (qint64)WRITE_CHUNK_SIZE, m_length - written ) );
+            if ( copied <= 0 || file.write( buffer.constData(), copied ) != copied )
+                break;
+
+            written += copied;
+        }
+
+        file.close();
+        // Don't keep the stream's buffer alive any longer than needed
+        m_dev.clear();
+
+        QFile::remove( m_path );
+        if ( written != m_length || !QFile::rename( tmpPath, m_path ) )
+        {
+            tLog() << Q_FUNC_INFO << "Could not cache" << m_path << file.errorString();
+            QFile::remove( tmpPath );
+            return;
+        }
+
+        QMetaObject::invokeMethod( StreamCache::instance(), "onStored", Qt::QueuedConnection,
+                                   Q_ARG( QString, m_key ), Q_ARG( qint64, written ), Q_ARG( bool, m_complete ) );
+    }
+
+private:
+    QString m_key;
+    QSharedPointer< BufferIODevice > m_dev;
+    qint64 m_length;
+    QString m_path;
+    bool m_complete;
+};
+
+}
+
+
+StreamCache*
+StreamCache::instance()
+{
+    if ( !s_instance )
+        s_instance = new StreamCache();
+
+    return s_instance;
+}
+
+
+StreamCache::StreamCache()
+    : QObject()
+    , m_useCounter( 0 )
+    , m_totalSize( 0 )
+{
+    m_pool.setMaxThreadCount( 1 );
+
+    m_cacheDir = TomahawkSettings::instance()->storageCacheLocation() + "/StreamCache";
+    if ( !QDir().mkpath( m_cacheDir ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not create" << m_cacheDir;
+        m_cacheDir.clear();
+        return;
+    }
+
+    // Files we read or wrote most recently were used most recently
+    QMap< QDateTime, QFileInfo > files;
+    foreach ( const QFileInfo& fi, QDir( m_cacheDir ).entryInfoList( QDir::Files ) )
+    {
+        if ( fi.suffix() == "tmp" )
+        {
+            // leftover of an interrupted write
+            QFile::remove( fi.absoluteFilePath() );
+            continue;
+        }
+
+        files.insertMulti( qMax( fi.lastModified(), fi.lastRead() ), fi );
+    }
+
+    foreach ( const QFileInfo& fi, files )
+    {
+        const bool complete = fi.suffix().isEmpty();
+        const QString key = fi.completeBaseName();
+
+        if ( m_entries.contains( key ) )
+        {
+            // the beginning of a file we have completely isn't needed anymore
+            QFile::remove( path( key, false ) );
+            if ( !complete )
+                continue;
+
+            removeEntry( key );
+        }
+
+        Entry entry;
+        entry.size = fi.size();
+        entry.complete = complete;
+        entry.lastUsed = 0;
+        m_entries.insert( key, entry );
+        m_totalSize += entry.size;
+        touch( key );
+    }
+
+    tDebug() << Q_FUNC_INFO << "Caching" << m_entries.count() << "streams," << m_totalSize / ( 1024 * 1024 ) << "MiB";
+    evict();
+}
+
+
+StreamCache::~StreamCache()
+{
+    m_pool.waitForDone();
+}
+
+
+QString
+StreamCache::key( const QString& sourceName, const QString& fileId, const Tomahawk::result_ptr& result )
+{
+    const QString id = QString( "%1\t%2\t%3\t%4" ).arg( sourceName ).arg( fileId ).arg( result->size() ).arg( result->modificationTime() );
+    return QString::fromLatin1( QCryptographicHash::hash( id.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
+
+
+bool
+StreamCache::contains( const QString& key ) const
+{
+    return m_entries.contains( key );
+}
+
+
+QSharedPointer< QIODevice >
+StreamCache::open( const QString& key )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+
+    if ( !m_entries.value( key ).complete )
+        return QSharedPointer< QIODevice >();
+
+    QFile* file = new QFile( path( key, true ) );
+    if ( !file->open( QIODevice::ReadOnly ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not open cached stream" << file->fileName() << file->errorString();
+        delete file;
+        removeEntry( key );
+        return QSharedPointer< QIODevice >();
+    }
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Playing from cache:" << file->fileName();
+    touch( key );
+    return QSharedPointer< QIODevice >( file, &QObject::deleteLater );
+}
+
+
+bool
+StreamCache::fill( const QString& key, BufferIODevice* dev )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+
+    if ( !m_entries.contains( key ) || m_entries.value( key ).complete )
+        return false;
+
+    // only ever the first few blocks, small enough to read right here
+    QFile file( path( key, false ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        removeEntry( key );
+        return false;
+    }
+
+    const QByteArray data = file.read( qMin( file.size(), (qint64)dev->size() ) );
+    if ( data.isEmpty() )
+        return false;
+
+    dev->addData( 0, data );
+    touch( key );
+    return true;
+}
+
+
+void
+StreamCache::store( const QString& key, const QSharedPointer< BufferIODevice >& dev, bool complete )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+
+    m_prefetching.remove( key );
+
+    if ( m_cacheDir.isEmpty() || TomahawkSettings::instance()->streamCacheSize() == 0 )
+        return;
+
+    const qint64 length = dev->receivedLength();
+    if ( length <= 0 )
+        return;
+
+    if ( m_entries.contains( key ) )
+    {
+        const Entry entry = m_entries.value( key );
+        if ( entry.complete || ( !complete && entry.size >= length ) )
+        {
+            touch( key );
+            return;
+        }
+    }
+
+    m_pool.start( new StreamWriter( key, dev, length, path( key, complete ), complete ) );
+}
+
+
+void
+StreamCache::onStored( const QString& key, qint64 size, bool complete )
+{
+    if ( m_entries.contains( key ) )
+    {
+        // a complete file replaces its beginning
+        if ( complete && !m_entries.value( key ).complete )
+            QFile::remove( path( key, false ) );
+
+        removeEntry( key );
+    }
+
+    Entry entry;
+    entry.size = size;
+    entry.complete = complete;
+    entry.lastUsed = 0;
+    m_entries.insert( key, entry );
+    m_totalSize += size;
+    touch( key );
+
+    evict();
+}
+
+
+void
+StreamCache::addPrefetch( const QString& key, StreamConnection* sc )
+{
+    m_prefetching.insert( key, sc );
+
+    // prefetches that fail or get dropped never reach store()
+    connect( sc, SIGNAL( destroyed() ), SLOT( onPrefetchDestroyed() ), Qt::UniqueConnection );
+}
+
+
+void
+StreamCache::onPrefetchDestroyed()
+{
+    QHash< QString, QPointer< StreamConnection > >::iterator it = m_prefetching.begin();
+    while ( it != m_prefetching.end() )
+    {
+        if ( it.value().isNull() )
+            it = m_prefetching.erase( it );
+        else
+            ++it;
+    }
+}
+
+
+bool
+StreamCache::isPrefetching( const QString& key ) const
+{
+    return !m_prefetching.value( key ).isNull();
+}
+
+
+StreamConnection*
+StreamCache::takePrefetch( const QString& key )
+{
+    return m_prefetching.take( key ).data();
+}
+
+
+QString
+StreamCache::path( const QString& key, bool complete ) const
+{
+    return m_cacheDir + "/" + key + ( complete ? "" : ".part" );
+}
+
+
+void
+StreamCache::touch( const QString& key )
+{
+    QHash< QString, Entry >::iterator it = m_entries.find( key );
+    if ( it == m_entries.end() )
+        return;
+
+    m_lru.remove( it->lastUsed );
+    it->lastUsed = ++m_useCounter;
+    m_lru.insert( it->lastUsed, key );
+}
+
+
+void
+StreamCache::removeEntry( const QString& key )
+{
+    QHash< QString, Entry >::iterator it = m_entries.find( key );
+    if ( it == m_entries.end() )
+        return;
+
+    m_lru.remove( it->lastUsed );
+    m_totalSize -= it->size;
+    m_entries.erase( it );
+}
+
+
+void
+StreamCache::evict()
+{
+    const qint64 maxSize = (qint64)TomahawkSettings::instance()->streamCacheSize() * 1024 * 1024;
+
+    while ( m_totalSize > maxSize && !m_lru.isEmpty() )
+    {
+        const QString key = m_lru.begin().value();
+
+        // a file that is still being played may refuse to go away on some platforms,
+        // it's picked up again on the next start then
+        QFile::remove( path( key, m_entries.value( key ).complete ) );
+        removeEntry( key );
+    }
+}
@@ -0,0 +1,111 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_STREAMCACHE_H
+#define TOMAHAWK_STREAMCACHE_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+#include "DllMacro.h"
+#include "Typedefs.h"
+
+class BufferIODevice;
+class StreamConnection;
+
+/**
+ * Keeps files streamed from peers on disk, so replays don't need the network.
+ *
+ * Whole files are cached once a stream completed, prefetches only keep the
+ * beginning of a file so the next track can start before its stream does.
+ * The cache is bounded by TomahawkSettings::streamCacheSize(), the least
+ * recently used files get removed first.
+ *
+ * Must only be used from the thread Servent lives in.
+ */
+class DLLEXPORT StreamCache : public QObject
+{
+Q_OBJECT
+
+public:
+    static StreamCache* instance();
+    virtual ~StreamCache();
+
+    /**
+     * Identifies file @p fileId of peer @p sourceName. Size and modification
+     * time of @p result are part of it, a changed file gets a new key.
+     */
+    static QString key( const QString& sourceName, const QString& fileId, const Tomahawk::result_ptr& result );
+
+    /// Whether the whole file or at least its beginning is cached
+    bool contains( const QString& key ) const;
+
+    /// Reads the whole file from the cache, null if it isn't completely cached
+    QSharedPointer< QIODevice > open( const QString& key );
+
+    /// Puts the cached beginning of the file into @p dev, returns whether there was any
+    bool fill( const QString& key, BufferIODevice* dev );
+
+    /**
+     * Saves what @p dev received from its start up to the first gap. Set
+     * @p complete once the whole file arrived. Writing happens in the background.
+     */
+    void store( const QString& key, const QSharedPointer< BufferIODevice >& dev, bool complete );
+
+    void addPrefetch( const QString& key, StreamConnection* sc );
+    bool isPrefetching( const QString& key ) const;
+    /// Removes a running prefetch of @p key and returns it, so it can continue as a normal stream
+    StreamConnection* takePrefetch( const QString& key );
+
+private slots:
+    void onStored( const QString& key, qint64 size, bool complete );
+    void onPrefetchDestroyed();
+
+private:
+    explicit StreamCache();
+
+    struct Entry
+    {
+        qint64 size;
+        bool complete;
+        quint64 lastUsed;
+    };
+
+    QString path( const QString& key, bool complete ) const;
+    void touch( const QString& key );
+    void removeEntry( const QString& key );
+    void evict();
+
+    QString m_cacheDir;
+    QHash< QString, Entry > m_entries;
+    // lastUsed -> key, oldest first
+    QMap< quint64, QString > m_lru;
+    quint64 m_useCounter;
+    qint64 m_totalSize;
+
+    QHash< QString, QPointer< StreamConnection > > m_prefetching;
+
+    // A single thread, so writes of the same key can't overtake each other
+    QThreadPool m_pool;
+
+    static StreamCache* s_instance;
+};
+
+#endif // TOMAHAWK_STREAMCACHE_H
@@ -0,0 +1,326 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamChannelConnection.h"
+
+#include "network/ControlConnection.h"
+#include "network/Msg.h"
+#include "network/MsgProcessor.h"
+#include "network/Servent.h"
+#include "network/StreamConnection.h"
+#include "utils/Logger.h"
+
+#include <QTimer>
+
+// Bytes a channel may send per turn, before the next channel with queued data gets to send
+#define CHANNEL_QUANTUM ( 64 * 1024 )
+// Stop handing msgs to the socket while it has this much left to write
+#define SOCKET_WINDOW ( 256 * 1024 )
+// Give up on the connection if it isn't set up after this many ms, streams get their own then
+#define SETUP_TIMEOUT 20000
+
+
+StreamChannelConnection::StreamChannelConnection( Servent* s, ControlConnection* cc )
+    : Connection( s )
+    , m_cc( cc )
+    , m_nextChannel( 1 )
+    , m_finished( false )
+{
+    setId( "StreamChannelConnection" );
+
+    // the streams' msgs are passed on as they are, audio data doesn't compress anyway
+    setMsgProcessorModeIn( MsgProcessor::NOTHING );
+    setMsgProcessorModeOut( MsgProcessor::NOTHING );
+
+    connect( this, SIGNAL( finished() ), SLOT( onFinished() ) );
+    connect( this, SIGNAL( finished() ), SLOT( deleteLater() ), Qt::QueuedConnection );
+
+    // Offers don't expire, without this streams could wait for a connection that never arrives
+    QTimer::singleShot( SETUP_TIMEOUT, this, SLOT( onSetupTimeout() ) );
+}
+
+
+StreamChannelConnection::~StreamChannelConnection()
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "TX/RX:" << bytesSent() << bytesReceived();
+}
+
+
+Connection*
+StreamChannelConnection::clone()
+{
+    Q_ASSERT( false );
+    return 0;
+}
+
+
+void
+StreamChannelConnection::setup()
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Streams waiting:" << m_waiting.count();
+
+    connect( socket().data(), SIGNAL( bytesWritten( qint64 ) ), SLOT( sendSome() ), Qt::QueuedConnection );
+
+    const QList< QPointer< StreamConnection > > waiting = m_waiting;
+    m_waiting.clear();
+
+    foreach ( const QPointer< StreamConnection >& sc, waiting )
+    {
+        // skipped before we got here
+        if ( !sc.isNull() )
+            addStream( sc.data() );
+    }
+}
+
+
+void
+StreamChannelConnection::onSetupTimeout()
+{
+    if ( isReady() || m_finished )
+        return;
+
+    tLog() << Q_FUNC_INFO << "Stream channels not connected after" << SETUP_TIMEOUT << "ms, streams waiting:" << m_waiting.count();
+    markAsFailed();
+}
+
+
+void
+StreamChannelConnection::addStream( StreamConnection* sc )
+{
+    if ( m_finished )
+    {
+        // about to be deleted, the ControlConnection will make a new one next time
+        fallback( sc );
+        return;
+    }
+
+    if ( !isReady() )
+    {
+        m_waiting << sc;
+        return;
+    }
+
+    const quint32 channel = m_nextChannel++;
+    openChannel( channel, sc );
+    sendControl( channel, "open" + sc->fid().toUtf8() );
+
+    sc->setup();
+}
+
+
+void
+StreamChannelConnection::openChannel( quint32 channel, StreamConnection* sc )
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << channel << sc->id();
+
+    m_streams.insert( channel, sc );
+    sc->setChannel( this, channel );
+
+    connect( sc, SIGNAL( finished() ), SLOT( onStreamFinished() ) );
+}
+
+
+void
+StreamChannelConnection::sendControl( quint32 channel, const QByteArray& payload )
+{
+    enqueue( channel, Msg::factory( payload, Msg::RAW ) );
+}
+
+
+void
+StreamChannelConnection::sendChannelMsg( quint32 channel, msg_ptr msg )
+{
+    // a stream that is shutting down may still try to send something
+    if ( !m_streams.contains( channel ) )
+        return;
+
+    enqueue( channel, msg );
+}
+
+
+void
+StreamChannelConnection::enqueue( quint32 channel, msg_ptr msg )
+{
+    QByteArray frame;
+    frame.reserve( 4 + msg->payload().length() );
+    frame.append( (char)( channel >> 24 ) );
+    frame.append( (char)( channel >> 16 ) );
+    frame.append( (char)( channel >> 8 ) );
+    frame.append( (char)channel );
+    frame.append( msg->payload() );
+
+    if ( !m_channels.contains( channel ) )
+        m_schedule << channel;
+
+    Channel& ch = m_channels[ channel ];
+    ch.queue.enqueue( Msg::factory( frame, msg->flags() ) );
+    ch.bytes += frame.length();
+
+    sendSome();
+}
+
+
+qint64
+StreamChannelConnection::channelBytesPending( quint32 channel ) const
+{
+    return m_channels.value( channel ).bytes;
+}
+
+
+void
+StreamChannelConnection::sendSome()
+{
+    while ( isReady() && !m_schedule.isEmpty() && bytesPending() < SOCKET_WINDOW )
+    {
+        const quint32 channel = m_schedule.takeFirst();
+        Channel& ch = m_channels[ channel ];
+        ch.deficit += CHANNEL_QUANTUM;
+
+        bool sent = false;
+        while ( !ch.queue.isEmpty() && (qint64)ch.queue.head()->length() <= ch.deficit )
+        {
+            msg_ptr msg = ch.queue.dequeue();
+            ch.deficit -= msg->length();
+            ch.bytes -= msg->length();
+            sendMsg( msg );
+            sent = true;
+        }
+
+        if ( ch.queue.isEmpty() )
+            m_channels.remove( channel );
+        else
+            m_schedule << channel;
+
+        // make room for the stream to queue more
+        StreamConnection* sc = m_streams.value( channel ).data();
+        if ( sent && sc )
+            QMetaObject::invokeMethod( sc, "onBytesWritten", Qt::QueuedConnection );
+    }
+}
+
+
+void
+StreamChannelConnection::handleMsg( msg_ptr msg )
+{
+    const QByteArray& frame = msg->payload();
+    if ( frame.length() < 4 )
+    {
+        tLog() << Q_FUNC_INFO << "Invalid msg without channel, closing";
+        markAsFailed();
+        return;
+    }
+
+    const quint32 channel = ( (quint32)(uchar)frame.at( 0 ) << 24 ) | ( (quint32)(uchar)frame.at( 1 ) << 16 ) |
+                            ( (quint32)(uchar)frame.at( 2 ) << 8 ) | (quint32)(uchar)frame.at( 3 );
+    const QByteArray payload = frame.mid( 4 );
+
+    if ( payload.startsWith( "open" ) )
+    {
+        if ( m_streams.contains( channel ) )
+        {
+            tLog() << Q_FUNC_INFO << "Channel" << channel << "is open already";
+            return;
+        }
+
+        // the peer wants one of our files, same as a FILE_REQUEST_KEY connection would
+        StreamConnection* sc = new StreamConnection( servent(), m_cc.data(), QString::fromUtf8( payload.mid( 4 ) ) );
+        openChannel( channel, sc );
+        sc->setup();
+        return;
+    }
+
+    StreamConnection* sc = m_streams.value( channel ).data();
+    if ( !sc )
+    {
+        // we closed it already, the peer didn't know yet
+        return;
+    }
+
+    if ( payload == "close" )
+    {
+        m_streams.remove( channel );
+        m_channels.remove( channel );
+        m_schedule.removeAll( channel );
+
+        sc->shutdown();
+        return;
+    }
+
+    sc->channelMsg( Msg::factory( payload, msg->flags() ) );
+}
+
+
+void
+StreamChannelConnection::onStreamFinished()
+{
+    StreamConnection* sc = (StreamConnection*)sender();
+
+    QHash< quint32, QPointer< StreamConnection > >::iterator it = m_streams.begin();
+    for ( ; it != m_streams.end(); ++it )
+    {
+        if ( it.value().data() != sc )
+            continue;
+
+        // whatever it still had queued isn't wanted anymore
+        const quint32 channel = it.key();
+        m_streams.erase( it );
+        m_channels.remove( channel );
+        m_schedule.removeAll( channel );
+
+        if ( isReady() )
+            sendControl( channel, "close" );
+        break;
+    }
+}
+
+
+void
+StreamChannelConnection::onFinished()
+{
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Open streams:" << m_streams.count() << "waiting:" << m_waiting.count();
+    m_finished = true;
+
+    const QHash< quint32, QPointer< StreamConnection > > streams = m_streams;
+    m_streams.clear();
+    m_channels.clear();
+    m_schedule.clear();
+
+    foreach ( const QPointer< StreamConnection >& sc, streams )
+    {
+        if ( !sc.isNull() )
+            sc.data()->shutdown();
+    }
+
+    // We never got connected, let those streams get a connection of their own
+    const QList< QPointer< StreamConnection > > waiting = m_waiting;
+    m_waiting.clear();
+
+    foreach ( const QPointer< StreamConnection >& sc, waiting )
+    {
+        if ( !sc.isNull() )
+            fallback( sc.data() );
+    }
+}
+
+
+void
+StreamChannelConnection::fallback( StreamConnection* sc )
+{
+    if ( m_cc.isNull() )
+        sc->shutdown();
+    else
+        servent()->createParallelConnection( m_cc.data(), sc, QString( "FILE_REQUEST_KEY:%1" ).arg( sc->fid() ) );
+}
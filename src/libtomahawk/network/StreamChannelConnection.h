@@ -0,0 +1,108 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAMCHANNELCONNECTION_H
+#define STREAMCHANNELCONNECTION_H
+
+#include "network/Connection.h"
+
+#include "DllMacro.h"
+
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQueue>
+
+// Offer key of the connection streams run over, once both peers announced "stream-channels"
+#define STREAM_CHANNELS_KEY "STREAM_CHANNELS_KEY"
+
+class ControlConnection;
+class StreamConnection;
+
+/**
+ * Runs all streams between us and a peer over one connection instead of
+ * one connection per file.
+ *
+ * Every StreamConnection gets a numbered channel. Each msg on the wire is
+ * the channel number (4 bytes, big endian) followed by the msg the
+ * StreamConnection would have sent on its own connection, with the same
+ * flags. The side that made the connection opens channels with "open"
+ * followed by the file id, either side ends one with "close".
+ *
+ * Channels that have data queued take turns in deficit round robin, so
+ * concurrent transfers share the connection evenly, whatever msg size
+ * each of them negotiated.
+ */
+class DLLEXPORT StreamChannelConnection : public Connection
+{
+Q_OBJECT
+
+public:
+    explicit StreamChannelConnection( Servent* s, ControlConnection* cc );
+    virtual ~StreamChannelConnection();
+
+    Connection* clone();
+
+    /// Requests the file of receiving stream @p sc on a new channel
+    void addStream( StreamConnection* sc );
+
+    /// Queues @p msg of @p channel, it goes out when it's this channel's turn
+    void sendChannelMsg( quint32 channel, msg_ptr msg );
+    /// Bytes of @p channel that are queued but not handed to the socket yet
+    qint64 channelBytesPending( quint32 channel ) const;
+
+protected:
+    virtual void setup();
+
+protected slots:
+    virtual void handleMsg( msg_ptr msg );
+
+private slots:
+    void sendSome();
+    void onSetupTimeout();
+    void onStreamFinished();
+    void onFinished();
+
+private:
+    struct Channel
+    {
+        Channel() : bytes( 0 ), deficit( 0 ) {}
+
+        QQueue< msg_ptr > queue;
+        qint64 bytes;
+        qint64 deficit;
+    };
+
+    void openChannel( quint32 channel, StreamConnection* sc );
+    void sendControl( quint32 channel, const QByteArray& payload );
+    void enqueue( quint32 channel, msg_ptr msg );
+    /// Gives @p sc a connection of its own, as for peers without stream channels
+    void fallback( StreamConnection* sc );
+
+    QPointer< ControlConnection > m_cc;
+    quint32 m_nextChannel;
+    bool m_finished;
+
+    QHash< quint32, QPointer< StreamConnection > > m_streams;
+    // Streams added before we were connected
+    QList< QPointer< StreamConnection > > m_waiting;
+
+    QHash< quint32, Channel > m_channels;
+    // Channels with queued msgs, in the order they get their turn
+    QList< quint32 > m_schedule;
+};
+
+#endif // STREAMCHANNELCONNECTION_H
@@ -31,11 +31,20 @@
 #include "MsgProcessor.h"
 #include "Result.h"
 #include "SourceList.h"
+#include "StreamCache.h"
+#include "StreamChannelConnection.h"
+#include "TomahawkSettings.h"
 #include "UrlHandler.h"
 
 #include <QFile>
 #include <QTimer>
 
+// Largest data msg we send or accept, the receiver announces what it can handle
+#define MAX_CHUNK_SIZE ( 1024 * 1024 )
+// Keep between this many chunks queued for the socket
+#define LOW_WATERMARK_CHUNKS 1
+#define HIGH_WATERMARK_CHUNKS 4
+
 using namespace Tomahawk;
 
 
@@ -45,8 +54,16 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     , m_fid( fid )
     , m_type( RECEIVING )
     , m_curBlock( 0 )
+    , m_resumePending( false )
+    , m_startBlock( 0 )
+    , m_prefetchBlocks( 0 )
+    , m_channelId( 0 )
     , m_badded( 0 )
     , m_bsent( 0 )
+    , m_chunkSize( BufferIODevice::blockSize() )
+    , m_uploadRate( 0 )
+    , m_rateBytes( 0 )
+    , m_sendScheduled( false )
     , m_allok( false )
     , m_result( result )
     , m_transferRate( 0 )
@@ -78,8 +95,17 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     , m_cc( cc )
     , m_fid( fid )
     , m_type( SENDING )
+    , m_curBlock( 0 )
+    , m_resumePending( false )
+    , m_startBlock( 0 )
+    , m_prefetchBlocks( 0 )
+    , m_channelId( 0 )
     , m_badded( 0 )
     , m_bsent( 0 )
+    , m_chunkSize( BufferIODevice::blockSize() )
+    , m_uploadRate( 0 )
+    , m_rateBytes( 0 )
+    , m_sendScheduled( false )
     , m_allok( false )
     , m_transferRate( 0 )
 {
@@ -160,12 +186,27 @@ StreamConnection::setup()
     if ( m_type == RECEIVING )
     {
         qDebug() << "in RX mode";
+
+        // Peers keep sending single blocks unless we tell them we can handle more per msg
+        QByteArray sm;
+        sm.append( QString( "chunksize%1" ).arg( MAX_CHUNK_SIZE ) );
+        send( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+
+        // We may have the beginning of the file already, see StreamCache
+        m_resumePending = ( (BufferIODevice*)m_iodev.data() )->nextEmptyBlock() > 0;
+
         emit updated();
         return;
     }
 
     qDebug() << "in TX mode, fid:" << m_fid;
 
+    // Refill the send window whenever the socket drained some of it. On a channel, the
+    // StreamChannelConnection tells us when it's our turn again.
+    if ( m_channel.isNull() )
+        connect( socket().data(), SIGNAL( bytesWritten( qint64 ) ), SLOT( onBytesWritten() ), Qt::QueuedConnection );
+    m_uploadRate = (qint64)TomahawkSettings::instance()->streamUploadRate() * 1024;
+
     DatabaseCommand_LoadFiles* cmd = new DatabaseCommand_LoadFiles( m_fid.toUInt() );
     connect( cmd, SIGNAL( result( Tomahawk::result_ptr ) ), SLOT( startSending( Tomahawk::result_ptr ) ) );
     Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
@@ -207,6 +248,9 @@ StreamConnection::reallyStartSending( const Tomahawk::result_ptr result, const Q
     }
 
     m_readdev = QSharedPointer<QIODevice>( io );
+    if ( m_startBlock > 0 )
+        m_readdev->seek( (qint64)m_startBlock * BufferIODevice::blockSize() );
+
     sendSome();
 
     emit updated();
@@ -221,15 +265,30 @@ StreamConnection::handleMsg( msg_ptr msg )
     if ( msg->payload().startsWith( "block" ) )
     {
         int block = QString( msg->payload() ).mid( 5 ).toInt();
-        m_readdev->seek( block * BufferIODevice::blockSize() );
+        if ( m_readdev.isNull() )
+            m_startBlock = block;
+        else
+            m_readdev->seek( (qint64)block * BufferIODevice::blockSize() );
+
+        m_partialBlock.clear();
 
         qDebug() << "Seeked to block:" << block;
 
         QByteArray sm;
         sm.append( QString( "doneblock%1" ).arg( block ) );
 
-        sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
-        QTimer::singleShot( 0, this, SLOT( sendSome() ) );
+        send( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+        scheduleSend( 0 );
+    }
+    else if ( msg->payload().startsWith( "chunksize" ) )
+    {
+        // Only ever send whole blocks per msg, apart from the last one
+        const int blockSize = BufferIODevice::blockSize();
+        const int peerMax = QString( msg->payload() ).mid( 9 ).toInt();
+        const int chunkSize = qMin( (int)TomahawkSettings::instance()->streamChunkSize() * 1024, qMin( peerMax, MAX_CHUNK_SIZE ) );
+
+        m_chunkSize = qMax( blockSize, chunkSize - chunkSize % blockSize );
+        qDebug() << "Sending" << m_chunkSize << "bytes per msg";
     }
     else if ( msg->payload().startsWith( "doneblock" ) )
     {
@@ -241,8 +300,34 @@ StreamConnection::handleMsg( msg_ptr msg )
     }
     else if ( msg->payload().startsWith( "data" ) )
     {
-        m_badded += msg->payload().length() - 4;
-        ( (BufferIODevice*)m_iodev.data() )->addData( m_curBlock++, msg->payload().mid( 4 ) );
+        // a msg may carry several blocks, see chunksize
+        const int length = msg->payload().length() - 4;
+        const int blockSize = BufferIODevice::blockSize();
+
+        m_badded += length;
+        ( (BufferIODevice*)m_iodev.data() )->addData( m_curBlock, msg->payload().mid( 4 ) );
+        m_curBlock += ( length + blockSize - 1 ) / blockSize;
+
+        // Only now, older peers can't seek before they opened the file
+        if ( m_resumePending )
+        {
+            m_resumePending = false;
+
+            const int block = ( (BufferIODevice*)m_iodev.data() )->nextEmptyBlock();
+            if ( block > m_curBlock )
+                onBlockRequest( block );
+        }
+
+        const int nextEmpty = ( (BufferIODevice*)m_iodev.data() )->nextEmptyBlock();
+        if ( m_prefetchBlocks > 0 && nextEmpty >= m_prefetchBlocks )
+        {
+            tDebug( LOGVERBOSE ) << id() << "Prefetched" << nextEmpty << "blocks";
+            m_allok = true;
+            StreamCache::instance()->store( m_cacheKey, qSharedPointerCast< BufferIODevice >( m_iodev ), false );
+
+            shutdown();
+            return;
+        }
     }
 
     //qDebug() << Q_FUNC_INFO << "flags" << (int) msg->flags()
@@ -256,6 +341,9 @@ StreamConnection::handleMsg( msg_ptr msg )
         // tell our iodev there is no more data to read, no args meaning a success:
         ( (BufferIODevice*)m_iodev.data() )->inputComplete();
 
+        if ( !m_cacheKey.isEmpty() )
+            StreamCache::instance()->store( m_cacheKey, qSharedPointerCast< BufferIODevice >( m_iodev ), true );
+
         shutdown();
     }
 }
@@ -273,25 +361,133 @@ void
 StreamConnection::sendSome()
 {
     Q_ASSERT( m_type == StreamConnection::SENDING );
+    m_sendScheduled = false;
 
-    QByteArray ba = "data";
-    ba.append( m_readdev->read( BufferIODevice::blockSize() ) );
-    m_bsent += ba.length() - 4;
-
-    if ( m_readdev->atEnd() )
-    {
-        sendMsg( Msg::factory( ba, Msg::RAW ) );
+    if ( m_readdev.isNull() )
         return;
-    }
-    else
+
+    if ( m_uploadRate > 0 && m_rateTimer.isNull() )
+        m_rateTimer.start();
+
+    // Fill the send window up to the high watermark. Once the socket wrote enough of it
+    // to get below the low watermark, onBytesWritten() brings us back here.
+    while ( pendingBytes() < HIGH_WATERMARK_CHUNKS * m_chunkSize && ( !m_readdev->atEnd() || !m_partialBlock.isEmpty() ) )
     {
+        if ( m_uploadRate > 0 )
+        {
+            // allow a burst of one chunk, then wait until we're back on the configured rate
+            const qint64 allowed = m_rateTimer.elapsed() * m_uploadRate / 1000 + m_chunkSize;
+            if ( m_rateBytes >= allowed )
+            {
+                scheduleSend( qMax( (qint64)1, ( m_rateBytes - allowed ) * 1000 / m_uploadRate + 1 ) );
+                return;
+            }
+        }
+
+        // read straight behind the msg's "data" prefix, saves us another copy
+        QByteArray ba;
+        ba.resize( 4 + m_chunkSize );
+        memcpy( ba.data(), "data", 4 );
+
+        qint64 length = m_partialBlock.length();
+        memcpy( ba.data() + 4, m_partialBlock.constData(), length );
+        m_partialBlock.clear();
+
+        while ( length < m_chunkSize && !m_readdev->atEnd() )
+        {
+            const qint64 r = m_readdev->read( ba.data() + 4 + length, m_chunkSize - length );
+            if ( r <= 0 )
+                break;
+
+            length += r;
+        }
+
+        if ( !m_readdev->atEnd() )
+        {
+            // The receiver puts every msg at the start of a block, so after a short read
+            // the incomplete block has to wait for the next msg
+            const qint64 partial = length % BufferIODevice::blockSize();
+            m_partialBlock = QByteArray( ba.constData() + 4 + length - partial, partial );
+            length -= partial;
+        }
+
+        if ( length == 0 && !m_readdev->atEnd() )
+        {
+            // no data available right now, try again later
+            scheduleSend( 50 );
+            return;
+        }
+
+        ba.resize( 4 + length );
+        m_bsent += length;
+        m_rateBytes += length;
+
+        if ( m_readdev->atEnd() )
+        {
+            send( Msg::factory( ba, Msg::RAW ) );
+            return;
+        }
+
         // more to come -> FRAGMENT
-        sendMsg( Msg::factory( ba, Msg::RAW | Msg::FRAGMENT ) );
+        send( Msg::factory( ba, Msg::RAW | Msg::FRAGMENT ) );
     }
+}
+
+
+void
+StreamConnection::onBytesWritten()
+{
+    if ( m_readdev.isNull() || m_sendScheduled )
+        return;
+
+    if ( pendingBytes() <= LOW_WATERMARK_CHUNKS * m_chunkSize )
+        sendSome();
+}
+
+
+void
+StreamConnection::setChannel( StreamChannelConnection* channel, quint32 id )
+{
+    m_channel = channel;
+    m_channelId = id;
+}
+
+
+void
+StreamConnection::channelMsg( msg_ptr msg )
+{
+    handleMsg( msg );
+}
+
+
+void
+StreamConnection::send( msg_ptr msg )
+{
+    if ( m_channel.isNull() )
+        sendMsg( msg );
+    else
+        m_channel.data()->sendChannelMsg( m_channelId, msg );
+}
+
+
+qint64
+StreamConnection::pendingBytes() const
+{
+    if ( m_channel.isNull() )
+        return bytesPending();
+
+    return m_channel.data()->channelBytesPending( m_channelId );
+}
+
+
+void
+StreamConnection::scheduleSend( int msecs )
+{
+    if ( m_sendScheduled )
+        return;
 
-    // HINT: change the 0 to 50 to transmit at 640Kbps, for example
-    //       (this is where upload throttling could be implemented)
-    QTimer::singleShot( 0, this, SLOT( sendSome() ) );
+    m_sendScheduled = true;
+    QTimer::singleShot( msecs, this, SLOT( sendSome() ) );
 }
 
 
@@ -306,5 +502,5 @@ StreamConnection::onBlockRequest( int block )
     QByteArray sm;
     sm.append( QString( "block%1" ).arg( block ) );
 
-    sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+    send( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
 }
@@ -22,8 +22,10 @@
 #define STREAMCONNECTION_H
 
 #include <QObject>
+#include <QPointer>
 #include <QSharedPointer>
 #include <QIODevice>
+#include <QTime>
 
 #include "network/Connection.h"
 #include "Result.h"
@@ -32,6 +34,7 @@
 
 class ControlConnection;
 class BufferIODevice;
+class StreamChannelConnection;
 
 class DLLEXPORT StreamConnection : public Connection
 {
@@ -65,6 +68,23 @@ public:
     Type type() const { return m_type; }
     QString fid() const { return m_fid; }
 
+    /// Received files are kept in the StreamCache under @p key
+    void setCacheKey( const QString& key ) { m_cacheKey = key; }
+    /**
+     * Stop after the first @p blocks and cache them, instead of receiving the whole file.
+     * 0 turns a prefetch back into a normal stream.
+     */
+    void setPrefetchBlocks( int blocks ) { m_prefetchBlocks = blocks; }
+    bool isPrefetching() const { return m_prefetchBlocks > 0; }
+
+    /**
+     * Run as channel @p id of @p channel instead of on a connection of our own.
+     * Call before setup(), we never get a socket then.
+     */
+    void setChannel( StreamChannelConnection* channel, quint32 id );
+    /// A msg that arrived on our channel
+    void channelMsg( msg_ptr msg );
+
 signals:
     void updated();
 
@@ -75,11 +95,16 @@ private slots:
     void startSending( const Tomahawk::result_ptr& result );
     void reallyStartSending( const Tomahawk::result_ptr result, const QString url, QSharedPointer< QIODevice > io ); //only called back from startSending
     void sendSome();
+    void onBytesWritten();
     void showStats( qint64 tx, qint64 rx );
 
     void onBlockRequest( int pos );
 
 private:
+    void scheduleSend( int msecs );
+    void send( msg_ptr msg );
+    qint64 pendingBytes() const;
+
     QSharedPointer<QIODevice> m_iodev;
     ControlConnection* m_cc;
     QString m_fid;
@@ -87,8 +112,26 @@ private:
     QSharedPointer<QIODevice> m_readdev;
 
     int m_curBlock;
+    // RX: ask for the first block we don't have once the peer started sending
+    bool m_resumePending;
+    // TX: where to start once we have the file open
+    int m_startBlock;
+
+    QString m_cacheKey;
+    int m_prefetchBlocks;
+
+    QPointer< StreamChannelConnection > m_channel;
+    quint32 m_channelId;
 
     int m_badded, m_bsent;
+
+    // TX flow control
+    int m_chunkSize;
+    QByteArray m_partialBlock; // read but not sent yet, msgs carry whole blocks until the end
+    qint64 m_uploadRate; // bytes/sec, 0 means unlimited
+    QTime m_rateTimer;
+    qint64 m_rateBytes;
+    bool m_sendScheduled;
     bool m_allok; // got last msg ok, transfer complete?
 
     Tomahawk::source_ptr m_source;
@@ -166,6 +166,9 @@ PlayableItem::onResultsChanged()
     else
         m_result = result_ptr();
 
+    // query()->track() follows the best result, so the filter text may have changed
+    m_searchKey.clear();
+
     emit dataChanged();
 }
 
@@ -227,6 +230,50 @@ PlayableItem::albumName() const
 }
 
 
+const QString&
+PlayableItem::searchKey() const
+{
+    if ( m_searchKey.isEmpty() )
+    {
+        // Fields are joined with a character no filter term can contain,
+        // so a term never matches across two of them
+        const QChar sep( 0 );
+        if ( m_query )
+        {
+            const track_ptr& track = m_query->track();
+            m_searchKey = searchNormalized( track->artist() + sep + track->album() + sep + track->track() );
+        }
+        else if ( m_album )
+        {
+            m_searchKey = searchNormalized( m_album->name() + sep + ( m_album->artist() ? m_album->artist()->name() : QString() ) );
+        }
+        else if ( m_artist )
+        {
+            m_searchKey = searchNormalized( m_artist->name() );
+        }
+    }
+
+    return m_searchKey;
+}
+
+
+QString
+PlayableItem::searchNormalized( const QString& text )
+{
+    const QString decomposed = text.normalized( QString::NormalizationForm_KD );
+
+    QString s;
+    s.reserve( decomposed.length() );
+    foreach ( const QChar& c, decomposed )
+    {
+        if ( c.category() != QChar::Mark_NonSpacing )
+            s += c;
+    }
+
+    return s.toCaseFolded();
+}
+
+
 const Tomahawk::result_ptr&
 PlayableItem::result() const
 {
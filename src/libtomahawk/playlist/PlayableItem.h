@@ -66,6 +66,10 @@ public:
     QString artistName() const;
     QString albumName() const;
 
+    // Case folded, accent stripped text the proxy models' name filter matches against
+    const QString& searchKey() const;
+    static QString searchNormalized( const QString& text );
+
     QList<PlayableItem*> children;
 
     QPersistentModelIndex index;
@@ -91,6 +95,7 @@ private:
     bool m_isPlaying = false;
 
     Tomahawk::PlaybackLog m_playbackLog;
+    mutable QString m_searchKey;
 };
 
 #endif // PLAYABLEITEM_H
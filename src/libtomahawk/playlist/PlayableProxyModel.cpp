@@ -125,8 +125,14 @@ PlayableProxyModel::setSourcePlayableModel( PlayableModel* sourceModel )
         disconnect( m_model, SIGNAL( currentIndexChanged( QModelIndex, QModelIndex ) ), this, SLOT( onCurrentIndexChanged( QModelIndex, QModelIndex ) ) );
         disconnect( m_model, SIGNAL( expandRequest( QPersistentModelIndex ) ), this, SLOT( expandRequested( QPersistentModelIndex ) ) );
         disconnect( m_model, SIGNAL( selectRequest( QPersistentModelIndex ) ), this, SLOT( selectRequested( QPersistentModelIndex ) ) );
+        disconnect( m_model, SIGNAL( rowsInserted( QModelIndex, int, int ) ), this, SLOT( onSourceRowsInserted( QModelIndex, int, int ) ) );
+        disconnect( m_model, SIGNAL( rowsAboutToBeRemoved( QModelIndex, int, int ) ), this, SLOT( onSourceRowsAboutToBeRemoved( QModelIndex, int, int ) ) );
+        disconnect( m_model, SIGNAL( modelReset() ), this, SLOT( onSourceModelReset() ) );
+        disconnect( m_model, SIGNAL( dataChanged( QModelIndex, QModelIndex ) ), this, SLOT( onSourceDataChanged( QModelIndex, QModelIndex ) ) );
     }
 
+    m_dupeIndex.clear();
+    m_filterRejected.clear();
     m_model = sourceModel;
     if ( m_model )
     {
@@ -138,6 +144,13 @@ PlayableProxyModel::setSourcePlayableModel( PlayableModel* sourceModel )
         connect( m_model, SIGNAL( currentIndexChanged( QModelIndex, QModelIndex ) ), SLOT( onCurrentIndexChanged( QModelIndex, QModelIndex ) ) );
         connect( m_model, SIGNAL( expandRequest( QPersistentModelIndex ) ), SLOT( expandRequested( QPersistentModelIndex ) ) );
         connect( m_model, SIGNAL( selectRequest( QPersistentModelIndex ) ), SLOT( selectRequested( QPersistentModelIndex ) ) );
+
+        // Connected before QSortFilterProxyModel's own handlers, so the dupe index and
+        // the filter rejections are already current when the rows get (re-)filtered.
+        connect( m_model, SIGNAL( rowsInserted( QModelIndex, int, int ) ), SLOT( onSourceRowsInserted( QModelIndex, int, int ) ) );
+        connect( m_model, SIGNAL( rowsAboutToBeRemoved( QModelIndex, int, int ) ), SLOT( onSourceRowsAboutToBeRemoved( QModelIndex, int, int ) ) );
+        connect( m_model, SIGNAL( modelReset() ), SLOT( onSourceModelReset() ) );
+        connect( m_model, SIGNAL( dataChanged( QModelIndex, QModelIndex ) ), SLOT( onSourceDataChanged( QModelIndex, QModelIndex ) ) );
     }
 
     QSortFilterProxyModel::setSourceModel( m_model );
@@ -175,21 +188,160 @@ PlayableProxyModel::dupeFilterAcceptsRow( int sourceRow, PlayableItem* pi, const
     if ( !m_hideDupeItems )
         return true;
 
-    for ( int i = 0; i < sourceRow; i++ )
+    QHash< const PlayableItem*, bool >::const_iterator it = memo.dupeAccepted.constFind( pi );
+    if ( it != memo.dupeAccepted.constEnd() )
+        return it.value();
+
+    // Only the items sharing pi's key can hide it, so there is no need to walk all earlier rows.
+    bool accepted = true;
+    foreach ( PlayableItem* di, dupeCandidates( pi ) )
     {
-        PlayableItem* di = itemFromIndex( sourceModel()->index( i, 0, sourceParent ) );
-        if ( !di )
+        const int row = di->index.row();
+        if ( di == pi || row < 0 || row >= sourceRow )
             continue;
 
-        bool b = ( pi->query() && pi->query()->equals( di->query() ) ) ||
-                 ( pi->album() && pi->album() == di->album() ) ||
-                 ( pi->artist() && pi->artist()->name() == di->artist()->name() );
+        if ( filterAcceptsRowInternal( row, di, sourceParent, memo ) )
+        {
+            accepted = false;
+            break;
+        }
+    }
 
-        if ( b && filterAcceptsRowInternal( i, di, sourceParent, memo ) )
-            return false;
+    memo.dupeAccepted.insert( pi, accepted );
+    return accepted;
+}
+
+
+static QString
+dupeKey( const PlayableItem* item )
+{
+    if ( item->query() )
+    {
+        const Tomahawk::track_ptr track = item->query()->queryTrack();
+        return QString( "q" ) + track->artist() + QChar( 0 ) + track->album() + QChar( 0 ) + track->track();
     }
+    if ( item->album() )
+        return QString( "b%1" ).arg( (quintptr)item->album().data() );
+    if ( item->artist() )
+        return QString( "a" ) + item->artist()->name();
 
-    return true;
+    return QString();
+}
+
+
+QList< PlayableItem* >
+PlayableProxyModel::dupeCandidates( PlayableItem* pi ) const
+{
+    const PlayableItem* parent = pi->parent();
+    const QString key = dupeKey( pi );
+    if ( !parent || key.isEmpty() )
+        return QList< PlayableItem* >();
+
+    if ( !m_dupeIndex.contains( parent ) )
+    {
+        QHash< QString, QList< PlayableItem* > >& index = m_dupeIndex[ parent ];
+        foreach ( PlayableItem* item, parent->children )
+        {
+            const QString k = dupeKey( item );
+            if ( !k.isEmpty() )
+                index[ k ] << item;
+        }
+    }
+
+    return m_dupeIndex.value( parent ).value( key );
+}
+
+
+void
+PlayableProxyModel::unindexDupeItem( PlayableItem* item )
+{
+    if ( m_dupeIndex.isEmpty() )
+        return;
+
+    // The item's own children go away with it
+    m_dupeIndex.remove( item );
+    foreach ( PlayableItem* child, item->children )
+    {
+        if ( !child->children.isEmpty() )
+            unindexDupeItem( child );
+    }
+
+    QHash< const PlayableItem*, QHash< QString, QList< PlayableItem* > > >::iterator it = m_dupeIndex.find( item->parent() );
+    if ( it == m_dupeIndex.end() )
+        return;
+
+    const QString key = dupeKey( item );
+    QHash< QString, QList< PlayableItem* > >::iterator kit = it.value().find( key );
+    if ( kit == it.value().end() )
+        return;
+
+    kit.value().removeOne( item );
+    if ( kit.value().isEmpty() )
+        it.value().erase( kit );
+}
+
+
+void
+PlayableProxyModel::onSourceRowsInserted( const QModelIndex& parent, int start, int end )
+{
+    PlayableItem* parentItem = itemFromIndex( parent );
+    if ( !parentItem )
+        return;
+
+    // Parents that have not been indexed yet get indexed in full on first use
+    QHash< const PlayableItem*, QHash< QString, QList< PlayableItem* > > >::iterator it = m_dupeIndex.find( parentItem );
+    if ( it == m_dupeIndex.end() )
+        return;
+
+    for ( int i = start; i <= end && i < parentItem->children.count(); i++ )
+    {
+        PlayableItem* item = parentItem->children.at( i );
+        const QString key = dupeKey( item );
+        if ( !key.isEmpty() )
+            it.value()[ key ] << item;
+    }
+}
+
+
+void
+PlayableProxyModel::onSourceRowsAboutToBeRemoved( const QModelIndex& parent, int start, int end )
+{
+    PlayableItem* parentItem = itemFromIndex( parent );
+    if ( !parentItem )
+        return;
+
+    QList< PlayableItem* > items;
+    for ( int i = start; i <= end && i < parentItem->children.count(); i++ )
+    {
+        unindexDupeItem( parentItem->children.at( i ) );
+        items << parentItem->children.at( i );
+    }
+
+    if ( !items.isEmpty() )
+        emit itemsAboutToBeRemoved( items );
+
+    // Deleted items' addresses may be reused by new ones
+    m_filterRejected.clear();
+}
+
+
+void
+PlayableProxyModel::onSourceModelReset()
+{
+    m_dupeIndex.clear();
+    m_filterRejected.clear();
+}
+
+
+void
+PlayableProxyModel::onSourceDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight )
+{
+    if ( m_filterRejected.isEmpty() )
+        return;
+
+    // A resolved query may now match, so it has to be checked again
+    for ( int i = topLeft.row(); i <= bottomRight.row(); i++ )
+        m_filterRejected.remove( itemFromIndex( sourceModel()->index( i, 0, topLeft.parent() ) ) );
 }
 
 
@@ -242,58 +394,74 @@ PlayableProxyModel::nameFilterAcceptsRow( int sourceRow, PlayableItem* pi, const
 
         if ( !m_showOfflineResults && ( r.isNull() || !r->isOnline() ) )
             return false;
+    }
+    else if ( !pi->album() && !pi->artist() )
+        return true;
 
-        const QRegExp regexp = filterRegExp();
-        if ( regexp.isEmpty() )
-            return true;
+    return textFilterAcceptsItem( pi );
+}
+
+
+bool
+PlayableProxyModel::textFilterAcceptsItem( const PlayableItem* pi ) const
+{
+    updateFilterTerms( filterRegExp().pattern() );
+    if ( m_filterTerms.isEmpty() )
+        return true;
 
-        QStringList sl = regexp.pattern().split( " ", QString::SkipEmptyParts );
-        foreach( const QString& s, sl )
+    if ( m_filterRejected.contains( pi ) )
+        return false;
+
+    const QString& key = pi->searchKey();
+    foreach ( const QString& term, m_filterTerms )
+    {
+        if ( !key.contains( term ) )
         {
-            const Tomahawk::track_ptr& track = query->track();
-            if ( !track->artist().contains( s, Qt::CaseInsensitive ) &&
-                 !track->album().contains( s, Qt::CaseInsensitive ) &&
-                 !track->track().contains( s, Qt::CaseInsensitive ) )
-            {
-                return false;
-            }
+            m_filterRejected.insert( pi );
+            return false;
         }
     }
 
-    const Tomahawk::album_ptr& al = pi->album();
-    if ( al )
-    {
-        QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
+    return true;
+}
 
-        foreach( const QString& s, sl )
-        {
-            if ( !al->name().contains( s, Qt::CaseInsensitive ) &&
-                 !al->artist()->name().contains( s, Qt::CaseInsensitive ) )
-            {
-                return false;
-            }
-        }
 
-        return true;
-    }
+void
+PlayableProxyModel::updateFilterTerms( const QString& pattern ) const
+{
+    if ( pattern == m_filterPattern )
+        return;
 
-    const Tomahawk::artist_ptr& ar = pi->artist();
-    if ( ar )
-    {
-        QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
+    QStringList terms;
+    foreach ( const QString& s, pattern.split( " ", QString::SkipEmptyParts ) )
+        terms << PlayableItem::searchNormalized( s );
 
-        foreach( const QString& s, sl )
+    // If every old term is part of a new one, whatever got rejected before is still rejected
+    bool narrowing = !m_filterTerms.isEmpty();
+    foreach ( const QString& oldTerm, m_filterTerms )
+    {
+        bool covered = false;
+        foreach ( const QString& term, terms )
         {
-            if ( !ar->name().contains( s, Qt::CaseInsensitive ) )
+            if ( term.contains( oldTerm ) )
             {
-                return false;
+                covered = true;
+                break;
             }
         }
 
-        return true;
+        if ( !covered )
+        {
+            narrowing = false;
+            break;
+        }
     }
 
-    return true;
+    if ( !narrowing )
+        m_filterRejected.clear();
+
+    m_filterPattern = pattern;
+    m_filterTerms = terms;
 }
 
 
@@ -355,6 +523,7 @@ void
 PlayableProxyModel::setHideDupeItems( bool b )
 {
     m_hideDupeItems = b;
+    m_dupeIndex.clear();
     invalidateFilter();
 }
 
@@ -698,15 +867,15 @@ PlayableProxyModel::updateDetailedInfo( const QModelIndex& index )
 
     if ( item->album() )
     {
-        item->album()->cover( QSize( 0, 0 ) );
+        item->album()->loadCover( true );
     }
     else if ( item->artist() )
     {
-        item->artist()->cover( QSize( 0, 0 ) );
+        item->artist()->loadCover( true );
     }
     else if ( item->query() )
     {
-        item->query()->track()->cover( QSize( 0, 0 ) );
+        item->query()->track()->loadCover( true );
 
 /*        if ( style() == PlayableProxyModel::Fancy )
         {
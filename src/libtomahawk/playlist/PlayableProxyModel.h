@@ -21,6 +21,8 @@
 #define TRACKPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QSet>
+#include <QStringList>
 
 #include "PlaylistInterface.h"
 #include "playlist/PlayableModel.h"
@@ -39,6 +41,7 @@ public:
 
     virtual ~PlayableProxyModelFilterMemo() {}
     std::vector<int> visibilty;
+    QHash< const PlayableItem*, bool > dupeAccepted;
 };
 
 class DLLEXPORT PlayableProxyModel : public QSortFilterProxyModel
@@ -112,6 +115,8 @@ signals:
     void currentIndexChanged( const QModelIndex& newIndex, const QModelIndex& oldIndex );
 
     void itemCountChanged( unsigned int items );
+    /// Items about to be deleted by the source model, including hidden and nested ones
+    void itemsAboutToBeRemoved( const QList< PlayableItem* >& items );
 
     void expandRequest( const QPersistentModelIndex& index );
     void selectRequest( const QPersistentModelIndex& index );
@@ -130,12 +135,22 @@ private slots:
     void selectRequested( const QPersistentModelIndex& index );
     void onCurrentIndexChanged( const QModelIndex& newIndex, const QModelIndex& oldIndex );
 
+    void onSourceRowsInserted( const QModelIndex& parent, int start, int end );
+    void onSourceRowsAboutToBeRemoved( const QModelIndex& parent, int start, int end );
+    void onSourceModelReset();
+    void onSourceDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight );
+
 private:
     bool filterAcceptsRowInternal( int sourceRow, PlayableItem* pi, const QModelIndex& sourceParent, PlayableProxyModelFilterMemo& memo ) const;
     bool nameFilterAcceptsRow( int sourceRow, PlayableItem* pi, const QModelIndex& sourceParent ) const;
+    bool textFilterAcceptsItem( const PlayableItem* pi ) const;
+    void updateFilterTerms( const QString& pattern ) const;
     bool dupeFilterAcceptsRow( int sourceRow, PlayableItem* pi, const QModelIndex& sourceParent, PlayableProxyModelFilterMemo& memo ) const;
     bool visibilityFilterAcceptsRow( int sourceRow, const QModelIndex& sourceParent, PlayableProxyModelFilterMemo& memo ) const;
 
+    QList< PlayableItem* > dupeCandidates( PlayableItem* pi ) const;
+    void unindexDupeItem( PlayableItem* item );
+
     bool lessThan( int column, const Tomahawk::query_ptr& left, const Tomahawk::query_ptr& right ) const;
     bool lessThan( const Tomahawk::album_ptr& album1, const Tomahawk::album_ptr& album2 ) const;
 
@@ -146,6 +161,16 @@ private:
     bool m_hideDupeItems;
     int m_maxVisibleItems;
 
+    // parent item -> dupe key -> its children carrying that key. Built lazily per parent
+    // by the dupe filter and kept up to date as the source model inserts / removes rows.
+    mutable QHash< const PlayableItem*, QHash< QString, QList< PlayableItem* > > > m_dupeIndex;
+
+    // Normalized terms of the current filter pattern, and the items they rejected.
+    // The rejections are kept while the pattern only gets narrower.
+    mutable QString m_filterPattern;
+    mutable QStringList m_filterTerms;
+    mutable QSet< const PlayableItem* > m_filterRejected;
+
     QHash< PlayableItemStyle, QList<PlayableModel::Columns> > m_headerStyle;
     PlayableItemStyle m_style;
 };
@@ -28,6 +28,11 @@
 #include "Query.h"
 #include "Result.h"
 #include "Source.h"
+#include "TomahawkSettings.h"
+#include "Track.h"
+
+// Random picks tried before looking through the whole round for a playable track
+#define SHUFFLE_PICK_ATTEMPTS 32
 
 using namespace Tomahawk;
 
@@ -37,11 +42,21 @@ PlayableProxyModelPlaylistInterface::PlayableProxyModelPlaylistInterface( Playab
     , m_proxyModel( proxyModel )
     , m_repeatMode( PlaylistModes::NoRepeat )
     , m_shuffled( false )
+    , m_shuffleEngineFilled( false )
+    , m_smartShuffle( TomahawkSettings::instance()->smartShuffle() )
 {
     connect( proxyModel, SIGNAL( indexPlayable( QModelIndex ) ), SLOT( onItemsChanged() ) );
     connect( proxyModel, SIGNAL( filterChanged( QString ) ), SLOT( onItemsChanged() ) );
     connect( proxyModel, SIGNAL( itemCountChanged( unsigned int ) ), SLOT( onItemsChanged() ) );
     connect( proxyModel, SIGNAL( currentIndexChanged( QModelIndex, QModelIndex ) ), SLOT( onCurrentIndexChanged() ) );
+
+    connect( proxyModel, SIGNAL( rowsInserted( QModelIndex, int, int ) ), SLOT( onRowsInserted( QModelIndex, int, int ) ) );
+    connect( proxyModel, SIGNAL( rowsAboutToBeRemoved( QModelIndex, int, int ) ), SLOT( onRowsAboutToBeRemoved( QModelIndex, int, int ) ) );
+    connect( proxyModel, SIGNAL( modelReset() ), SLOT( onModelReset() ) );
+    connect( proxyModel, SIGNAL( itemsAboutToBeRemoved( QList< PlayableItem* > ) ), SLOT( onItemsAboutToBeRemoved( QList< PlayableItem* > ) ) );
+    connect( proxyModel, SIGNAL( filterChanged( QString ) ), SLOT( resetShuffleEngine() ) );
+
+    connect( TomahawkSettings::instance(), SIGNAL( changed() ), SLOT( onSettingsChanged() ) );
 }
 
 
@@ -104,6 +119,7 @@ PlayableProxyModelPlaylistInterface::setCurrentIndex( qint64 index )
 
     if ( m_currentIndex == index )
         return;
+    const qint64 previousIndex = m_currentIndex;
     m_currentIndex = index; // we need to manually set m_currentIndex (protected member from PlaylistInterface) here
                             // because calling m_proxyModel.data()->setCurrentIndex( ... ) will end up emitting a
                             // signal which leads right back here and would cause an infinite loop.
@@ -121,11 +137,23 @@ PlayableProxyModelPlaylistInterface::setCurrentIndex( qint64 index )
                 // The upcoming track will be added right back to the history further down below in this method.
                 m_shuffleHistory.removeLast();
                 m_shuffleHistory.removeLast();
+
+                // Likewise the track we're leaving may come up again in this round
+                if ( previousIndex > 0 )
+                    m_shuffleEngine.unmarkPlayed( previousIndex );
             }
         }
 
         m_proxyModel.data()->setCurrentIndex( m_proxyModel.data()->mapFromSource( item->index ) );
         m_shuffleHistory << queryAt( index );
+
+        // Only top-level rows take part in shuffling. Played items keep their weight
+        // for the next round, so it has to be known already.
+        if ( !item->index.parent().isValid() )
+        {
+            m_shuffleEngine.insert( index, shuffleWeight( item ) );
+            m_shuffleEngine.markPlayed( index );
+        }
         m_shuffleCache = QPersistentModelIndex();
     }
 
@@ -172,22 +200,13 @@ PlayableProxyModelPlaylistInterface::siblingIndex( int itemsAway, qint64 rootInd
                 }
                 else
                 {
-                    int safetyCounter = 0;
-                    PlayableItem* item = 0;
-                    do
-                    {
-                        safetyCounter++;
-                        idx = proxyModel->index( qrand() % proxyModel->rowCount(), 0 );
-                        item = proxyModel->itemFromIndex( proxyModel->mapToSource( idx ) );
-                    }
-                    while ( safetyCounter < proxyModel->rowCount() &&
-                          ( !item || !item->query() || !item->query()->playable() || m_shuffleHistory.contains( item->query() ) ) );
-
-                    if ( item && item->query() && item->query()->playable() )
+                    PlayableItem* item = nextShuffledItem();
+                    if ( item )
                     {
+                        idx = proxyModel->mapFromSource( item->index );
                         m_shuffleCache = idx;
                         tDebug( LOGVERBOSE ) << "Next shuffled PlaylistItem cached:" << item->query()->toString() << item->query()->results().at( 0 )->url()
-                                             << "- after" << safetyCounter << "tries to find a track";
+                                             << "-" << m_shuffleEngine.remaining() << "tracks left in this round";
                     }
                     else
                     {
@@ -253,6 +272,165 @@ PlayableProxyModelPlaylistInterface::siblingIndex( int itemsAway, qint64 rootInd
 }
 
 
+PlayableItem*
+PlayableProxyModelPlaylistInterface::nextShuffledItem() const
+{
+    PlayableProxyModel* proxyModel = m_proxyModel.data();
+    fillShuffleEngine();
+
+    // Once every track had its turn, start over with all of them
+    for ( int round = 0; round < 2; round++ )
+    {
+        for ( int i = 0; i < SHUFFLE_PICK_ATTEMPTS && m_shuffleEngine.remaining(); i++ )
+        {
+            PlayableItem* item = reinterpret_cast<PlayableItem*>( (void*)m_shuffleEngine.pick() );
+            if ( !proxyModel->mapFromSource( item->index ).isValid() )
+            {
+                // Filtered out by now, it comes back with the rows it gets shown in
+                m_shuffleEngine.remove( (qint64)item );
+                continue;
+            }
+
+            if ( item->query() && item->query()->playable() )
+                return item;
+        }
+
+        // Mostly unplayable tracks left, look at all of them once instead of guessing
+        for ( int i = 0; i < proxyModel->rowCount() && m_shuffleEngine.remaining(); i++ )
+        {
+            PlayableItem* item = proxyModel->itemFromIndex( proxyModel->mapToSource( proxyModel->index( i, 0 ) ) );
+            if ( item && m_shuffleEngine.contains( (qint64)item ) && item->query() && item->query()->playable() )
+                return item;
+        }
+
+        m_shuffleEngine.newRound();
+        // The current track isn't up next again
+        if ( m_currentIndex > 0 )
+            m_shuffleEngine.markPlayed( m_currentIndex );
+    }
+
+    return 0;
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::fillShuffleEngine() const
+{
+    if ( m_shuffleEngineFilled )
+        return;
+
+    PlayableProxyModel* proxyModel = m_proxyModel.data();
+    for ( int i = 0; i < proxyModel->rowCount(); i++ )
+    {
+        PlayableItem* item = proxyModel->itemFromIndex( proxyModel->mapToSource( proxyModel->index( i, 0 ) ) );
+        if ( item )
+            m_shuffleEngine.insert( (qint64)item, shuffleWeight( item ) );
+    }
+
+    m_shuffleEngineFilled = true;
+}
+
+
+double
+PlayableProxyModelPlaylistInterface::shuffleWeight( PlayableItem* item ) const
+{
+    if ( !m_smartShuffle || !item->query() )
+        return 1.0;
+
+    // Only looks at the already loaded playback history, a track played n times is 1 / (n + 1) as likely
+    return 1.0 / ( 1 + item->query()->track()->playbackCount() );
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::setSmartShuffle( bool enabled )
+{
+    if ( m_smartShuffle == enabled )
+        return;
+
+    m_smartShuffle = enabled;
+    resetShuffleEngine();
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::onSettingsChanged()
+{
+    setSmartShuffle( TomahawkSettings::instance()->smartShuffle() );
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::resetShuffleEngine()
+{
+    // Refilled on the next pick, from what is visible then. Played tracks stay played,
+    // hidden ones too, they are forgotten only once the source model deletes them.
+    const QList< qint64 > played = m_shuffleEngine.playedItems();
+
+    m_shuffleEngine.clear();
+    foreach ( qint64 index, played )
+    {
+        // with the weight of the current mode for the next round
+        m_shuffleEngine.insert( index, shuffleWeight( reinterpret_cast<PlayableItem*>( (void*)index ) ) );
+        m_shuffleEngine.markPlayed( index );
+    }
+
+    m_shuffleEngineFilled = false;
+    m_shuffleCache = QPersistentModelIndex();
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::onRowsInserted( const QModelIndex& parent, int start, int end )
+{
+    if ( parent.isValid() || !m_shuffleEngineFilled )
+        return;
+
+    PlayableProxyModel* proxyModel = m_proxyModel.data();
+    for ( int i = start; i <= end; i++ )
+    {
+        PlayableItem* item = proxyModel->itemFromIndex( proxyModel->mapToSource( proxyModel->index( i, 0 ) ) );
+        if ( item )
+            m_shuffleEngine.insert( (qint64)item, shuffleWeight( item ) );
+    }
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::onRowsAboutToBeRemoved( const QModelIndex& parent, int start, int end )
+{
+    if ( parent.isValid() )
+        return;
+
+    // Rows may just get filtered out, played ones stay played. Deleted items are
+    // taken care of by onItemsAboutToBeRemoved().
+    PlayableProxyModel* proxyModel = m_proxyModel.data();
+    for ( int i = start; i <= end; i++ )
+    {
+        PlayableItem* item = proxyModel->itemFromIndex( proxyModel->mapToSource( proxyModel->index( i, 0 ) ) );
+        if ( item && !m_shuffleEngine.wasPlayed( (qint64)item ) )
+            m_shuffleEngine.remove( (qint64)item );
+    }
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::onItemsAboutToBeRemoved( const QList< PlayableItem* >& items )
+{
+    // Also forgets whether they were played, the items are about to be deleted
+    foreach ( PlayableItem* item, items )
+        m_shuffleEngine.remove( (qint64)item );
+}
+
+
+void
+PlayableProxyModelPlaylistInterface::onModelReset()
+{
+    m_shuffleEngine.clear();
+    m_shuffleEngineFilled = false;
+}
+
+
 Tomahawk::result_ptr
 PlayableProxyModelPlaylistInterface::currentItem() const
 {
@@ -22,6 +22,7 @@
 
 #include "PlaylistInterface.h"
 #include "playlist/PlayableModel.h"
+#include "playlist/ShuffleEngine.h"
 
 #include "DllMacro.h"
 
@@ -58,6 +59,10 @@ public:
     virtual PlaylistModes::RepeatMode repeatMode() const { return m_repeatMode; }
     virtual bool shuffled() const { return m_shuffled; }
 
+    /// Favours tracks that have been played less often when shuffling, see TomahawkSettings::smartShuffle()
+    bool smartShuffle() const { return m_smartShuffle; }
+    void setSmartShuffle( bool enabled );
+
 public slots:
     virtual void setRepeatMode( Tomahawk::PlaylistModes::RepeatMode mode ) { m_repeatMode = mode; emit repeatModeChanged( mode ); }
     virtual void setShuffled( bool enabled ) { m_shuffled = enabled; emit shuffleModeChanged( enabled ); }
@@ -65,6 +70,18 @@ public slots:
 private slots:
     void onCurrentIndexChanged();
 
+    void onRowsInserted( const QModelIndex& parent, int start, int end );
+    void onRowsAboutToBeRemoved( const QModelIndex& parent, int start, int end );
+    void onModelReset();
+    void onItemsAboutToBeRemoved( const QList< PlayableItem* >& items );
+    void onSettingsChanged();
+    void resetShuffleEngine();
+
+private:
+    PlayableItem* nextShuffledItem() const;
+    void fillShuffleEngine() const;
+    double shuffleWeight( PlayableItem* item ) const;
+
 protected:
     QPointer< PlayableProxyModel > m_proxyModel;
 
@@ -72,6 +89,11 @@ protected:
     bool m_shuffled;
     mutable QList< Tomahawk::query_ptr > m_shuffleHistory;
     mutable QPersistentModelIndex m_shuffleCache;
+
+    // Tracks of the playlist not played yet in this shuffle round, filled on first use
+    mutable ShuffleEngine m_shuffleEngine;
+    mutable bool m_shuffleEngineFilled;
+    bool m_smartShuffle;
 };
 
 } //ns
@@ -0,0 +1,222 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ShuffleEngine.h"
+
+#include <QtGlobal>
+
+using namespace Tomahawk;
+
+
+static quint64
+randomNumber()
+{
+    // qrand() may only have 15 bits of randomness (RAND_MAX 32767), so we put 60 bits
+    // together from four of those. Weighted picks use the lower 53 of them.
+    quint64 value = 0;
+    for ( int i = 0; i < 4; i++ )
+        value = ( value << 15 ) | (quint64)( qrand() & 0x7fff );
+
+    return value;
+}
+
+
+ShuffleEngine::ShuffleEngine()
+    : m_uniform( true )
+    , m_totalWeight( 0 )
+{
+}
+
+
+void
+ShuffleEngine::clear()
+{
+    m_items.clear();
+    m_weights.clear();
+    m_slots.clear();
+    m_played.clear();
+    m_uniform = true;
+    m_tree.clear();
+    m_totalWeight = 0;
+}
+
+
+void
+ShuffleEngine::insert( qint64 item, double weight )
+{
+    if ( m_slots.contains( item ) || m_played.contains( item ) )
+        return;
+
+    if ( weight <= 0 )
+        weight = 0;
+
+    const int slot = m_items.count();
+    m_items << item;
+    m_weights << weight;
+    m_slots.insert( item, slot );
+
+    if ( m_uniform && weight != 1.0 )
+    {
+        m_uniform = false;
+        rebuildTree( m_items.count() * 2 );
+    }
+    else if ( !m_uniform )
+    {
+        if ( m_items.count() >= m_tree.count() )
+            rebuildTree( m_items.count() * 2 );
+        else
+            treeAdd( slot, weight );
+    }
+}
+
+
+void
+ShuffleEngine::remove( qint64 item )
+{
+    m_played.remove( item );
+
+    QHash< qint64, int >::iterator it = m_slots.find( item );
+    if ( it != m_slots.end() )
+        take( it.value() );
+}
+
+
+void
+ShuffleEngine::markPlayed( qint64 item )
+{
+    if ( m_played.contains( item ) )
+        return;
+
+    double weight = 1.0;
+    QHash< qint64, int >::iterator it = m_slots.find( item );
+    if ( it != m_slots.end() )
+    {
+        weight = m_weights.at( it.value() );
+        take( it.value() );
+    }
+
+    m_played.insert( item, weight );
+}
+
+
+void
+ShuffleEngine::unmarkPlayed( qint64 item )
+{
+    QHash< qint64, double >::iterator it = m_played.find( item );
+    if ( it == m_played.end() )
+        return;
+
+    const double weight = it.value();
+    m_played.erase( it );
+    insert( item, weight );
+}
+
+
+void
+ShuffleEngine::newRound()
+{
+    const QHash< qint64, double > played = m_played;
+    m_played.clear();
+
+    QHash< qint64, double >::const_iterator it = played.constBegin();
+    for ( ; it != played.constEnd(); ++it )
+        insert( it.key(), it.value() );
+}
+
+
+qint64
+ShuffleEngine::pick() const
+{
+    if ( m_items.isEmpty() )
+        return -1;
+
+    if ( m_uniform )
+        return m_items.at( randomNumber() % m_items.count() );
+
+    if ( m_totalWeight <= 0 )
+        return m_items.at( randomNumber() % m_items.count() );
+
+    const double value = ( randomNumber() % Q_UINT64_C( 0x20000000000000 ) ) / double( Q_UINT64_C( 0x20000000000000 ) ) * m_totalWeight;
+    return m_items.at( qMin( treeFind( value ), m_items.count() - 1 ) );
+}
+
+
+void
+ShuffleEngine::take( int slot )
+{
+    const int last = m_items.count() - 1;
+    const qint64 item = m_items.at( slot );
+
+    if ( !m_uniform )
+    {
+        // Move the last slot's weight into the freed one, then drop the last slot
+        treeAdd( slot, m_weights.at( last ) - m_weights.at( slot ) );
+        treeAdd( last, -m_weights.at( last ) );
+    }
+
+    if ( slot != last )
+    {
+        m_items[ slot ] = m_items.at( last );
+        m_weights[ slot ] = m_weights.at( last );
+        m_slots[ m_items.at( slot ) ] = slot;
+    }
+
+    m_items.removeLast();
+    m_weights.removeLast();
+    m_slots.remove( item );
+}
+
+
+void
+ShuffleEngine::rebuildTree( int capacity )
+{
+    m_tree.fill( 0, qMax( capacity, 16 ) + 1 );
+    m_totalWeight = 0;
+
+    for ( int i = 0; i < m_weights.count(); i++ )
+        treeAdd( i, m_weights.at( i ) );
+}
+
+
+void
+ShuffleEngine::treeAdd( int slot, double delta )
+{
+    m_totalWeight += delta;
+    for ( int i = slot + 1; i < m_tree.count(); i += i & -i )
+        m_tree[ i ] += delta;
+}
+
+
+int
+ShuffleEngine::treeFind( double value ) const
+{
+    // Smallest slot whose prefix sum of weights exceeds value
+    int pos = 0;
+    int step = 1;
+    while ( step * 2 < m_tree.count() )
+        step *= 2;
+
+    for ( ; step > 0; step /= 2 )
+    {
+        if ( pos + step < m_tree.count() && m_tree.at( pos + step ) <= value )
+        {
+            pos += step;
+            value -= m_tree.at( pos );
+        }
+    }
+
+    return pos;
+}
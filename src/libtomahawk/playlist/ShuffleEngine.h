@@ -0,0 +1,87 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHUFFLEENGINE_H
+#define SHUFFLEENGINE_H
+
+#include <QHash>
+#include <QVector>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/**
+ * Draws items in random order without repeating one until every item got its turn.
+ *
+ * Items are opaque handles, as used by PlaylistInterface. The items still to be
+ * played this round are kept in an array which picks draw from and removals swap
+ * out of (Fisher-Yates, one step at a time), so everything is O(1) as long as all
+ * weights are equal. With custom weights picks are proportional to the weight and
+ * go through a Fenwick tree over the array, which makes them O(log n).
+ */
+class DLLEXPORT ShuffleEngine
+{
+public:
+    ShuffleEngine();
+
+    /// Forgets all items and the current round
+    void clear();
+
+    /// Number of items not played yet this round
+    int remaining() const { return m_items.count(); }
+    bool contains( qint64 item ) const { return m_slots.contains( item ); }
+    bool wasPlayed( qint64 item ) const { return m_played.contains( item ); }
+    QList< qint64 > playedItems() const { return m_played.keys(); }
+
+    /// Adds an item to the current round, unless it already got played in it
+    void insert( qint64 item, double weight = 1.0 );
+    /// The item left the playlist
+    void remove( qint64 item );
+
+    /// Takes an item out of the current round, it keeps its weight for the next one
+    void markPlayed( qint64 item );
+    /// Puts a played item back into the current round, e.g. when skipping back
+    void unmarkPlayed( qint64 item );
+
+    /// Starts a new round, with everything played so far up for grabs again at its weight
+    void newRound();
+
+    /// A random item of the current round, or -1 when it's over
+    qint64 pick() const;
+
+private:
+    void take( int slot );
+    void rebuildTree( int capacity );
+    void treeAdd( int slot, double delta );
+    int treeFind( double value ) const;
+
+    QVector< qint64 > m_items;
+    QVector< double > m_weights;
+    QHash< qint64, int > m_slots;
+    // played items -> their weight
+    QHash< qint64, double > m_played;
+
+    // Fenwick tree over m_weights, only maintained once a weight other than 1 got used
+    bool m_uniform;
+    QVector< double > m_tree;
+    double m_totalWeight;
+};
+
+}
+
+#endif // SHUFFLEENGINE_H
@@ -77,14 +77,14 @@ TreeModel::collection() const
 
 
 void
-TreeModel::getCover( const QModelIndex& index )
+TreeModel::getCover( const QModelIndex& index, bool visible )
 {
     PlayableItem* item = itemFromIndex( index );
 
     if ( !item->artist().isNull() && !item->artist()->coverLoaded() )
-        item->artist()->cover( QSize( 0, 0 ) );
+        item->artist()->loadCover( visible );
     else if ( !item->album().isNull() && !item->album()->coverLoaded() )
-        item->album()->cover( QSize( 0, 0 ) );
+        item->album()->loadCover( visible );
 }
 
 
@@ -200,7 +200,8 @@ TreeModel::addAlbums( const QModelIndex& parent, const QList<Tomahawk::album_ptr
         albumitem->index = createIndex( parentItem->children.count() - 1, 0, albumitem );
         connect( albumitem, SIGNAL( dataChanged() ), SLOT( onDataChanged() ) );
 
-        getCover( albumitem->index );
+        // not necessarily on screen, ColumnView asks again for the visible ones
+        getCover( albumitem->index, false );
     }
 
     emit endInsertRows();
@@ -58,7 +58,7 @@ public:
     void addArtists( const Tomahawk::artist_ptr& artist );
     void fetchAlbums( const Tomahawk::artist_ptr& artist );
 
-    void getCover( const QModelIndex& index );
+    void getCover( const QModelIndex& index, bool visible = true );
 
     virtual PlayableItem* itemFromResult( const Tomahawk::result_ptr& result ) const;
 
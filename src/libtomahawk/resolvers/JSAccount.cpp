@@ -26,15 +26,27 @@
 #include "JSResolver.h"
 
 #include <QWebFrame>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QThread>
 
+// Max time in ms queued scripts may run before we let the event loop paint and handle input again
+#define SCRIPT_SLICE 10
+// Scripts running longer than this (in ms) get logged
+#define SLOW_SCRIPT 100
+
 using namespace Tomahawk;
 
 JSAccount::JSAccount( const QString& name )
     : ScriptAccount( name )
     , m_engine( new ScriptEngine( this ) )
+    , m_scriptTime( 0 )
+    , m_evaluations( 0 )
+    , m_depth( 0 )
 {
+    m_dispatchTimer.setSingleShot( true );
+    m_dispatchTimer.setInterval( 0 );
+    connect( &m_dispatchTimer, SIGNAL( timeout() ), SLOT( dispatch() ) );
 }
 
 
@@ -146,7 +158,7 @@ JSAccount::startJob( ScriptJob* scriptJob )
     // Remove when new scripting api turned out to work reliably
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << eval;
 
-    evaluateJavaScript( eval );
+    queueJavaScript( eval );
 }
 
 
@@ -174,7 +186,25 @@ JSAccount::syncInvoke( const scriptobject_ptr& scriptObject, const QString& meth
 QVariant
 JSAccount::evaluateJavaScriptInternal( const QString& scriptSource )
 {
-    return m_engine->mainFrame()->evaluateJavaScript( scriptSource );
+    // scripts can call back into us and evaluate more script, only account for the outermost call
+    if ( m_depth > 0 )
+        return m_engine->mainFrame()->evaluateJavaScript( scriptSource );
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_depth++;
+    const QVariant result = m_engine->mainFrame()->evaluateJavaScript( scriptSource );
+    m_depth--;
+
+    const qint64 elapsed = timer.elapsed();
+    m_scriptTime += elapsed;
+    m_evaluations++;
+
+    if ( elapsed > SLOW_SCRIPT )
+        tLog() << Q_FUNC_INFO << "Resolver" << name() << "blocked for" << elapsed << "ms, total:" << m_scriptTime << "ms in" << m_evaluations << "scripts";
+
+    return result;
 }
 
 
@@ -183,18 +213,66 @@ JSAccount::evaluateJavaScript( const QString& scriptSource )
 {
     if ( QThread::currentThread() != thread() )
     {
-        QMetaObject::invokeMethod( this, "evaluateJavaScript", Qt::QueuedConnection, Q_ARG( QString, scriptSource ) );
+        queueJavaScript( scriptSource );
         return;
     }
 
+    runQueued();
     evaluateJavaScriptInternal( scriptSource );
 }
 
 
+void
+JSAccount::queueJavaScript( const QString& scriptSource )
+{
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "queueJavaScript", Qt::QueuedConnection, Q_ARG( QString, scriptSource ) );
+        return;
+    }
+
+    m_queue.enqueue( scriptSource );
+    if ( !m_dispatchTimer.isActive() )
+        m_dispatchTimer.start();
+}
+
+
+void
+JSAccount::dispatch()
+{
+    QElapsedTimer slice;
+    slice.start();
+
+    while ( !m_queue.isEmpty() && slice.elapsed() < SCRIPT_SLICE )
+        evaluateJavaScriptInternal( m_queue.dequeue() );
+
+    // leave the rest for the next round, after pending paint and input events
+    if ( !m_queue.isEmpty() )
+    {
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << name() << "yielding with" << m_queue.count() << "scripts queued";
+        m_dispatchTimer.start();
+    }
+}
+
+
+void
+JSAccount::runQueued()
+{
+    // Scripts expect their calls in order, so jobs started before have to go first.
+    // Not from inside a running script though, that would run them in the middle of it.
+    if ( m_depth > 0 )
+        return;
+
+    while ( !m_queue.isEmpty() )
+        evaluateJavaScriptInternal( m_queue.dequeue() );
+}
+
+
 QVariant
 JSAccount::evaluateJavaScriptWithResult( const QString& scriptSource )
 {
     Q_ASSERT( QThread::currentThread() == thread() );
 
+    runQueued();
     return evaluateJavaScriptInternal( scriptSource );
 }
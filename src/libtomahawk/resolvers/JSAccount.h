@@ -24,6 +24,8 @@
 
 #include <QVariantMap>
 #include <QObject>
+#include <QQueue>
+#include <QTimer>
 
 //TODO: pimple
 #include <memory>
@@ -71,13 +73,37 @@ public:
 
     static QString serializeQVariantMap(const QVariantMap& map);
 
+private slots:
+    /**
+    * Runs queued scripts until the time slice is used up, then yields to the event loop
+    */
+    void dispatch();
+
 private:
+    /**
+    * Queue a script to be run by dispatch(), may be called from any thread
+    */
+    Q_INVOKABLE void queueJavaScript( const QString& scriptSource );
+
+    /**
+    * Runs everything queued so far, before a script that has to be evaluated right away
+    */
+    void runQueued();
+
+
     /**
         * Wrap the pure evaluateJavaScript call in here, while the threadings guards are in public methods
         */
     QVariant evaluateJavaScriptInternal( const QString& scriptSource );
 
     std::unique_ptr<ScriptEngine> m_engine;
+
+    QQueue< QString > m_queue;
+    QTimer m_dispatchTimer;
+    qint64 m_scriptTime; // wall-clock ms spent in scripts, only logged
+    int m_evaluations;
+    int m_depth;
+
     // HACK: the order of initializen is flawed, tbr
     JSResolver* m_resolver;
 };
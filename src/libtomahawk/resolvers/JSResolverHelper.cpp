@@ -155,7 +155,7 @@ JSResolverHelper::addTrackResults( const QVariantMap& results )
 
     QString qid = results.value("qid").toString();
 
-    Tomahawk::Pipeline::instance()->reportResults( qid, tracks );
+    Tomahawk::Pipeline::instance()->reportResults( qid, m_resolver, tracks );
 }
 
 
@@ -1040,8 +1040,7 @@ JSResolverHelper::addToFuzzyIndex( const QVariantList& list )
         return;
     }
 
-    m_resolver->d_func()->fuzzyIndex->beginIndexing();
-
+    QList< Tomahawk::IndexData > entries;
     foreach ( const QVariant& variant, list )
     {
         // Convert each entry to IndexData
@@ -1054,12 +1053,13 @@ JSResolverHelper::addToFuzzyIndex( const QVariantList& list )
 
             if ( indexDataFromVariant( map, indexData ) )
             {
-                m_resolver->d_func()->fuzzyIndex->appendFields( indexData );
+                entries << indexData;
             }
         }
     }
 
-    m_resolver->d_func()->fuzzyIndex->endIndexing();
+    // Only touches the new entries instead of rewriting the whole index
+    m_resolver->d_func()->fuzzyIndex->updateEntries( entries );
 }
 
 
@@ -51,6 +51,13 @@ public:
 
 public slots:
     virtual void resolve( const Tomahawk::query_ptr& query ) = 0;
+
+    /**
+     * Resolve several queries at once. Resolvers that can look up many
+     * queries cheaper than one after the other should reimplement this,
+     * the default implementation just resolves them one by one.
+     */
+    virtual void resolveBatch( const QList< Tomahawk::query_ptr >& queries );
 };
 
 } //ns
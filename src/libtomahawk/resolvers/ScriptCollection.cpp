@@ -26,6 +26,7 @@
 #include "resolvers/ScriptCommand_AllArtists.h"
 #include "resolvers/ScriptCommand_AllAlbums.h"
 #include "resolvers/ScriptCommand_AllTracks.h"
+#include "resolvers/ScriptCommandQueue.h"
 #include "ScriptAccount.h"
 
 #include <QImageReader>
@@ -43,6 +44,7 @@ ScriptCollection::ScriptCollection( const scriptobject_ptr& scriptObject,
     : Collection( source, QString( "scriptcollection:" + scriptAccount->name() + ":" + uuid() ), parent )
     , ScriptPlugin( scriptObject )
     , m_scriptAccount( scriptAccount )
+    , m_commandQueue( new ScriptCommandQueue( this ) )
     , m_trackCount( -1 ) //null value
     , m_isOnline( true )
 {
@@ -211,6 +213,20 @@ ScriptCollection::trackCount() const
 }
 
 
+void
+ScriptCollection::setMaxConcurrentCommands( int max )
+{
+    m_commandQueue->setMaxConcurrent( max );
+}
+
+
+void
+ScriptCollection::enqueue( const QSharedPointer< ScriptCommand >& command )
+{
+    m_commandQueue->enqueue( command );
+}
+
+
 QVariantMap
 ScriptCollection::readMetaData()
 {
@@ -243,6 +259,14 @@ ScriptCollection::parseMetaData( const QVariantMap& metadata )
             setTrackCount( trackCount );
     }
 
+    if ( metadata.contains( "concurrency" ) ) //how many requests the service copes with at once
+    {
+        bool ok = false;
+        int concurrency = metadata.value( "concurrency" ).toInt( &ok );
+        if ( ok )
+            setMaxConcurrentCommands( concurrency );
+    }
+
     if ( metadata.contains( "iconfile" ) )
     {
         QString iconPath = QFileInfo( scriptAccount()->filePath() ).path() + "/"
@@ -35,6 +35,8 @@
 namespace Tomahawk
 {
 class ScriptAccount;
+class ScriptCommand;
+class ScriptCommandQueue;
 
 class DLLEXPORT ScriptCollection : public Collection, public ScriptPlugin
 {
@@ -87,6 +89,11 @@ public:
     void setTrackCount( int count );
     int trackCount() const override;
 
+    /**
+     * How many browse requests may be sent to the resolver at the same time.
+     */
+    void setMaxConcurrentCommands( int max );
+
     QVariantMap readMetaData();
     void parseMetaData();
     void parseMetaData( const QVariantMap& metadata );
@@ -95,7 +102,11 @@ private slots:
     void onIconFetched();
 
 private:
+    // used by the ScriptCommands
+    void enqueue( const QSharedPointer< ScriptCommand >& command );
+
     ScriptAccount* m_scriptAccount;
+    ScriptCommandQueue* m_commandQueue;
     QString m_servicePrettyName;
     QString m_description;
     int m_trackCount;
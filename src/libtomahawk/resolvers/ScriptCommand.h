@@ -27,9 +27,18 @@ namespace Tomahawk
 class ScriptCommand : public QObject
 {
 public:
-    explicit ScriptCommand( QObject* parent = 0 ) : QObject( parent ) {}
+    enum Priority
+    {
+        Interactive = 0,    // the user is waiting for it, e.g. browsing a collection
+        Background          // prefetching, runs when no interactive commands are waiting
+    };
+
+    explicit ScriptCommand( QObject* parent = 0 ) : QObject( parent ), m_priority( Interactive ) {}
     virtual ~ScriptCommand() {}
 
+    Priority priority() const { return m_priority; }
+    void setPriority( Priority priority ) { m_priority = priority; }
+
 signals:
     virtual void done() = 0;
 
@@ -37,6 +46,12 @@ protected:
     friend class ScriptCommandQueue;
     virtual void exec() = 0;
     virtual void reportFailure() = 0;
+
+    // true if nobody is interested in the results anymore, e.g. because the user navigated away
+    virtual bool isSuperseded() const { return false; }
+
+private:
+    Priority m_priority;
 };
 
 } // ns: Tomahawk
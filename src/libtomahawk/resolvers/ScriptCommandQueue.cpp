@@ -18,16 +18,29 @@
 
 #include "ScriptCommandQueue.h"
 
+#include "utils/Logger.h"
+
 #include <QMetaType>
 #include <QMutex>
+#include <QThread>
+
+// A command that hasn't reported back after this many ms has failed
+#define COMMAND_TIMEOUT 20000
+#define DEFAULT_MAX_CONCURRENT 4
+// Log the latency histogram of a command class every this many commands
+#define LATENCY_LOG_INTERVAL 50
 
 using namespace  Tomahawk;
 
 ScriptCommandQueue::ScriptCommandQueue( QObject* parent )
     : QObject( parent )
+    , m_maxConcurrent( DEFAULT_MAX_CONCURRENT )
     , m_timer( new QTimer( this ) )
 {
-    m_timer->setSingleShot( true );
+    m_clock.start();
+
+    m_timer->setInterval( 1000 );
+    connect( m_timer, SIGNAL( timeout() ), SLOT( onTimeout() ) );
 }
 
 
@@ -35,73 +48,183 @@ void
 ScriptCommandQueue::enqueue( const QSharedPointer< ScriptCommand >& req )
 {
     QMutexLocker locker( &m_mutex );
-    m_queue.append( req );
+    m_enqueued.insert( req.data(), m_clock.elapsed() );
+    if ( req->priority() == ScriptCommand::Background )
+        m_backgroundQueue.append( req );
+    else
+        m_queue.append( req );
     locker.unlock();
 
-    if ( m_queue.count() == 1 )
+    if ( QThread::currentThread() != thread() )
+        QMetaObject::invokeMethod( this, "nextCommand", Qt::QueuedConnection );
+    else
         nextCommand();
 }
 
 
 void
-ScriptCommandQueue::nextCommand()
+ScriptCommandQueue::setMaxConcurrent( int max )
 {
-    if ( m_queue.isEmpty() )
-        return;
+    m_maxConcurrent = qMax( 1, max );
 
-    QSharedPointer< ScriptCommand > req = m_queue.first();
+    QMetaObject::invokeMethod( this, "nextCommand", Qt::QueuedConnection );
+}
 
-    connect( req.data(), SIGNAL( done() ),
-             this, SLOT( onCommandDone() ) );
-    connect( m_timer, SIGNAL( timeout() ),
-             this, SLOT( onTimeout() ) );
 
-    m_timer->start( 20000 );
+int
+ScriptCommandQueue::maxConcurrent() const
+{
+    return m_maxConcurrent;
+}
 
-    req->exec();
+
+QHash< QString, QVector< int > >
+ScriptCommandQueue::latencyHistograms() const
+{
+    QMutexLocker locker( &m_mutex );
+    return m_latencies;
 }
 
 
-void
-ScriptCommandQueue::onCommandDone()
+QVector< int >
+ScriptCommandQueue::latencyBuckets()
 {
-    if ( m_queue.isEmpty() || !m_timer->isActive() ) //the timeout already happened or some other weird thing
-        return;                                      //nothing to do here
+    static QVector< int > buckets;
+    if ( buckets.isEmpty() )
+        buckets << 50 << 100 << 250 << 500 << 1000 << 2500 << 5000 << 10000 << COMMAND_TIMEOUT;
 
-    m_timer->stop();
+    return buckets;
+}
 
+
+QSharedPointer< ScriptCommand >
+ScriptCommandQueue::takeNext()
+{
     QMutexLocker locker( &m_mutex );
-    const QSharedPointer< ScriptCommand > req = m_queue.first();
-    m_queue.removeAll( req );
-    locker.unlock();
 
-    disconnect( req.data(), SIGNAL( done() ),
-                this, SLOT( onCommandDone() ) );
-    disconnect( m_timer, SIGNAL( timeout() ),
-                this, SLOT( onTimeout() ) );
+    while ( !m_queue.isEmpty() || !m_backgroundQueue.isEmpty() )
+    {
+        const QSharedPointer< ScriptCommand > req = m_queue.isEmpty() ? m_backgroundQueue.dequeue() : m_queue.dequeue();
+        if ( !req->isSuperseded() )
+            return req;
 
-    if ( !m_queue.isEmpty() )
-        nextCommand();
+        // nobody would get the results, don't waste the resolver's time on it
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Dropping superseded" << req->metaObject()->className();
+        m_enqueued.remove( req.data() );
+    }
+
+    return QSharedPointer< ScriptCommand >();
+}
+
+
+void
+ScriptCommandQueue::nextCommand()
+{
+    while ( m_running.count() < m_maxConcurrent )
+    {
+        const QSharedPointer< ScriptCommand > req = takeNext();
+        if ( req.isNull() )
+            break;
+
+        connect( req.data(), SIGNAL( done() ),
+                 this, SLOT( onCommandDone() ) );
+
+        // exec() might report back right away, so it needs to be registered as running before
+        m_running.insert( req.data(), req );
+        m_started.insert( req.data(), m_clock.elapsed() );
+        if ( !m_timer->isActive() )
+            m_timer->start();
+
+        req->exec();
+    }
+}
+
+
+void
+ScriptCommandQueue::onCommandDone()
+{
+    ScriptCommand* req = dynamic_cast< ScriptCommand* >( sender() );
+    if ( !req || !m_running.contains( req ) ) //the timeout already happened or some other weird thing
+        return;                               //nothing to do here
+
+    finish( req );
+    nextCommand();
 }
 
 
 void
 ScriptCommandQueue::onTimeout()
 {
-    m_timer->stop();
+    const qint64 now = m_clock.elapsed();
+
+    foreach ( ScriptCommand* req, m_running.keys() )
+    {
+        if ( req->isSuperseded() )
+        {
+            // Nobody would get the results anymore, let the next command have its slot.
+            // Whatever it still reports goes nowhere.
+            const QSharedPointer< ScriptCommand > ref = m_running.value( req );
+            tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Cancelling superseded" << req->metaObject()->className();
+
+            forget( req );
+            continue;
+        }
+
+        if ( now - m_started.value( req ) < COMMAND_TIMEOUT )
+            continue;
+
+        // keep it alive while it reports its failure
+        const QSharedPointer< ScriptCommand > ref = m_running.value( req );
+        tLog() << Q_FUNC_INFO << "Timed out:" << req->metaObject()->className();
+
+        finish( req );
+        req->reportFailure();
+    }
+
+    if ( m_running.isEmpty() )
+        m_timer->stop();
+
+    nextCommand();
+}
+
+
+void
+ScriptCommandQueue::finish( ScriptCommand* req )
+{
+    const QSharedPointer< ScriptCommand > ref = m_running.value( req );
+    const qint64 latency = m_clock.elapsed() - forget( req );
 
     QMutexLocker locker( &m_mutex );
-    const QSharedPointer< ScriptCommand > req = m_queue.first();
-    m_queue.removeAll( req );
-    locker.unlock();
+    const QString name = req->metaObject()->className();
+    const QVector< int > buckets = latencyBuckets();
+
+    QVector< int >& histogram = m_latencies[ name ];
+    if ( histogram.isEmpty() )
+        histogram.fill( 0, buckets.count() + 1 );
+
+    int bucket = 0;
+    while ( bucket < buckets.count() && latency > buckets.at( bucket ) )
+        bucket++;
+    histogram[ bucket ]++;
+
+    int total = 0;
+    foreach ( int count, histogram )
+        total += count;
+    if ( total % LATENCY_LOG_INTERVAL == 0 )
+        tDebug() << Q_FUNC_INFO << name << "latencies (ms)" << buckets << "counts" << histogram;
+}
+
 
-    req->reportFailure();
+qint64
+ScriptCommandQueue::forget( ScriptCommand* req )
+{
+    // caller keeps req alive
+    m_running.remove( req );
+    m_started.remove( req );
 
-    disconnect( req.data(), SIGNAL( done() ),
+    disconnect( req, SIGNAL( done() ),
                 this, SLOT( onCommandDone() ) );
-    disconnect( m_timer, SIGNAL( timeout() ),
-                this, SLOT( onTimeout() ) );
 
-    if ( !m_queue.isEmpty() )
-        nextCommand();
+    QMutexLocker locker( &m_mutex );
+    return m_enqueued.take( req );
 }
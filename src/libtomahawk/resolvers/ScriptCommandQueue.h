@@ -21,11 +21,14 @@
 
 #include "ScriptCommand.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QQueue>
 #include <QSharedPointer>
 #include <QTimer>
 #include <QMetaType>
 #include <QMutex>
+#include <QVector>
 
 namespace Tomahawk
 {
@@ -39,15 +42,40 @@ public:
 
     void enqueue( const QSharedPointer< ScriptCommand >& req );
 
+    /**
+     * How many commands may run at the same time.
+     */
+    void setMaxConcurrent( int max );
+    int maxConcurrent() const;
+
+    /**
+     * Per command class, how many commands took (from enqueue until done)
+     * at most latencyBuckets()[i] ms. The last bucket counts everything slower,
+     * including timeouts.
+     */
+    QHash< QString, QVector< int > > latencyHistograms() const;
+    static QVector< int > latencyBuckets();
+
 private slots:
     void nextCommand();
     void onCommandDone();
     void onTimeout();
 
 private:
+    QSharedPointer< ScriptCommand > takeNext();
+    void finish( ScriptCommand* req );
+    qint64 forget( ScriptCommand* req );
+
     QQueue< QSharedPointer< ScriptCommand > > m_queue;
+    QQueue< QSharedPointer< ScriptCommand > > m_backgroundQueue;
+    QHash< ScriptCommand*, QSharedPointer< ScriptCommand > > m_running;
+    QHash< ScriptCommand*, qint64 > m_enqueued;
+    QHash< ScriptCommand*, qint64 > m_started;
+    QHash< QString, QVector< int > > m_latencies;
+    int m_maxConcurrent;
+    QElapsedTimer m_clock;
     QTimer* m_timer;
-    QMutex m_mutex;
+    mutable QMutex m_mutex;
 };
 
 } // ns: Tomahawk
@@ -50,7 +50,7 @@ ScriptCommand_AllAlbums::enqueue()
         return;
     }
 
-    exec();
+    collection->enqueue( QSharedPointer< ScriptCommand >( this, &QObject::deleteLater ) );
 }
 
 
@@ -88,6 +88,13 @@ ScriptCommand_AllAlbums::exec()
 }
 
 
+bool
+ScriptCommand_AllAlbums::isSuperseded() const
+{
+    return receivers( SIGNAL( albums( QList< Tomahawk::album_ptr > ) ) ) == 0;
+}
+
+
 void
 ScriptCommand_AllAlbums::reportFailure()
 {
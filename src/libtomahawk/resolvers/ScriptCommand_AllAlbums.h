@@ -47,6 +47,7 @@ signals:
 protected:
     virtual void exec();
     virtual void reportFailure();
+    virtual bool isSuperseded() const;
 
 private slots:
     void onAlbumsJobDone( const QVariantMap& result );
@@ -47,7 +47,7 @@ ScriptCommand_AllArtists::enqueue()
         return;
     }
 
-    exec();
+    collection->enqueue( QSharedPointer< ScriptCommand >( this, &QObject::deleteLater ) );
 }
 
 
@@ -70,6 +70,13 @@ ScriptCommand_AllArtists::exec()
 }
 
 
+bool
+ScriptCommand_AllArtists::isSuperseded() const
+{
+    return receivers( SIGNAL( artists( QList< Tomahawk::artist_ptr > ) ) ) == 0;
+}
+
+
 void
 ScriptCommand_AllArtists::reportFailure()
 {
@@ -48,6 +48,7 @@ signals:
 protected:
     void exec() override;
     void reportFailure() override;
+    bool isSuperseded() const override;
 
 private slots:
     void onArtistsJobDone( const QVariantMap& result );
@@ -50,7 +50,7 @@ ScriptCommand_AllTracks::enqueue()
         return;
     }
 
-    exec();
+    collection->enqueue( QSharedPointer< ScriptCommand >( this, &QObject::deleteLater ) );
 }
 
 
@@ -84,6 +84,13 @@ ScriptCommand_AllTracks::exec()
 }
 
 
+bool
+ScriptCommand_AllTracks::isSuperseded() const
+{
+    return receivers( SIGNAL( tracks( QList< Tomahawk::query_ptr > ) ) ) == 0;
+}
+
+
 void
 ScriptCommand_AllTracks::reportFailure()
 {
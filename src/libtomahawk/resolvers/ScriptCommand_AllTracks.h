@@ -45,6 +45,7 @@ signals:
 protected:
     Q_INVOKABLE void exec() override;
     void reportFailure() override;
+    bool isSuperseded() const override;
 
 private slots:
     void onTracksJobDone( const QVariantMap& result );
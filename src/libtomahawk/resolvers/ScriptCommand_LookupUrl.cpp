@@ -38,7 +38,7 @@ void
 ScriptCommand_LookupUrl::enqueue()
 {
     Q_D( ScriptCommand_LookupUrl );
-    d->resolver->enqueue( QSharedPointer< ScriptCommand >( this ) );
+    d->resolver->enqueue( QSharedPointer< ScriptCommand >( this, &QObject::deleteLater ) );
 }
 
 
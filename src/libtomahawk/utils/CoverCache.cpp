@@ -0,0 +1,244 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CoverCache.h"
+
+#include "utils/Logger.h"
+#include "TomahawkSettings.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+
+// Memory budget for scaled covers in KB
+#define MEMORY_BUDGET ( 64 * 1024 )
+// Size limit of the thumbnails on disk in bytes, pruned on startup
+#define DISK_BUDGET ( 200 * 1024 * 1024 )
+
+using namespace TomahawkUtils;
+
+CoverCache* CoverCache::s_instance = 0;
+
+
+namespace
+{
+
+class CoverScaler : public QRunnable
+{
+public:
+    CoverScaler( const QString& key, const QByteArray& data, const QSize& size, const QString& thumbnailDir )
+        : m_key( key )
+        , m_data( data )
+        , m_size( size )
+        , m_thumbnailDir( thumbnailDir )
+    {
+    }
+
+    void run()
+    {
+        const QString thumbnail = QString( "%1/%2_%3x%4.png" )
+                                    .arg( m_thumbnailDir )
+                                    .arg( QString::fromLatin1( QCryptographicHash::hash( m_data, QCryptographicHash::Md5 ).toHex() ) )
+                                    .arg( m_size.width() )
+                                    .arg( m_size.height() );
+
+        QImage image( thumbnail );
+        if ( image.isNull() )
+        {
+            image = scaled();
+            if ( !image.isNull() && !m_thumbnailDir.isEmpty() )
+                image.save( thumbnail, "PNG" );
+        }
+
+        QMetaObject::invokeMethod( CoverCache::instance(), "onScaled", Qt::QueuedConnection,
+                                   Q_ARG( QString, m_key ), Q_ARG( QImage, image ) );
+    }
+
+private:
+    QImage scaled() const
+    {
+        QImage image;
+        if ( !image.loadFromData( m_data ) )
+            return QImage();
+
+        // same as TomahawkUtils::squareCenterPixmap
+        if ( image.width() != image.height() )
+        {
+            const int side = qMin( image.width(), image.height() );
+            image = image.copy( ( image.width() - side ) / 2, ( image.height() - side ) / 2, side, side );
+        }
+
+        return image.scaled( m_size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+    }
+
+    QString m_key;
+    QByteArray m_data;
+    QSize m_size;
+    QString m_thumbnailDir;
+};
+
+
+class ThumbnailPruner : public QRunnable
+{
+public:
+    explicit ThumbnailPruner( const QString& thumbnailDir )
+        : m_thumbnailDir( thumbnailDir )
+    {
+    }
+
+    void run()
+    {
+        // newest first, remove whatever doesn't fit into the budget anymore
+        qint64 total = 0;
+        int removed = 0;
+        foreach ( const QFileInfo& fi, QDir( m_thumbnailDir ).entryInfoList( QDir::Files, QDir::Time ) )
+        {
+            total += fi.size();
+            if ( total > DISK_BUDGET && QFile::remove( fi.absoluteFilePath() ) )
+                removed++;
+        }
+
+        if ( removed )
+            tDebug() << Q_FUNC_INFO << "Removed" << removed << "thumbnails";
+    }
+
+private:
+    QString m_thumbnailDir;
+};
+
+}
+
+
+CoverCache*
+CoverCache::instance()
+{
+    if ( !s_instance )
+        s_instance = new CoverCache();
+
+    return s_instance;
+}
+
+
+CoverCache::CoverCache()
+    : QObject()
+    , m_pixmaps( MEMORY_BUDGET )
+{
+    // leave a core for the GUI thread
+    m_pool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() - 1 ) );
+
+    m_thumbnailDir = TomahawkSettings::instance()->storageCacheLocation() + "/Thumbnails";
+    if ( QDir().mkpath( m_thumbnailDir ) )
+        m_pool.start( new ThumbnailPruner( m_thumbnailDir ) );
+    else
+        m_thumbnailDir.clear();
+}
+
+
+CoverCache::~CoverCache()
+{
+    m_pool.waitForDone();
+}
+
+
+QPixmap
+CoverCache::cover( const QString& owner, const QByteArray& data, const QSize& size, QObject* receiver, const char* member )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+    if ( data.isEmpty() || size.isEmpty() )
+        return QPixmap();
+
+    const QString key = QString( "%1_%2_%3x%4" ).arg( owner ).arg( m_generations.value( owner ) ).arg( size.width() ).arg( size.height() );
+    if ( QPixmap* pixmap = m_pixmaps.object( key ) )
+        return *pixmap;
+
+    const bool scaling = m_pending.contains( key );
+    QList< QPair< QPointer< QObject >, QByteArray > >& waiting = m_pending[ key ];
+    if ( receiver && member )
+        waiting << qMakePair( QPointer< QObject >( receiver ), QByteArray( member ) );
+
+    if ( !scaling )
+        m_pool.start( new CoverScaler( key, data, size, m_thumbnailDir ) );
+
+    return QPixmap();
+}
+
+
+QPixmap
+CoverCache::cover( const QString& owner, const QPixmap& cover, const QSize& size )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+    if ( cover.isNull() || size.isEmpty() )
+        return QPixmap();
+
+    const QString key = QString( "%1_%2_%3x%4" ).arg( owner ).arg( m_generations.value( owner ) ).arg( size.width() ).arg( size.height() );
+    if ( QPixmap* pixmap = m_pixmaps.object( key ) )
+        return *pixmap;
+
+    QPixmap* pixmap = new QPixmap( cover.scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation ) );
+    const QPixmap scaled = *pixmap;
+    m_pixmaps.insert( key, pixmap, qMax( 1, pixmap->width() * pixmap->height() * pixmap->depth() / 8 / 1024 ) );
+
+    return scaled;
+}
+
+
+void
+CoverCache::remove( const QString& owner )
+{
+    Q_ASSERT( QThread::currentThread() == thread() );
+
+    // covers that are still being scaled end up under the old generation and are never asked for again
+    m_generations[ owner ]++;
+
+    const QString prefix = owner + "_";
+    foreach ( const QString& key, m_pixmaps.keys() )
+    {
+        if ( key.startsWith( prefix ) )
+            m_pixmaps.remove( key );
+    }
+}
+
+
+void
+CoverCache::setMaxCost( int kb )
+{
+    m_pixmaps.setMaxCost( kb );
+}
+
+
+int
+CoverCache::maxCost() const
+{
+    return m_pixmaps.maxCost();
+}
+
+
+void
+CoverCache::onScaled( const QString& key, const QImage& image )
+{
+    // also cache failures, so broken images don't get decoded over and over
+    QPixmap* pixmap = new QPixmap( QPixmap::fromImage( image ) );
+    m_pixmaps.insert( key, pixmap, qMax( 1, pixmap->width() * pixmap->height() * pixmap->depth() / 8 / 1024 ) );
+
+    typedef QPair< QPointer< QObject >, QByteArray > Receiver;
+    foreach ( const Receiver& receiver, m_pending.take( key ) )
+    {
+        if ( !receiver.first.isNull() )
+            QMetaObject::invokeMethod( receiver.first.data(), receiver.second.constData() );
+    }
+}
@@ -0,0 +1,91 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_COVERCACHE_H
+#define TOMAHAWK_COVERCACHE_H
+
+#include "DllMacro.h"
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QPointer>
+#include <QThreadPool>
+
+namespace TomahawkUtils
+{
+
+/**
+ * Decodes and scales album and artist covers on a thread pool. The scaled
+ * covers share one memory budget, least recently used ones get dropped first,
+ * and they are kept as thumbnails on disk so they don't need decoding again.
+ *
+ * Must only be used from the GUI thread.
+ */
+class DLLEXPORT CoverCache : public QObject
+{
+Q_OBJECT
+
+public:
+    static CoverCache* instance();
+    virtual ~CoverCache();
+
+    /**
+     * The square cover made from the image @p data, scaled to @p size.
+     * If it isn't ready yet a null pixmap is returned, it gets scaled in the
+     * background and @p member of @p receiver is invoked once it's there.
+     * @p owner identifies whose cover @p data is, e.g. the infoid of an album.
+     */
+    QPixmap cover( const QString& owner, const QByteArray& data, const QSize& size,
+                   QObject* receiver = 0, const char* member = 0 );
+
+    /**
+     * Same as above for a cover that is already decoded, e.g. because its full
+     * size got shown. Scaling that is cheap enough to do right away.
+     */
+    QPixmap cover( const QString& owner, const QPixmap& cover, const QSize& size );
+
+    /**
+     * Forgets all sizes of the cover of @p owner, e.g. because it got a new one.
+     */
+    void remove( const QString& owner );
+
+    /**
+     * Memory budget in KB, shared by all covers.
+     */
+    void setMaxCost( int kb );
+    int maxCost() const;
+
+private slots:
+    void onScaled( const QString& key, const QImage& image );
+
+private:
+    explicit CoverCache();
+
+    QCache< QString, QPixmap > m_pixmaps;
+    QHash< QString, int > m_generations;
+    QHash< QString, QList< QPair< QPointer< QObject >, QByteArray > > > m_pending;
+    QThreadPool m_pool;
+    QString m_thumbnailDir;
+
+    static CoverCache* s_instance;
+};
+
+}
+
+#endif // TOMAHAWK_COVERCACHE_H
@@ -22,15 +22,24 @@
 #include <fstream>
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QMutex>
-#include <QTime>
+#include <QThread>
 #include <QVariant>
 
 #include "utils/TomahawkUtils.h"
 
 #define LOGFILE_SIZE 1024 * 256
+// Once the log file grows beyond this it's moved to <logfile>.1 and a new one is started
+#define LOGFILE_ROTATE_SIZE 1024 * 1024 * 16
+// Max lines waiting to be written, anything beyond is dropped (and counted)
+#define LOG_QUEUE_SIZE 20000
+// How often in ms the writer thread picks up new lines
+#define LOG_WRITE_INTERVAL 50
+// How long in ms flushing waits for the writer thread before giving up
+#define LOG_FLUSH_TIMEOUT 2000
 
 #define RELEASE_LEVEL_THRESHOLD 0
 #define DEBUG_LEVEL_THRESHOLD LOGEXTRA
@@ -38,10 +47,265 @@
 
 using namespace std;
 
-ofstream logStream;
 static int s_threshold = -1;
-QMutex s_mutex;
-bool shutdownInProgress = false;
+static volatile bool shutdownInProgress = false;
+
+
+namespace
+{
+
+struct LogEntry
+{
+    LogEntry()
+        : next( 0 )
+        , timestamp( 0 )
+        , debugLevel( 0 )
+        , toDisk( false )
+        , toConsole( false )
+    {
+    }
+
+    QAtomicPointer< LogEntry > next;
+    qint64 timestamp;
+    unsigned int debugLevel;
+    bool toDisk;
+    bool toConsole;
+    QByteArray msg;
+};
+
+
+/**
+ * Multi-producer, single-consumer queue (after Dmitry Vyukov's). Logging threads
+ * only swap the head pointer, they never block each other or the writer.
+ */
+class LogQueue
+{
+public:
+    LogQueue()
+        : m_head( new LogEntry )
+    {
+        m_tail = m_head.fetchAndAddRelaxed( 0 );
+    }
+
+    void push( LogEntry* entry )
+    {
+        LogEntry* prev = m_head.fetchAndStoreOrdered( entry );
+        prev->next.fetchAndStoreRelease( entry );
+    }
+
+    // Must only be called from the writer thread
+    bool pop( LogEntry& out )
+    {
+        LogEntry* next = m_tail->next.fetchAndAddAcquire( 0 );
+        if ( !next )
+            return false;
+
+        out.timestamp = next->timestamp;
+        out.debugLevel = next->debugLevel;
+        out.toDisk = next->toDisk;
+        out.toConsole = next->toConsole;
+        out.msg.swap( next->msg );
+
+        // next is the new (empty) tail
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+private:
+    QAtomicPointer< LogEntry > m_head;
+    LogEntry* m_tail;
+};
+
+
+class LogWriter : public QThread
+{
+public:
+    LogWriter()
+        : m_written( 0 )
+        , m_second( -1 )
+    {
+        start();
+    }
+
+    virtual ~LogWriter()
+    {
+        m_stop.fetchAndStoreOrdered( 1 );
+        wait();
+    }
+
+    void enqueue( LogEntry* entry )
+    {
+        if ( m_queued.fetchAndAddRelaxed( 1 ) >= LOG_QUEUE_SIZE )
+        {
+            m_queued.fetchAndAddRelaxed( -1 );
+            m_dropped.ref();
+            delete entry;
+            return;
+        }
+
+        m_queue.push( entry );
+    }
+
+    void setFile( const QString& fileName )
+    {
+        QMutexLocker locker( &m_fileMutex );
+        m_fileName = fileName;
+    }
+
+    // Waits until everything logged so far is written
+    void flush()
+    {
+        for ( int waited = 0; m_queued.fetchAndAddRelaxed( 0 ) > 0 && waited < LOG_FLUSH_TIMEOUT; waited += 5 )
+            msleep( 5 );
+    }
+
+protected:
+    void run()
+    {
+        while ( !m_stop.fetchAndAddRelaxed( 0 ) )
+        {
+            write();
+            msleep( LOG_WRITE_INTERVAL );
+        }
+
+        write();
+    }
+
+private:
+    void openFile()
+    {
+        QMutexLocker locker( &m_fileMutex );
+        if ( m_fileName.isEmpty() || m_openFileName == m_fileName )
+            return;
+
+        if ( m_stream.is_open() )
+            m_stream.close();
+
+#ifdef _WIN32
+        // this is not supported in upstream libstdc++ as shipped with GCC
+        // GCC needs the patch from https://gcc.gnu.org/ml/libstdc++/2011-06/msg00066.html applied
+        // we could create a CMake check like the one for taglib, but I don't care right now :P
+        m_stream.open( m_fileName.toStdWString().c_str(), ios::out | ios::app );
+#else
+        m_stream.open( m_fileName.toStdString().c_str(), ios::out | ios::app );
+#endif
+
+        m_openFileName = m_fileName;
+        m_written = QFileInfo( m_fileName ).size();
+    }
+
+    void rotate()
+    {
+        m_stream.close();
+
+        const QString old = m_openFileName + ".1";
+        QFile::remove( old );
+        QFile::rename( m_openFileName, old );
+
+        // makes openFile() start a new one
+        m_openFileName.clear();
+        openFile();
+    }
+
+    void updateTimestamp( qint64 timestamp )
+    {
+        // formatting dates is expensive, only do it once per second
+        if ( timestamp / 1000 == m_second )
+            return;
+        m_second = timestamp / 1000;
+
+        const QDateTime dt = QDateTime::fromMSecsSinceEpoch( timestamp );
+        if ( shutdownInProgress )
+        {
+            // Do not use locales anymore in shutdown
+            const QByteArray time = QString( "%1:%2:%3" ).arg( dt.time().hour() ).arg( dt.time().minute() ).arg( dt.time().second() ).toUtf8();
+            m_date = QString( "%1.%2.%3 - " ).arg( dt.date().day() ).arg( dt.date().month() ).arg( dt.date().year() ).toUtf8() + time;
+            m_time = time;
+        }
+        else
+        {
+            m_time = dt.time().toString().toUtf8();
+            m_date = dt.date().toString().toUtf8() + " - " + m_time;
+        }
+    }
+
+    void write()
+    {
+        openFile();
+
+        QByteArray disk;
+        QByteArray console;
+
+        const int dropped = m_dropped.fetchAndStoreRelaxed( 0 );
+        if ( dropped )
+        {
+            LogEntry* entry = new LogEntry;
+            entry->timestamp = QDateTime::currentMSecsSinceEpoch();
+            entry->toDisk = entry->toConsole = true;
+            entry->msg = "Logger: dropped " + QByteArray::number( dropped ) + " messages, the queue was full";
+            m_queue.push( entry );
+            m_queued.ref();
+        }
+
+        LogEntry entry;
+        while ( m_queue.pop( entry ) )
+        {
+            m_queued.deref();
+            updateTimestamp( entry.timestamp );
+
+            const QByteArray level = " [" + QByteArray::number( entry.debugLevel ) + "]: ";
+            if ( entry.toDisk )
+            {
+                #ifdef LOG_SQL_QUERIES
+                if ( entry.debugLevel == LOGSQL )
+                    disk += "TSQLQUERY: ";
+                #endif
+
+                disk += m_date + level + entry.msg + '\n';
+            }
+
+            if ( entry.toConsole )
+                console += m_time + level + entry.msg + '\n';
+        }
+
+        if ( !disk.isEmpty() && m_stream.is_open() )
+        {
+            m_stream.write( disk.constData(), disk.size() );
+            m_stream.flush();
+
+            m_written += disk.size();
+            if ( m_written > LOGFILE_ROTATE_SIZE )
+                rotate();
+        }
+
+        if ( !console.isEmpty() )
+        {
+            wcout << console.constData();
+            wcout.flush();
+        }
+    }
+
+    LogQueue m_queue;
+    QAtomicInt m_queued;
+    QAtomicInt m_dropped;
+    QAtomicInt m_stop;
+
+    QMutex m_fileMutex;
+    QString m_fileName;
+
+    // only used on the writer thread
+    ofstream m_stream;
+    QString m_openFileName;
+    qint64 m_written;
+    qint64 m_second;
+    QByteArray m_date;
+    QByteArray m_time;
+};
+
+}
+
+Q_GLOBAL_STATIC( LogWriter, s_writer )
 
 
 namespace Logger
@@ -70,60 +334,23 @@ log( const char *msg, unsigned int debugLevel, bool toDisk = true )
         toDisk = true;
     #endif
 
-    if ( toDisk || (int)debugLevel <= s_threshold )
-    {
-        QMutexLocker lock( &s_mutex );
-
-        #ifdef LOG_SQL_QUERIES
-        if ( debugLevel == LOGSQL )
-            logStream << "TSQLQUERY: ";
-        #endif
+    toDisk = toDisk || (int)debugLevel <= s_threshold;
+    const bool toConsole = debugLevel <= LOGEXTRA || (int)debugLevel <= s_threshold;
+    if ( !toDisk && !toConsole )
+        return;
 
-        if ( shutdownInProgress )
-        {
-            // Do not use locales anymore in shutdown
-            logStream << QDate::currentDate().day() << "."
-                      << QDate::currentDate().month() << "."
-                      << QDate::currentDate().year() << " - "
-                      << QTime::currentTime().hour() << ":"
-                      << QTime::currentTime().minute() << ":"
-                      << QTime::currentTime().second()
-                      << " [" << QString::number( debugLevel ).toUtf8().data() << "]: "
-                      << msg << endl;
-        }
-        else
-        {
-            logStream << QDate::currentDate().toString().toUtf8().data()
-                      << " - "
-                      << QTime::currentTime().toString().toUtf8().data()
-                      << " [" << QString::number( debugLevel ).toUtf8().data() << "]: "
-                      << msg << endl;
-        }
-
-        logStream.flush();
-    }
-
-    if ( debugLevel <= LOGEXTRA || (int)debugLevel <= s_threshold )
-    {
-        QMutexLocker lock( &s_mutex );
+    LogWriter* writer = s_writer();
+    if ( !writer )
+        return;
 
-        if ( shutdownInProgress )
-        {
-            wcout << QTime::currentTime().hour() << ":"
-                  << QTime::currentTime().minute() << ":"
-                  << QTime::currentTime().second()
-                  << " [" << QString::number( debugLevel ).toStdWString().c_str() << "]: "
-                  << msg << endl;
-        }
-        else
-        {
-            wcout << QTime::currentTime().toString().toUtf8().data()
-                  << " [" << QString::number( debugLevel ).toStdWString().c_str() << "]: "
-                  << msg << endl;
-        }
+    LogEntry* entry = new LogEntry;
+    entry->timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry->debugLevel = debugLevel;
+    entry->toDisk = toDisk;
+    entry->toConsole = toConsole;
+    entry->msg = msg;
 
-        wcout.flush();
-    }
+    writer->enqueue( entry );
 }
 
 
@@ -134,8 +361,6 @@ TomahawkLogHandler( QtMsgType type, const QMessageLogContext& context, const QSt
 TomahawkLogHandler( QtMsgType type, const char* msg )
 #endif
 {
-    static QMutex s_mutex;
-
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0 )
     QByteArray ba = msg.toUtf8();
     const char* message = ba.constData();
@@ -143,7 +368,6 @@ TomahawkLogHandler( QtMsgType type, const char* msg )
     const char* message = msg;
 #endif
 
-    QMutexLocker locker( &s_mutex );
     switch( type )
     {
         case QtDebugMsg:
@@ -160,11 +384,20 @@ TomahawkLogHandler( QtMsgType type, const char* msg )
 
         case QtFatalMsg:
             log( message, 0 );
+            // we're about to abort, make sure it ends up in the log
+            flush();
             break;
     }
 }
 
 
+void
+flush()
+{
+    if ( LogWriter* writer = s_writer() )
+        writer->flush();
+}
+
 
 void
 setupLogfile( QFile& f )
@@ -188,14 +421,8 @@ setupLogfile( QFile& f )
         }
     }
 
-#ifdef _WIN32
-    // this is not supported in upstream libstdc++ as shipped with GCC
-    // GCC needs the patch from https://gcc.gnu.org/ml/libstdc++/2011-06/msg00066.html applied
-    // we could create a CMake check like the one for taglib, but I don't care right now :P
-    logStream.open( f.fileName().toStdWString().c_str() );
-#else
-    logStream.open( f.fileName().toStdString().c_str() );
-#endif
+    if ( LogWriter* writer = s_writer() )
+        writer->setFile( f.fileName() );
 
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0 )
     qInstallMessageHandler( TomahawkLogHandler );
@@ -224,6 +451,6 @@ TLog::~TLog()
 void
 tLogNotifyShutdown()
 {
-    QMutexLocker locker( &s_mutex );
     shutdownInProgress = true;
+    Logger::flush();
 }
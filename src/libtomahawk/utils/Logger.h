@@ -63,6 +63,12 @@ namespace Logger
 
     DLLEXPORT void TomahawkLogHandler( QtMsgType type, const char* msg );
     DLLEXPORT void setupLogfile( QFile& f );
+
+    /**
+     * Lines are written by a background thread. Blocks until everything
+     * logged so far has been written.
+     */
+    DLLEXPORT void flush();
 }
 
 #define tLog Logger::TLog
@@ -146,12 +146,18 @@ PixmapDelegateFader::setSize( const QSize& size )
     }
     else
     {
+        QPixmap pixmap;
         if ( !m_album.isNull() )
-            m_currentReference = m_album->cover( m_size );
+            pixmap = m_album->cover( m_size );
         else if ( !m_artist.isNull() )
-            m_currentReference = m_artist->cover( m_size );
+            pixmap = m_artist->cover( m_size );
         else if ( !m_track.isNull() )
-            m_currentReference = m_track->track()->cover( m_size );
+            pixmap = m_track->track()->cover( m_size );
+
+        // covers get scaled in the background, keep showing the current one until
+        // the new size is ready and comes in through setPixmap()
+        if ( !pixmap.isNull() )
+            m_currentReference = pixmap;
     }
 
     emit repaintRequest();
@@ -61,6 +61,7 @@
 #include <QProcess>
 #include <QStringList>
 #include <QTranslator>
+#include <QVarLengthArray>
 
 // Qt version specific includes
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0 )
@@ -411,51 +412,38 @@ levenshtein( const QString& source, const QString& target )
     if ( m == 0 )
         return n;
 
-    // Good form to declare a TYPEDEF
-    typedef QVector< QVector<int> > Tmatrix;
-    Tmatrix matrix;
-    matrix.resize( n + 1 );
+    // Only the last three rows of the matrix are ever looked at, so we just keep
+    // those around. For any sane name length they live on the stack.
+    QVarLengthArray< int, 3 * 128 > rows( 3 * ( m + 1 ) );
+    int* twoAbove = rows.data();
+    int* above = twoAbove + m + 1;
+    int* current = above + m + 1;
 
-    // Size the vectors in the 2.nd dimension. Unfortunately C++ doesn't
-    // allow for allocation on declaration of 2.nd dimension of vec of vec
-    for ( int i = 0; i <= n; i++ )
-    {
-        QVector<int> tmp;
-        tmp.resize( m + 1 );
-        matrix.insert( i, tmp );
-    }
+    const QChar* s = source.constData();
+    const QChar* t = target.constData();
 
     // Step 2
-    for ( int i = 0; i <= n; i++ )
-        matrix[i][0] = i;
     for ( int j = 0; j <= m; j++ )
-        matrix[0][j] = j;
+        above[j] = j;
 
     // Step 3
     for ( int i = 1; i <= n; i++ )
     {
-        const QChar s_i = source[i - 1];
+        const QChar s_i = s[i - 1];
+        current[0] = i;
 
         // Step 4
         for ( int j = 1; j <= m; j++ )
         {
-            const QChar t_j = target[j - 1];
+            const QChar t_j = t[j - 1];
 
             // Step 5
-            int cost;
-            if ( s_i == t_j )
-                cost = 0;
-            else
-                cost = 1;
+            const int cost = ( s_i == t_j ) ? 0 : 1;
 
             // Step 6
-            const int above = matrix[i - 1][j];
-            const int left = matrix[i][j - 1];
-            const int diag = matrix[i - 1][j - 1];
-
-            int cell = ( ( ( left + 1 ) > ( diag + cost ) ) ? diag + cost : left + 1 );
-            if ( above + 1 < cell )
-                cell = above + 1;
+            int cell = qMin( current[j - 1] + 1, above[j - 1] + cost );
+            if ( above[j] + 1 < cell )
+                cell = above[j] + 1;
 
             // Step 6A: Cover transposition, in addition to deletion,
             // insertion and substitution. This step is taken from:
@@ -464,18 +452,23 @@ levenshtein( const QString& source, const QString& target )
             // (http://www.acm.org/~hlb/publications/asm/asm.html)
             if ( i > 2 && j > 2 )
             {
-                int trans = matrix[i - 2][j - 2] + 1;
+                int trans = twoAbove[j - 2] + 1;
 
-                if ( source[ i - 2 ] != t_j ) trans++;
-                if ( s_i != target[ j - 2 ] ) trans++;
+                if ( s[i - 2] != t_j ) trans++;
+                if ( s_i != t[j - 2] ) trans++;
                 if ( cell > trans ) cell = trans;
             }
-            matrix[i][j] = cell;
+            current[j] = cell;
         }
+
+        int* done = twoAbove;
+        twoAbove = above;
+        above = current;
+        current = done;
     }
 
     // Step 7
-    return matrix[n][m];
+    return above[m];
 }
 
 
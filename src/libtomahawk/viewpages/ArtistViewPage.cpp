@@ -304,6 +304,7 @@ ArtistInfoWidget::load( const artist_ptr& artist )
     if ( m_artist )
     {
         disconnect( m_artist.data(), SIGNAL( updated() ), this, SLOT( onArtistImageUpdated() ) );
+        disconnect( m_artist.data(), SIGNAL( coverChanged() ), this, SLOT( onArtistImageUpdated() ) );
         disconnect( m_artist.data(), SIGNAL( similarArtistsLoaded() ), this, SLOT( onSimilarArtistsLoaded() ) );
         disconnect( m_artist.data(), SIGNAL( biographyLoaded() ), this, SLOT( onBiographyLoaded() ) );
         disconnect( m_artist.data(), SIGNAL( albumsAdded( QList<Tomahawk::album_ptr>, Tomahawk::ModelMode ) ),
@@ -319,6 +320,7 @@ ArtistInfoWidget::load( const artist_ptr& artist )
     connect( m_artist.data(), SIGNAL( biographyLoaded() ), SLOT( onBiographyLoaded() ) );
     connect( m_artist.data(), SIGNAL( similarArtistsLoaded() ), SLOT( onSimilarArtistsLoaded() ) );
     connect( m_artist.data(), SIGNAL( updated() ), SLOT( onArtistImageUpdated() ) );
+    connect( m_artist.data(), SIGNAL( coverChanged() ), SLOT( onArtistImageUpdated() ) );
     connect( m_artist.data(), SIGNAL( albumsAdded( QList<Tomahawk::album_ptr>, Tomahawk::ModelMode ) ),
                                 SLOT( onAlbumsFound( QList<Tomahawk::album_ptr>, Tomahawk::ModelMode ) ) );
     connect( m_artist.data(), SIGNAL( tracksAdded( QList<Tomahawk::query_ptr>, Tomahawk::ModelMode, Tomahawk::collection_ptr ) ),
@@ -396,13 +398,15 @@ void
 ArtistInfoWidget::onArtistImageUpdated()
 {
     const QSize coverSize = QSize( ui->cover->width(), ui->cover->width() );
-    if ( !m_artist || m_artist->cover( QSize( 0, 0 ) ).isNull() )
+    // the scaled cover may not be ready yet, we get called again by coverChanged() then
+    const QPixmap cover = ( !m_artist || m_artist->cover( QSize( 0, 0 ) ).isNull() ) ? QPixmap() : m_artist->cover( coverSize );
+    if ( cover.isNull() )
     {
         ui->cover->setPixmap( TomahawkUtils::defaultPixmap( TomahawkUtils::DefaultArtistImage, TomahawkUtils::Original, coverSize ) );
     }
     else
     {
-        ui->cover->setPixmap( m_artist->cover( coverSize ) );
+        ui->cover->setPixmap( cover );
     }
 
     m_pixmap = m_artist->cover( QSize( 0, 0 ) );
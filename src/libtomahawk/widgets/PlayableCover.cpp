@@ -192,6 +192,10 @@ PlayableCover::mouseMoveEvent( QMouseEvent* event )
             break;
     }
 
+    // the drag can't wait for a cover that is still being scaled
+    if ( pixmap.isNull() && !m_pixmap.isNull() )
+        pixmap = m_pixmap.scaled( pixSize, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+
     QDrag* drag = new QDrag( this );
     drag->setMimeData( mimeData );
     drag->setPixmap( pixmap );
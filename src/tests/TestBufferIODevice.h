@@ -0,0 +1,200 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTBUFFERIODEVICE_H
+#define TOMAHAWK_TESTBUFFERIODEVICE_H
+
+#include <QtTest>
+
+#include "libtomahawk/network/BufferIoDevice.h"
+
+
+// The QList<QByteArray> storage BufferIODevice used to have, kept as reference
+class ListBuffer
+{
+public:
+    void addData( int block, const QByteArray& ba )
+    {
+        while ( m_buffer.count() <= block )
+            m_buffer << QByteArray();
+
+        m_buffer.replace( block, ba );
+    }
+
+    qint64 read( char* data, qint64 pos, qint64 maxSize )
+    {
+        const int blockSize = BufferIODevice::blockSize();
+        int block = pos / blockSize;
+        int offset = pos % blockSize;
+
+        QByteArray ba;
+        while ( ba.count() < maxSize && block < m_buffer.count() && !m_buffer.at( block ).isEmpty() )
+        {
+            ba.append( m_buffer.at( block++ ).mid( offset ) );
+            offset = 0;
+        }
+
+        ba = ba.left( maxSize );
+        memcpy( data, ba.data(), ba.count() );
+        return ba.count();
+    }
+
+private:
+    QList<QByteArray> m_buffer;
+};
+
+
+class TestBufferIODevice : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QByteArray payload( int size )
+    {
+        QByteArray ba( size, 0 );
+        for ( int i = 0; i < size; i++ )
+            ba[i] = (char)( i * 7 + i / 4096 );
+
+        return ba;
+    }
+
+private slots:
+    void testOutOfOrderBlocks()
+    {
+        const int blockSize = BufferIODevice::blockSize();
+        const QByteArray data = payload( blockSize * 3 + 100 );
+
+        BufferIODevice dev( data.size() );
+        dev.open( QIODevice::ReadOnly );
+
+        QCOMPARE( dev.maxBlocks(), 4 );
+        QCOMPARE( dev.nextEmptyBlock(), 0 );
+
+        dev.addData( 2, data.mid( 2 * blockSize, blockSize ) );
+        QVERIFY( dev.isBlockEmpty( 0 ) );
+        QVERIFY( !dev.isBlockEmpty( 2 ) );
+        QCOMPARE( dev.nextEmptyBlock(), 0 );
+
+        // nothing to read before block 0 arrived
+        char buf[ 16 ];
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)0 );
+
+        dev.addData( 0, data.mid( 0, blockSize ) );
+        QCOMPARE( dev.nextEmptyBlock(), 1 );
+
+        // reads stop at the gap
+        QCOMPARE( dev.read( blockSize * 2 ), data.mid( 0, blockSize ) );
+
+        dev.addData( 3, data.mid( 3 * blockSize ) );
+        dev.addData( 1, data.mid( blockSize, blockSize ) );
+        QCOMPARE( dev.nextEmptyBlock(), -1 );
+
+        // and continue across block boundaries, up to the partial last block
+        QCOMPARE( dev.readAll(), data.mid( blockSize ) );
+        QVERIFY( dev.atEnd() );
+
+        QVERIFY( dev.seek( blockSize / 2 ) );
+        QCOMPARE( dev.read( blockSize ), data.mid( blockSize / 2, blockSize ) );
+    }
+
+    void testMultiBlockData()
+    {
+        const int blockSize = BufferIODevice::blockSize();
+        const QByteArray data = payload( blockSize * 5 );
+
+        BufferIODevice dev( data.size() );
+        dev.open( QIODevice::ReadOnly );
+
+        dev.addData( 0, data.left( blockSize * 4 ) );
+        QCOMPARE( dev.nextEmptyBlock(), 4 );
+        QVERIFY( !dev.isBlockEmpty( 3 ) );
+
+        dev.addData( 4, data.mid( blockSize * 4 ) );
+        QCOMPARE( dev.nextEmptyBlock(), -1 );
+        QCOMPARE( dev.readAll(), data );
+    }
+
+    void testCopyData()
+    {
+        const int blockSize = BufferIODevice::blockSize();
+        const QByteArray data = payload( blockSize * 3 + 100 );
+
+        BufferIODevice dev( data.size() );
+        dev.open( QIODevice::ReadOnly );
+
+        dev.addData( 0, data.left( blockSize ) );
+        dev.addData( 2, data.mid( blockSize * 2, blockSize ) );
+        QCOMPARE( dev.receivedLength(), (qint64)blockSize );
+
+        // stops at the gap and leaves the read position alone
+        QByteArray out( data.size(), 0 );
+        QCOMPARE( dev.copyData( out.data(), 10, data.size() ), (qint64)blockSize - 10 );
+        QCOMPARE( out.left( blockSize - 10 ), data.mid( 10, blockSize - 10 ) );
+        QCOMPARE( dev.pos(), (qint64)0 );
+
+        dev.addData( 1, data.mid( blockSize, blockSize ) );
+        dev.addData( 3, data.mid( blockSize * 3 ) );
+        QCOMPARE( dev.receivedLength(), (qint64)data.size() );
+        QCOMPARE( dev.copyData( out.data(), 0, data.size() ), (qint64)data.size() );
+        QCOMPARE( out, data );
+    }
+
+    void benchmarkRead_data()
+    {
+        QTest::addColumn< bool >( "reference" );
+
+        QTest::newRow( "list" ) << true;
+        QTest::newRow( "contiguous" ) << false;
+    }
+
+    void benchmarkRead()
+    {
+        QFETCH( bool, reference );
+
+        // roughly a 4 minute FLAC, read in the small chunks VLC asks for
+        const int blockSize = BufferIODevice::blockSize();
+        const QByteArray data = payload( 30 * 1024 * 1024 );
+        const int readSize = 1024;
+
+        ListBuffer list;
+        BufferIODevice dev( data.size() );
+        dev.open( QIODevice::ReadOnly );
+        for ( int block = 0; block * blockSize < data.size(); block++ )
+        {
+            if ( reference )
+                list.addData( block, data.mid( block * blockSize, blockSize ) );
+            else
+                dev.addData( block, data.mid( block * blockSize, blockSize ) );
+        }
+
+        QByteArray out( readSize, 0 );
+        QBENCHMARK
+        {
+            qint64 total = 0;
+            dev.seek( 0 );
+            for ( qint64 pos = 0; pos < data.size(); pos += readSize )
+            {
+                if ( reference )
+                    total += list.read( out.data(), pos, readSize );
+                else
+                    total += dev.read( out.data(), readSize );
+            }
+            QCOMPARE( total, (qint64)data.size() );
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,116 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTPLAYLISTDELTA_H
+#define TOMAHAWK_TESTPLAYLISTDELTA_H
+
+#include <QtTest>
+
+#include "libtomahawk/database/PlaylistDelta.h"
+
+
+class TestPlaylistDelta : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip_data()
+    {
+        QTest::addColumn< QStringList >( "from" );
+        QTest::addColumn< QStringList >( "to" );
+        QTest::addColumn< int >( "size" );
+
+        const QStringList abcde = QString( "a b c d e" ).split( ' ' );
+
+        QTest::newRow( "unchanged" ) << abcde << abcde << 0;
+        QTest::newRow( "from empty" ) << QStringList() << abcde << 5;
+        QTest::newRow( "to empty" ) << abcde << QStringList() << 5;
+        QTest::newRow( "append" ) << abcde << QString( "a b c d e f g" ).split( ' ' ) << 2;
+        QTest::newRow( "prepend" ) << abcde << QString( "f a b c d e" ).split( ' ' ) << 1;
+        QTest::newRow( "remove" ) << abcde << QString( "a c e" ).split( ' ' ) << 2;
+        QTest::newRow( "move to front" ) << abcde << QString( "d a b c e" ).split( ' ' ) << 1;
+        QTest::newRow( "move to back" ) << abcde << QString( "b c d e a" ).split( ' ' ) << 1;
+        QTest::newRow( "swap" ) << abcde << QString( "a d c b e" ).split( ' ' ) << 2;
+        QTest::newRow( "reverse" ) << abcde << QString( "e d c b a" ).split( ' ' ) << 4;
+        QTest::newRow( "mixed" ) << abcde << QString( "x c a y e b" ).split( ' ' ) << 5;
+    }
+
+    void testRoundTrip()
+    {
+        QFETCH( QStringList, from );
+        QFETCH( QStringList, to );
+        QFETCH( int, size );
+
+        const QVariantMap delta = Tomahawk::PlaylistDelta::create( from, to );
+        QVERIFY( !delta.isEmpty() );
+        QCOMPARE( Tomahawk::PlaylistDelta::size( delta ), size );
+        QCOMPARE( Tomahawk::PlaylistDelta::apply( from, delta ), to );
+    }
+
+    void testDuplicates()
+    {
+        const QStringList unique = QString( "a b c" ).split( ' ' );
+        const QStringList duplicate = QString( "a b a" ).split( ' ' );
+
+        QVERIFY( Tomahawk::PlaylistDelta::create( unique, duplicate ).isEmpty() );
+        QVERIFY( Tomahawk::PlaylistDelta::create( duplicate, unique ).isEmpty() );
+    }
+
+    void testChain()
+    {
+        // a chain of random edits resolves to the same list as the snapshots
+        qsrand( 42 );
+        QStringList base;
+        for ( int i = 0; i < 200; i++ )
+            base << QString::number( i );
+
+        QStringList current = base;
+        QStringList resolved = base;
+        int next = base.count();
+        for ( int rev = 0; rev < 50; rev++ )
+        {
+            QStringList changed = current;
+            for ( int edit = 0; edit < 5; edit++ )
+            {
+                const int pos = qrand() % ( changed.count() + 1 );
+                switch ( qrand() % 3 )
+                {
+                    case 0:
+                        changed.insert( pos, QString::number( next++ ) );
+                        break;
+                    case 1:
+                        if ( pos < changed.count() )
+                            changed.removeAt( pos );
+                        break;
+                    case 2:
+                        if ( pos < changed.count() )
+                            changed.move( pos, qrand() % changed.count() );
+                        break;
+                }
+            }
+
+            const QVariantMap delta = Tomahawk::PlaylistDelta::create( current, changed );
+            QVERIFY( Tomahawk::PlaylistDelta::size( delta ) <= 5 );
+
+            resolved = Tomahawk::PlaylistDelta::apply( resolved, delta );
+            current = changed;
+        }
+
+        QCOMPARE( resolved, current );
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTSHUFFLEENGINE_H
+#define TOMAHAWK_TESTSHUFFLEENGINE_H
+
+#include <QtTest>
+
+#include "libtomahawk/playlist/ShuffleEngine.h"
+
+using namespace Tomahawk;
+
+
+class TestShuffleEngine : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Plays a whole round and returns the items in the order they came up
+    static QList< qint64 > playRound( ShuffleEngine& engine )
+    {
+        QList< qint64 > order;
+        while ( engine.remaining() )
+        {
+            const qint64 item = engine.pick();
+            order << item;
+            engine.markPlayed( item );
+        }
+
+        return order;
+    }
+
+private slots:
+    void testEveryItemOncePerRound()
+    {
+        ShuffleEngine engine;
+        for ( qint64 i = 1; i <= 100; i++ )
+            engine.insert( i );
+
+        for ( int round = 0; round < 3; round++ )
+        {
+            const QList< qint64 > order = playRound( engine );
+            QCOMPARE( order.count(), 100 );
+            QCOMPARE( order.toSet().count(), 100 );
+            QCOMPARE( engine.pick(), (qint64)-1 );
+
+            engine.newRound();
+            QCOMPARE( engine.remaining(), 100 );
+        }
+    }
+
+    void testChangesDuringRound()
+    {
+        ShuffleEngine engine;
+        for ( qint64 i = 1; i <= 10; i++ )
+            engine.insert( i );
+
+        engine.markPlayed( 3 );
+        engine.remove( 4 );
+        engine.remove( 5 );
+        engine.insert( 3 );
+        engine.insert( 11 );
+        QCOMPARE( engine.remaining(), 8 );
+        QVERIFY( !engine.contains( 3 ) );
+        QVERIFY( engine.wasPlayed( 3 ) );
+
+        const QList< qint64 > order = playRound( engine );
+        QVERIFY( order.contains( 11 ) );
+        QVERIFY( !order.contains( 3 ) );
+        QVERIFY( !order.contains( 4 ) );
+
+        // removed items don't come back with the next round
+        engine.newRound();
+        QCOMPARE( engine.remaining(), 9 );
+        QVERIFY( !engine.contains( 5 ) );
+
+        engine.markPlayed( 7 );
+        engine.unmarkPlayed( 7 );
+        QVERIFY( engine.contains( 7 ) );
+    }
+
+    void testWeightedPicks()
+    {
+        ShuffleEngine engine;
+        for ( qint64 i = 1; i <= 40; i++ )
+            engine.insert( i, i == 1 ? 100.0 : 0.1 );
+
+        int heavy = 0;
+        for ( int i = 0; i < 1000; i++ )
+        {
+            if ( engine.pick() == 1 )
+                heavy++;
+        }
+        QVERIFY( heavy > 900 );
+
+        // weighted rounds still hand out every item exactly once
+        engine.remove( 20 );
+        const QList< qint64 > order = playRound( engine );
+        QCOMPARE( order.count(), 39 );
+        QCOMPARE( order.toSet().count(), 39 );
+
+        // and the weights carry over to the next round
+        engine.newRound();
+        heavy = 0;
+        for ( int i = 0; i < 1000; i++ )
+        {
+            if ( engine.pick() == 1 )
+                heavy++;
+        }
+        QVERIFY( heavy > 900 );
+    }
+};
+
+#endif
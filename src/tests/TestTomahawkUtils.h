@@ -0,0 +1,139 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTTOMAHAWKUTILS_H
+#define TOMAHAWK_TESTTOMAHAWKUTILS_H
+
+#include <QtTest>
+
+#include "libtomahawk/utils/TomahawkUtils.h"
+
+
+class TestTomahawkUtils : public QObject
+{
+    Q_OBJECT
+
+private:
+    // The full matrix implementation levenshtein() used to have, kept as reference
+    static int matrixLevenshtein( const QString& source, const QString& target )
+    {
+        const int n = source.length();
+        const int m = target.length();
+
+        if ( n == 0 )
+            return m;
+        if ( m == 0 )
+            return n;
+
+        QVector< QVector<int> > matrix( n + 1, QVector<int>( m + 1 ) );
+        for ( int i = 0; i <= n; i++ )
+            matrix[i][0] = i;
+        for ( int j = 0; j <= m; j++ )
+            matrix[0][j] = j;
+
+        for ( int i = 1; i <= n; i++ )
+        {
+            for ( int j = 1; j <= m; j++ )
+            {
+                const int cost = ( source[i - 1] == target[j - 1] ) ? 0 : 1;
+
+                int cell = qMin( matrix[i][j - 1] + 1, matrix[i - 1][j - 1] + cost );
+                cell = qMin( cell, matrix[i - 1][j] + 1 );
+
+                if ( i > 2 && j > 2 )
+                {
+                    int trans = matrix[i - 2][j - 2] + 1;
+                    if ( source[i - 2] != target[j - 1] ) trans++;
+                    if ( source[i - 1] != target[j - 2] ) trans++;
+                    cell = qMin( cell, trans );
+                }
+                matrix[i][j] = cell;
+            }
+        }
+
+        return matrix[n][m];
+    }
+
+    static QList< QPair< QString, QString > > names()
+    {
+        QList< QPair< QString, QString > > pairs;
+        pairs << qMakePair( QString( "the beatles" ), QString( "beatles" ) )
+              << qMakePair( QString( "smells like teen spirit" ), QString( "smells like teen spirit (remastered)" ) )
+              << qMakePair( QString( "bohemian rhapsody" ), QString( "bohemain rapsody" ) )
+              << qMakePair( QString( "sigur ros" ), QString( "sigur rós" ) )
+              << qMakePair( QString( "nine inch nails" ), QString( "the downward spiral" ) );
+        return pairs;
+    }
+
+private slots:
+    void testLevenshtein()
+    {
+        QCOMPARE( TomahawkUtils::levenshtein( "", "" ), 0 );
+        QCOMPARE( TomahawkUtils::levenshtein( "abc", "" ), 3 );
+        QCOMPARE( TomahawkUtils::levenshtein( "", "abcd" ), 4 );
+        QCOMPARE( TomahawkUtils::levenshtein( "kitten", "sitting" ), 3 );
+        QCOMPARE( TomahawkUtils::levenshtein( "tomahawk", "tomahawk" ), 0 );
+
+        // longer than the stack buffer
+        const QString longName = QString( "a" ).repeated( 300 );
+        QCOMPARE( TomahawkUtils::levenshtein( longName, longName + "b" ), 1 );
+
+        QPair< QString, QString > pair;
+        foreach ( pair, names() )
+            QCOMPARE( TomahawkUtils::levenshtein( pair.first, pair.second ), matrixLevenshtein( pair.first, pair.second ) );
+
+        qsrand( 42 );
+        for ( int k = 0; k < 2000; k++ )
+        {
+            QString source, target;
+            for ( int i = qrand() % 12; i > 0; i-- )
+                source += QChar( 'a' + qrand() % 4 );
+            for ( int i = qrand() % 12; i > 0; i-- )
+                target += QChar( 'a' + qrand() % 4 );
+
+            QCOMPARE( TomahawkUtils::levenshtein( source, target ), matrixLevenshtein( source, target ) );
+        }
+    }
+
+    void benchmarkLevenshtein_data()
+    {
+        QTest::addColumn< bool >( "reference" );
+
+        QTest::newRow( "matrix" ) << true;
+        QTest::newRow( "rows" ) << false;
+    }
+
+    void benchmarkLevenshtein()
+    {
+        QFETCH( bool, reference );
+        const QList< QPair< QString, QString > > pairs = names();
+
+        int total = 0;
+        QBENCHMARK
+        {
+            for ( int i = 0; i < pairs.count(); i++ )
+            {
+                if ( reference )
+                    total += matrixLevenshtein( pairs.at( i ).first, pairs.at( i ).second );
+                else
+                    total += TomahawkUtils::levenshtein( pairs.at( i ).first, pairs.at( i ).second );
+            }
+        }
+        QVERIFY( total > 0 );
+    }
+};
+
+#endif
@@ -175,8 +175,13 @@ SocialWidget::onShortLinkReady( const QUrl& longUrl, const QUrl& shortUrl, const
 void
 SocialWidget::setQuery( const Tomahawk::query_ptr& query )
 {
+    if ( m_query )
+        disconnect( m_query->track().data(), SIGNAL( coverChanged() ), this, SLOT( onCoverChanged() ) );
+
     m_query = query;
-    ui->coverImage->setPixmap( TomahawkUtils::addDropShadow( query->track()->cover( ui->coverImage->size() ), ui->coverImage->size() ) );
+    // the scaled cover may still be on its way
+    connect( m_query->track().data(), SIGNAL( coverChanged() ), SLOT( onCoverChanged() ) );
+    onCoverChanged();
     onShortLinkReady( QString(), QString(), QVariant() );
     onChanged();
 
@@ -186,6 +191,13 @@ SocialWidget::setQuery( const Tomahawk::query_ptr& query )
 }
 
 
+void
+SocialWidget::onCoverChanged()
+{
+    ui->coverImage->setPixmap( TomahawkUtils::addDropShadow( m_query->track()->cover( ui->coverImage->size() ), ui->coverImage->size() ) );
+}
+
+
 void
 SocialWidget::onQueryLinkReady( const QVariantMap& data )
 {
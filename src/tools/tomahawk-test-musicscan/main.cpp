@@ -2,6 +2,7 @@
 
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QTime>
 
 #include <iostream>
 
@@ -9,21 +10,28 @@ void
 usage()
 {
     std::cout << "Usage:" << std::endl;
-    std::cout << "\ttomahawk-test-musicscan <path>" << std::endl;
+    std::cout << "\ttomahawk-test-musicscan [--threads <n>] <path>" << std::endl;
     std::cout << std::endl;
     std::cout << "\tpath\tEither an audio file or a directory" << std::endl;
+    std::cout << "\tn\tNumber of threads reading tags when scanning a directory" << std::endl;
 }
 
 int
 main( int argc, char* argv[] )
 {
-    if ( argc != 2 )
+    int threads = 0;
+    if ( argc == 4 && QString( argv[1] ) == "--threads" )
+    {
+        threads = QString( argv[2] ).toInt();
+    }
+    else if ( argc != 2 )
     {
         usage();
+        exit(EXIT_FAILURE);
     }
 
     QCoreApplication a( argc, argv );
-    QFileInfo pathInfo( argv[1] );
+    QFileInfo pathInfo( argv[argc - 1] );
 
     if ( !pathInfo.exists() )
     {
@@ -49,6 +57,8 @@ main( int argc, char* argv[] )
         // We want a dry-run of the scanner and not update any internal data.
         scanner.setDryRun( true );
         scanner.setVerbose( true );
+        if ( threads > 0 )
+            scanner.setThreads( threads );
 
         // Start the MusicScanner in its own thread
         QThread scannerThread( 0 );
@@ -57,10 +67,16 @@ main( int argc, char* argv[] )
         scannerThread.moveToThread( &scannerThread );
         scanner.moveToThread( &scannerThread );
         QObject::connect( &scanner, SIGNAL( finished() ), &scannerThread, SLOT( quit() ) );
+        QTime timer;
+        timer.start();
         QMetaObject::invokeMethod( &scanner, "scan", Qt::QueuedConnection );
 
         // Wait until the scanner has done its work.
         scannerThread.wait();
+
+        const int elapsed = qMax( 1, timer.elapsed() );
+        std::cout << "Scanned " << scanner.filesScanned() << " files in " << elapsed << "ms using "
+                  << scanner.threads() << " threads (" << scanner.filesScanned() * 1000.0 / elapsed << " files/sec)" << std::endl;
     }
     else
     {
@@ -0,0 +1,376 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/Json.h"
+#include "utils/TomahawkUtils.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+#include <QTimer>
+
+#include <algorithm>
+#include <iostream>
+
+// get_results polling as done by the playdar.js client
+#define POLL_INTERVAL 1300
+#define POLL_LIMIT 14
+// Seconds a long-polling get_results may be held open
+#define WAIT_TIMEOUT 30
+// Queries per resolve_batch request
+#define BATCH_SIZE 100
+
+
+void
+usage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "\ttomahawk-test-playdarapi [--mode poll|wait|batch] [--parallel <n>] [--url <url>] <file>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "\tmode\tpoll: resolve + get_results every " << POLL_INTERVAL << "ms (default)" << std::endl;
+    std::cout << "\t\twait: resolve + long-polling get_results" << std::endl;
+    std::cout << "\t\tbatch: resolve_batch + long-polling get_results" << std::endl;
+    std::cout << "\tn\tNumber of queries in flight at once (default 20)" << std::endl;
+    std::cout << "\turl\tBase url of the Playdar API (default http://localhost:60210)" << std::endl;
+    std::cout << "\tfile\tQueries to resolve, one \"artist<TAB>track\" per line" << std::endl;
+}
+
+
+class LoadTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode { Poll, Wait, Batch };
+
+    LoadTest( const QUrl& base, Mode mode, int parallel, const QList< QStringList >& queries )
+        : m_base( base )
+        , m_mode( mode )
+        , m_parallel( parallel )
+        , m_started( 0 )
+        , m_done( 0 )
+        , m_requests( 0 )
+        , m_bytes( 0 )
+    {
+        foreach ( const QStringList& q, queries )
+        {
+            Pending p;
+            p.artist = q.value( 0 );
+            p.track = q.value( 1 );
+            m_pending << p;
+        }
+
+        connect( &m_nam, SIGNAL( finished( QNetworkReply* ) ), SLOT( onFinished( QNetworkReply* ) ) );
+        connect( &m_ticker, SIGNAL( timeout() ), SLOT( onTick() ) );
+        m_ticker.start( 50 );
+    }
+
+    void start()
+    {
+        m_timer.start();
+
+        if ( m_mode == Batch )
+        {
+            for ( int i = 0; i < m_pending.count(); i += BATCH_SIZE )
+                resolveBatch( i, qMin( m_pending.count(), i + BATCH_SIZE ) );
+            m_started = m_pending.count();
+        }
+        else
+        {
+            while ( m_started < m_pending.count() && m_started < m_parallel )
+                resolve( m_started++ );
+        }
+    }
+
+signals:
+    void finished();
+
+private slots:
+    void onFinished( QNetworkReply* reply )
+    {
+        reply->deleteLater();
+
+        const QByteArray data = reply->readAll();
+        m_bytes += data.size();
+
+        const QVariantMap m = TomahawkUtils::parseJson( data ).toMap();
+        const int idx = reply->property( "idx" ).toInt();
+        const QString method = reply->property( "method" ).toString();
+
+        if ( method == "resolve_batch" )
+        {
+            const QVariantList qids = m.value( "qids" ).toList();
+            for ( int i = 0; i < qids.count(); i++ )
+            {
+                m_pending[ idx + i ].qid = qids.at( i ).toString();
+                next( idx + i, m.isEmpty() || m_pending.at( idx + i ).qid.isEmpty() );
+            }
+        }
+        else if ( method == "resolve" )
+        {
+            m_pending[ idx ].qid = m.value( "qid" ).toString();
+            next( idx, m.isEmpty() );
+        }
+        else
+        {
+            Pending& p = m_pending[ idx ];
+            p.polls++;
+            p.known = m.value( "results" ).toList().count();
+            if ( p.known && p.firstResult < 0 )
+                p.firstResult = p.started.elapsed();
+
+            const bool done = m.isEmpty() || m.value( "finished" ).toBool() ||
+                              ( m_mode == Poll && ( m.value( "solved" ).toBool() || p.polls >= POLL_LIMIT ) );
+            next( idx, done );
+        }
+    }
+
+    void onTick()
+    {
+        for ( int i = 0; i < m_started; i++ )
+        {
+            Pending& p = m_pending[ i ];
+            if ( p.nextPoll.isValid() && p.nextPoll.elapsed() >= POLL_INTERVAL )
+            {
+                p.nextPoll = QTime();
+                getResults( i );
+            }
+        }
+    }
+
+private:
+    struct Pending
+    {
+        Pending() : polls( 0 ), known( 0 ), firstResult( -1 ), finished( false ) {}
+
+        QString artist;
+        QString track;
+        QString qid;
+        int polls;
+        int known;
+        int firstResult;
+        bool finished;
+        QTime started;
+        QTime nextPoll;
+    };
+
+    QNetworkReply* get( const QList< QPair< QString, QString > >& items )
+    {
+        QUrl url( m_base );
+        url.setPath( "/api/" );
+
+        typedef QPair< QString, QString > QueryItem;
+        foreach ( const QueryItem& item, items )
+            TomahawkUtils::urlAddQueryItem( url, item.first, item.second );
+
+        m_requests++;
+        return m_nam.get( QNetworkRequest( url ) );
+    }
+
+    void resolve( int idx )
+    {
+        Pending& p = m_pending[ idx ];
+        p.started.start();
+
+        QList< QPair< QString, QString > > items;
+        items << qMakePair( QString( "method" ), QString( "resolve" ) )
+              << qMakePair( QString( "artist" ), p.artist )
+              << qMakePair( QString( "track" ), p.track );
+
+        QNetworkReply* reply = get( items );
+        reply->setProperty( "idx", idx );
+        reply->setProperty( "method", "resolve" );
+    }
+
+    void resolveBatch( int from, int to )
+    {
+        QVariantList entries;
+        for ( int i = from; i < to; i++ )
+        {
+            m_pending[ i ].started.start();
+
+            QVariantMap m;
+            m[ "artist" ] = m_pending.at( i ).artist;
+            m[ "track" ] = m_pending.at( i ).track;
+            entries << m;
+        }
+
+        QUrl url( m_base );
+        url.setPath( "/api/" );
+        TomahawkUtils::urlSetQuery( url, "method=resolve_batch" );
+
+        QNetworkRequest request( url );
+        request.setHeader( QNetworkRequest::ContentTypeHeader, "application/json" );
+
+        m_requests++;
+        QNetworkReply* reply = m_nam.post( request, TomahawkUtils::toJson( entries ) );
+        reply->setProperty( "idx", from );
+        reply->setProperty( "method", "resolve_batch" );
+    }
+
+    void getResults( int idx )
+    {
+        const Pending& p = m_pending.at( idx );
+
+        QList< QPair< QString, QString > > items;
+        items << qMakePair( QString( "method" ), QString( "get_results" ) )
+              << qMakePair( QString( "qid" ), p.qid );
+        if ( m_mode != Poll )
+        {
+            items << qMakePair( QString( "wait" ), QString::number( WAIT_TIMEOUT ) )
+                  << qMakePair( QString( "known" ), QString::number( p.known ) );
+        }
+
+        QNetworkReply* reply = get( items );
+        reply->setProperty( "idx", idx );
+        reply->setProperty( "method", "get_results" );
+    }
+
+    void next( int idx, bool done )
+    {
+        Pending& p = m_pending[ idx ];
+        if ( !done )
+        {
+            // The first get_results of a poll is done straight away, as playdar.js does
+            if ( m_mode == Poll && p.polls > 0 )
+                p.nextPoll.start();
+            else
+                getResults( idx );
+
+            return;
+        }
+
+        p.finished = true;
+        m_done++;
+        if ( m_mode != Batch && m_started < m_pending.count() )
+            resolve( m_started++ );
+
+        if ( m_done == m_pending.count() )
+            report();
+    }
+
+    void report()
+    {
+        const int elapsed = qMax( 1, m_timer.elapsed() );
+
+        QList< int > latencies;
+        foreach ( const Pending& p, m_pending )
+        {
+            if ( p.firstResult >= 0 )
+                latencies << p.firstResult;
+        }
+        std::sort( latencies.begin(), latencies.end() );
+
+        std::cout << "Resolved " << m_pending.count() << " queries in " << elapsed << "ms" << std::endl;
+        std::cout << "\t" << m_requests << " requests (" << m_requests * 1000.0 / elapsed << " req/sec), "
+                  << m_bytes / 1024 << " KB received" << std::endl;
+        std::cout << "\t" << latencies.count() << " queries with results";
+        if ( !latencies.isEmpty() )
+        {
+            std::cout << ", time to first result: median " << latencies.at( latencies.count() / 2 ) << "ms"
+                      << ", 95th percentile " << latencies.at( latencies.count() * 95 / 100 ) << "ms";
+        }
+        std::cout << std::endl;
+
+        emit finished();
+    }
+
+    QNetworkAccessManager m_nam;
+    QTimer m_ticker;
+    QTime m_timer;
+
+    QUrl m_base;
+    Mode m_mode;
+    int m_parallel;
+    QList< Pending > m_pending;
+    int m_started;
+    int m_done;
+    int m_requests;
+    qint64 m_bytes;
+};
+
+
+int
+main( int argc, char* argv[] )
+{
+    QCoreApplication a( argc, argv );
+    QStringList args = a.arguments();
+    args.removeFirst();
+
+    LoadTest::Mode mode = LoadTest::Poll;
+    int parallel = 20;
+    QUrl base( "http://localhost:60210" );
+
+    while ( args.count() > 2 && args.first().startsWith( "--" ) )
+    {
+        const QString option = args.takeFirst();
+        const QString value = args.takeFirst();
+
+        if ( option == "--mode" && ( value == "poll" || value == "wait" || value == "batch" ) )
+            mode = ( value == "poll" ) ? LoadTest::Poll : ( value == "wait" ) ? LoadTest::Wait : LoadTest::Batch;
+        else if ( option == "--parallel" && value.toInt() > 0 )
+            parallel = value.toInt();
+        else if ( option == "--url" )
+            base = QUrl( value );
+        else
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if ( args.count() != 1 )
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    QFile file( args.first() );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        std::cerr << "Cannot read " << args.first().toStdString() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    QList< QStringList > queries;
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    while ( !stream.atEnd() )
+    {
+        const QStringList fields = stream.readLine().split( '\t' );
+        if ( fields.count() >= 2 && !fields.at( 0 ).trimmed().isEmpty() && !fields.at( 1 ).trimmed().isEmpty() )
+            queries << fields;
+    }
+
+    if ( queries.isEmpty() )
+    {
+        std::cerr << "No queries in " << args.first().toStdString() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    LoadTest test( base, mode, parallel, queries );
+    QObject::connect( &test, SIGNAL( finished() ), &a, SLOT( quit() ) );
+    test.start();
+
+    return a.exec();
+}
+
+#include "main.moc"